@@ -0,0 +1,11 @@
+#!/usr/bin/env bash
+
+# Build, and run benchmarks.
+cd "$(dirname "${BASH_SOURCE[0]}")/build"
+cmake -DMMGC_LARGE_HEAP=ON -DCMAKE_BUILD_TYPE=Release ..
+make mark-bench alloc-bench
+cd -
+
+"$(dirname "${BASH_SOURCE[0]}")/build/bench/mark-bench"
+
+"$(dirname "${BASH_SOURCE[0]}")/build/bench/alloc-bench"
@@ -0,0 +1,188 @@
+/**
+ * The MIT License (MIT)
+ * Copyright (c) 2018-present Dmitry Soshnikov <dmitry.soshnikov@gmail.com>
+ */
+
+/**
+ * Allocation benchmark.
+ *
+ * Fills the heap with a linked list of small objects (allocation, and
+ * two stores per object), and reads it back through the object headers,
+ * for the polymorphic MemoryManager (virtual calls), and for the
+ * BasicMemoryManager, composed of the same classes at compile time.
+ *
+ * The mark case traces the same list (all objects are alive) with the
+ * mark loop of the collector, which calls the allocator through the
+ * IAllocator, or directly (bound by the BasicMemoryManager).
+ *
+ * The default 32-bit object headers limit the heap to 64 KiB, build with
+ * -DMMGC_LARGE_HEAP=ON to get a heap large enough for the measurements.
+ */
+
+#include <stdint.h>
+#include <algorithm>
+#include <chrono>
+#include <iomanip>
+#include <iostream>
+#include <memory>
+
+#include "BasicMemoryManager.h"
+#include "MarkSweepGC.h"
+#include "MemoryManager.h"
+#include "SegregatedFreeListAllocator.h"
+
+/**
+ * Heap size: 16 MiB, or the largest addressable heap.
+ */
+static constexpr uint32_t HEAP_SIZE =
+    std::min<uint32_t>(16 << 20, ObjectHeader::MAX_HEAP_SIZE);
+
+/**
+ * Measurement runs per configuration (the best one is reported).
+ */
+static constexpr uint32_t RUNS = 5;
+
+/**
+ * Fills the heap with the list, and sums the object sizes.
+ * Returns the number of objects.
+ */
+template <class MM>
+uint32_t fillHeap(MM& mm) {
+  Value prev = Value::Pointer(nullptr);
+  uint32_t count = 0;
+  uint32_t size = 0;
+
+  while (true) {
+    auto object = mm.allocate(2 * sizeof(Word));
+    if (object.isNullPointer()) {
+      break;
+    }
+    mm.writeValue(object, Value::Number(count));
+    mm.writeValue(object + 1, prev);
+    prev = object;
+    count++;
+  }
+
+  while (!prev.isNullPointer()) {
+    size += mm.getHeader(prev)->size;
+    prev = *mm.readValue(prev + 1);
+  }
+
+  if (size != count * 2 * sizeof(Word)) {
+    std::cerr << "Unexpected size: " << size << "\n";
+    exit(1);
+  }
+
+  return count;
+}
+
+/**
+ * Returns the best time (in milliseconds), and the object count.
+ */
+template <class MM>
+double measure(MM& mm, uint32_t& objects) {
+  double best = 0;
+
+  for (uint32_t run = 0; run < RUNS; run++) {
+    mm.reset();
+
+    auto start = std::chrono::steady_clock::now();
+    objects = fillHeap(mm);
+    auto end = std::chrono::steady_clock::now();
+
+    auto time = std::chrono::duration<double, std::milli>(end - start).count();
+    best = run == 0 ? time : std::min(best, time);
+  }
+
+  return best;
+}
+
+/**
+ * Fills the heap with a circular list (so it's reachable from the root,
+ * whichever object is the first one). Returns the number of objects.
+ */
+template <class MM>
+uint32_t fillHeapAlive(MM& mm) {
+  mm.reset();
+
+  auto first = mm.allocate(2 * sizeof(Word));
+  auto prev = first;
+  uint32_t count = 1;
+
+  while (true) {
+    auto object = mm.allocate(2 * sizeof(Word));
+    if (object.isNullPointer()) {
+      break;
+    }
+    mm.writeValue(object, Value::Number(count));
+    mm.writeValue(prev + 1, object);
+    prev = object;
+    count++;
+  }
+
+  mm.writeValue(first, Value::Number(0));
+  mm.writeValue(prev + 1, first);
+
+  return count;
+}
+
+/**
+ * Returns the best mark phase time (in milliseconds).
+ */
+template <class MM>
+double measureMark(MM& mm) {
+  auto objects = fillHeapAlive(mm);
+  auto gc = std::static_pointer_cast<MarkSweepGC>(mm.collector);
+  double best = 0;
+
+  for (uint32_t run = 0; run < RUNS; run++) {
+    gc->init();
+
+    auto start = std::chrono::steady_clock::now();
+    gc->mark();
+    auto end = std::chrono::steady_clock::now();
+
+    if (gc->stats->alive != objects) {
+      std::cerr << "Unexpected alive count: " << gc->stats->alive << "\n";
+      exit(1);
+    }
+
+    // Resets the marks (there is no garbage).
+    gc->sweep();
+
+    auto time = std::chrono::duration<double, std::milli>(end - start).count();
+    best = run == 0 ? time : std::min(best, time);
+  }
+
+  return best;
+}
+
+int main(int argc, char const* argv[]) {
+  auto polymorphic = MemoryManager::create<SegregatedFreeListAllocator,
+                                           MarkSweepGC, HEAP_SIZE>();
+  auto composed = BasicMemoryManager<SegregatedFreeListAllocator,
+                                     MarkSweepGC>::create<HEAP_SIZE>();
+
+  uint32_t objects = 0;
+  auto virtualTime = measure(*polymorphic, objects);
+  auto directTime = measure(*composed, objects);
+
+  std::cout << "Heap: " << HEAP_SIZE << " bytes, objects: " << objects
+            << "\n\n";
+
+  auto virtualMark = measureMark(*polymorphic);
+  auto directMark = measureMark(*composed);
+
+  std::cout << std::fixed << std::setprecision(2) << std::setw(8) << ""
+            << std::setw(20) << "MemoryManager, ms" << std::setw(26)
+            << "BasicMemoryManager, ms" << std::setw(10) << "speedup"
+            << "\n"
+            << std::setw(8) << "alloc" << std::setw(20) << virtualTime
+            << std::setw(26) << directTime << std::setw(9)
+            << virtualTime / directTime << "x\n"
+            << std::setw(8) << "mark" << std::setw(20) << virtualMark
+            << std::setw(26) << directMark << std::setw(9)
+            << virtualMark / directMark << "x\n";
+
+  return 0;
+}
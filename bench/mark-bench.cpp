@@ -0,0 +1,151 @@
+/**
+ * The MIT License (MIT)
+ * Copyright (c) 2018-present Dmitry Soshnikov <dmitry.soshnikov@gmail.com>
+ */
+
+/**
+ * Parallel marking benchmark.
+ *
+ * Fills the heap with a tree of small objects (3 child pointers each),
+ * and measures the mark phase of the MarkSweepGC with the growing number
+ * of the marking threads, for the in-header mark bits, and for the side
+ * mark bitmap.
+ *
+ * The default 32-bit object headers limit the heap to 64 KiB, build with
+ * -DMMGC_LARGE_HEAP=ON to get a heap large enough for the measurements.
+ */
+
+#include <stdint.h>
+#include <algorithm>
+#include <chrono>
+#include <deque>
+#include <iomanip>
+#include <iostream>
+#include <memory>
+#include <thread>
+#include <vector>
+
+#include "BumpPointerAllocator.h"
+#include "MarkSweepGC.h"
+#include "MemoryManager.h"
+
+/**
+ * Heap size: 64 MiB, or the largest addressable heap.
+ */
+static constexpr uint32_t HEAP_SIZE =
+    std::min<uint32_t>(64 << 20, ObjectHeader::MAX_HEAP_SIZE);
+
+/**
+ * Child pointers per object.
+ */
+static constexpr int FANOUT = 3;
+
+/**
+ * Measurement runs per configuration (the best one is reported).
+ */
+static constexpr uint32_t RUNS = 5;
+
+/**
+ * Allocates the tree in the breadth-first order, until the heap is full.
+ * Returns the number of objects.
+ */
+uint32_t buildTree(std::shared_ptr<MemoryManager> mm) {
+  std::deque<Value> parents;
+  uint32_t count = 1;
+
+  auto root = mm->allocate((FANOUT + 1) * sizeof(Word));
+  parents.push_back(root);
+
+  while (!parents.empty()) {
+    auto parent = parents.front();
+    parents.pop_front();
+
+    for (int i = 0; i < FANOUT; i++) {
+      auto child = mm->allocate((FANOUT + 1) * sizeof(Word));
+      if (child.isNullPointer()) {
+        return count;
+      }
+      for (int j = 0; j < FANOUT; j++) {
+        mm->writeValue(child + j, Value::Pointer(nullptr));
+      }
+      mm->writeValue(child + FANOUT, Value::Number(count));
+      mm->writeValue(parent + i, Value::Pointer(child));
+      parents.push_back(child);
+      count++;
+    }
+    mm->writeValue(parent + FANOUT, Value::Number(0));
+  }
+
+  return count;
+}
+
+/**
+ * Returns the best mark phase time (in milliseconds).
+ */
+double measureMark(std::shared_ptr<MarkSweepGC> gc, uint32_t threads,
+                   uint32_t expectedAlive) {
+  gc->markThreads = threads;
+  double best = 0;
+
+  for (uint32_t run = 0; run < RUNS; run++) {
+    gc->init();
+
+    auto start = std::chrono::steady_clock::now();
+    gc->mark();
+    auto end = std::chrono::steady_clock::now();
+
+    if (gc->stats->alive != expectedAlive) {
+      std::cerr << "Unexpected alive count: " << gc->stats->alive << "\n";
+      exit(1);
+    }
+
+    // Resets the marks (there is no garbage).
+    gc->sweep();
+
+    auto time = std::chrono::duration<double, std::milli>(end - start).count();
+    best = run == 0 ? time : std::min(best, time);
+  }
+
+  return best;
+}
+
+int main(int argc, char const* argv[]) {
+  auto mm = MemoryManager::create<BumpPointerAllocator, MarkSweepGC,
+                                  HEAP_SIZE>();
+  auto gc = std::static_pointer_cast<MarkSweepGC>(mm->collector);
+
+  auto objects = buildTree(mm);
+  auto maxThreads = std::max(1u, std::thread::hardware_concurrency());
+
+  std::cout << "Heap: " << HEAP_SIZE << " bytes, objects: " << objects
+            << ", cores: " << maxThreads << "\n\n";
+
+  std::cout << std::setw(8) << "threads" << std::setw(14) << "header, ms"
+            << std::setw(10) << "speedup" << std::setw(14) << "bitmap, ms"
+            << std::setw(10) << "speedup"
+            << "\n";
+
+  double headerBase = 0;
+  double bitmapBase = 0;
+
+  for (uint32_t threads = 1; threads <= std::max(8u, maxThreads);
+       threads *= 2) {
+    gc->markBitmap = nullptr;
+    auto header = measureMark(gc, threads, objects);
+
+    gc->markBitmap = std::make_shared<MarkBitmap>(mm->heap);
+    auto bitmap = measureMark(gc, threads, objects);
+
+    if (threads == 1) {
+      headerBase = header;
+      bitmapBase = bitmap;
+    }
+
+    std::cout << std::fixed << std::setprecision(2) << std::setw(8)
+              << threads << std::setw(14) << header << std::setw(9)
+              << headerBase / header << "x" << std::setw(14) << bitmap
+              << std::setw(9) << bitmapBase / bitmap << "x\n";
+  }
+
+  return 0;
+}
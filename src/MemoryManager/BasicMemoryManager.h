@@ -0,0 +1,299 @@
+/**
+ * The MIT License (MIT)
+ * Copyright (c) 2018-present Dmitry Soshnikov <dmitry.soshnikov@gmail.com>
+ */
+
+#pragma once
+
+#include <stdint.h>
+#include <algorithm>
+#include <memory>
+#include <stdexcept>
+#include <type_traits>
+#include <vector>
+
+#include "../Value/Value.h"
+
+#include "MemoryManager.h"
+#include "WriteBarrier.h"
+
+/**
+ * Memory manager composed at compile time of the `Allocator`,
+ * the `Collector`, and the write `Barrier` policy (see WriteBarrier.h).
+ *
+ * The hot paths of the mutator (`allocate`, `free`, `getHeader`,
+ * `sizeOf`, `forEachPointer`, and the barrier of the stores) call
+ * the concrete classes directly (with the qualified calls), so there
+ * is no virtual dispatch, and the calls, defined in the headers (e.g.
+ * the bump pointer allocation), are inlined. The collector's mark,
+ * and sweep (or compaction) loops are bound to the concrete allocator
+ * the same way (see `ICollector::bindAllocator`):
+ *
+ *   auto mm = BasicMemoryManager<BumpPointerAllocator, MarkSweepGC>
+ *                ::create<1024>();
+ *
+ * It's still a `MemoryManager`, which is the polymorphic adapter: the
+ * entry points override the virtual ones of the base class, so the code
+ * working with the `MemoryManager` pointer (or reference) gets the same
+ * allocation, and the same barrier. The class is final, so the calls
+ * on the concrete type are still resolved at compile time.
+ */
+template <class Allocator, class Collector, class Barrier = CollectorBarrier>
+class BasicMemoryManager final : public MemoryManager {
+  static_assert(SupportsBarrier<Collector, Barrier>::value,
+                "The write barrier policy doesn't fit the collector, "
+                "see WriteBarrier.h.");
+
+ public:
+  BasicMemoryManager(const std::shared_ptr<Heap> heap,
+                     const std::shared_ptr<Allocator> allocator,
+                     const std::shared_ptr<Collector> collector)
+      : MemoryManager(heap, allocator, collector),
+        _allocator(allocator.get()),
+        _collector(collector.get()) {}
+
+  /**
+   * Template factory.
+   */
+  template <uint32_t heapSize, uint32_t largeObjectSpaceSize = 0,
+            uint32_t maxHeapSize = 0>
+  static std::shared_ptr<BasicMemoryManager> create() {
+    static_assert(heapSize <= ObjectHeader::MAX_HEAP_SIZE &&
+                      maxHeapSize <= ObjectHeader::MAX_HEAP_SIZE,
+                  "Heap is too large for the object header, "
+                  "see MMGC_LARGE_HEAP.");
+    auto limit = std::max(heapSize, maxHeapSize);
+    auto heap = std::make_shared<Heap>(
+        heapSize,
+        largeObjectSpaceSize > 0
+            ? LargeObjectSpace::reservedSize(limit, largeObjectSpaceSize)
+            : 0,
+        limit);
+    auto allocator = std::make_shared<Allocator>(heap);
+    auto collector = std::make_shared<Collector>(allocator);
+
+    // The mark (and sweep) loops call the concrete allocator.
+    collector->template bindAllocator<Allocator>();
+
+    auto mm =
+        std::make_shared<BasicMemoryManager>(heap, allocator, collector);
+
+    if (largeObjectSpaceSize > 0) {
+      mm->largeObjects = std::make_shared<LargeObjectSpace>(heap);
+      collector->largeObjects = mm->largeObjects;
+    }
+
+    return mm;
+  }
+
+  /**
+   * Writes a Value at address.
+   */
+  inline void writeValue(Word address, uint32_t value,
+                         Type valueType) override {
+    writeWord(address, Value::encode(value, valueType));
+  }
+
+  /**
+   * Writes a word at address. The word may be read as a pointer by the
+   * collectors, so it's a store through the barrier as well.
+   */
+  inline void writeWord(Word address, Word word) override {
+    Value value(word);
+    writeValue(address, value);
+  }
+
+  /**
+   * Allocates a memory chunk with an object header (see
+   * `MemoryManager::allocate`).
+   */
+  inline Value allocate(uint32_t n) override {
+    if (types != nullptr) {
+      return allocate(n, TypeTable::CONSERVATIVE);
+    }
+    return _allocateCollecting(n);
+  }
+
+  /**
+   * Allocates an object of the type, which is traced by its pointer bitmap.
+   */
+  inline Value allocate(uint32_t n, TypeId type) override {
+    auto object = _allocateCollecting(n);
+
+    if (!object.isNullPointer()) {
+      _getTypes()->setType(object, type);
+    }
+
+    return object;
+  }
+
+  /**
+   * Frees previously allocated block.
+   */
+  inline void free(Word address) override {
+    if (_isLargeObject(address)) {
+      largeObjects->free(address);
+    } else if (nursery != nullptr && nursery->contains(address)) {
+      nursery->free(address);
+    } else {
+      _allocator->Allocator::free(address);
+    }
+  }
+
+  /**
+   * Returns object header.
+   */
+  inline ObjectHeader* getHeader(Word address) override {
+    if (_isLargeObject(address)) {
+      return largeObjects->getHeader(address);
+    }
+    return _allocator->Allocator::getHeader(address);
+  }
+
+  /**
+   * Sizeof operator.
+   */
+  inline uint32_t sizeOf(Word address) override {
+    if (_isLargeObject(address)) {
+      return largeObjects->sizeOf(address);
+    }
+    return _allocator->Allocator::getHeader(address)->size;
+  }
+
+  /**
+   * Calls the `visitor` for each child pointer of the object. A typed
+   * object is traced by its pointer bitmap.
+   */
+  template <typename Visitor>
+  void forEachPointer(Word address, Visitor visitor) {
+    if (types != nullptr) {
+      auto type = types->getType(address);
+      if (type != TypeTable::CONSERVATIVE) {
+        types->forEachPointer(address, type, sizeOf(address) / sizeof(Word),
+                              visitor);
+        return;
+      }
+    }
+    if (_isLargeObject(address)) {
+      largeObjects->forEachPointer(address, visitor);
+      return;
+    }
+    _allocator->forEachPointer(
+        address, _allocator->Allocator::getHeader(address)->size, visitor);
+  }
+
+  /**
+   * Returns child pointers of this object.
+   */
+  std::vector<Value*> getPointers(Word address) override {
+    std::vector<Value*> pointers;
+    forEachPointer(address, [&](Value* p) { pointers.push_back(p); });
+    return pointers;
+  }
+
+  /**
+   * Writes a Value at address, calling the barrier first.
+   */
+  inline void writeValue(Word address, Value& value) override {
+    auto slot = (Value*)heap->asWordPointer(address);
+    Barrier::onWrite(_collector, address, slot, value);
+    *slot = value;
+  }
+
+  /**
+   * Writes a Value at address, calling the barrier first.
+   */
+  inline void writeValue(Word address, Value&& value) override {
+    writeValue(address, value);
+  }
+
+  /**
+   * Runs a collection cycle.
+   */
+  std::shared_ptr<GCStats> collect() override {
+    _checkBarrier(false);
+
+    auto stats = _collector->Collector::collect();
+    _allocatedBytes = 0;
+    _resizeHeap();
+
+    return stats;
+  }
+
+  /**
+   * Runs a full collection cycle.
+   */
+  std::shared_ptr<GCStats> collectFull() override {
+    _checkBarrier(false);
+    return MemoryManager::collectFull();
+  }
+
+  /**
+   * Runs a bounded step of the collection cycle.
+   */
+  bool collectStep(uint32_t budget) override {
+    _checkBarrier(true);
+    return MemoryManager::collectStep(budget);
+  }
+
+ private:
+  /**
+   * The concrete allocator (the same object as `allocator`).
+   */
+  Allocator* _allocator;
+
+  /**
+   * The concrete collector (the same object as `collector`).
+   */
+  Collector* _collector;
+
+  /**
+   * The MarkSweepGC accepts `NoBarrier` only for the stop-the-world
+   * collections: the concurrent, and the incremental marks would miss
+   * the pointers moved by the mutator, and reclaim live objects.
+   */
+  void _checkBarrier(bool incremental) {
+    if constexpr (std::is_same_v<Collector, MarkSweepGC> &&
+                  std::is_same_v<Barrier, NoBarrier>) {
+      if (incremental || _collector->concurrentMark) {
+        throw std::runtime_error(
+            "MarkSweepGC: the concurrent, and incremental marks need "
+            "a write barrier, see WriteBarrier.h.");
+      }
+    }
+  }
+
+  /**
+   * Allocation with the automatic collections (the retries
+   * are the slow path of the base class).
+   */
+  inline Value _allocateCollecting(uint32_t n) {
+    if (allocationThreshold != 0) {
+      _countAllocation(n);
+    }
+
+    auto object = _allocate(n);
+
+    if (object.isNullPointer()) {
+      return _retryAllocation(n);
+    }
+    return object;
+  }
+
+  /**
+   * Allocation of an untyped object.
+   */
+  inline Value _allocate(uint32_t n) {
+    if (largeObjects != nullptr && n > largeObjects->threshold) {
+      return _allocateLarge(n);
+    }
+    if (_collector->sweepPending || _collector->markPending ||
+        _collector->allocationHookEnabled) {
+      return _allocateReported(n);
+    }
+    if (nursery != nullptr) {
+      return _allocateYoung(n);
+    }
+    return _allocator->Allocator::allocate(n);
+  }
+};
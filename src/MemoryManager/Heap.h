@@ -6,11 +6,16 @@
 #pragma once
 
 #include <stdint.h>
+#include <cstring>
+#include <algorithm>
 #include <iostream>
+#include <stdexcept>
 #include <vector>
 
 #include "../util/number-util.h"
 
+#include "HeapStorage.h"
+
 /**
  * 32 bit machine word.
  */
@@ -19,28 +24,99 @@ using Word = uint32_t;
 /**
  * Virtual heap storage with convenient methods of converting
  * between physical, and virtual pointers.
+ *
+ * The storage is mapped from the OS (see HeapStorage): it's committed
+ * lazily, and the reset drops the pages, so neither the creation, nor
+ * the reset of the heap is proportional to its size.
+ *
+ * The storage may reserve an extra region after the heap, managed
+ * by the LargeObjectSpace, and further regions (e.g. the nursery of
+ * a generational collector) reserved after it. The allocators, and
+ * the heap walkers only see the first `size()` bytes.
+ *
+ * An elastic heap reserves the address range up to its `limit()`
+ * (only committed when used), and its size changes within it, so the
+ * regions after the heap start at the limit, and the side tables
+ * (e.g. the mark bitmap) should cover the whole limit:
+ *
+ *  +-------------+.........+-----------------+---------+
+ *  | Heap        :         | Large obj.      | Nursery |
+ *  +-------------+.........+-----------------+---------+
+ *                ^         ^
+ *                size()    limit()
  */
 struct Heap {
-  std::vector<uint8_t> storage;
+  HeapStorage storage;
 
-  Heap(uint32_t size) : storage(size, 0) {}
+  Heap(uint32_t size, uint32_t largeObjectSpaceSize = 0, uint32_t limit = 0)
+      : storage(std::max(size, limit) + largeObjectSpaceSize),
+        _size(size),
+        _limit(std::max(size, limit)),
+        _largeObjectSpaceEnd(_limit + largeObjectSpaceSize) {}
 
   uint8_t& operator[](int offset) { return storage[offset]; }
 
   /**
    * Returns the size of the heap.
    */
-  uint32_t size() { return storage.size(); }
+  uint32_t size() { return _size; }
+
+  /**
+   * Returns the largest size of the (elastic) heap.
+   */
+  uint32_t limit() { return _limit; }
+
+  /**
+   * Changes the size of the heap, up to the limit. The memory after
+   * the end is kept, until it's released with `releaseUnused`.
+   */
+  void resize(uint32_t size) {
+    if (size > _limit) {
+      throw std::length_error("Heap size is above the limit.");
+    }
+    _size = size;
+  }
+
+  /**
+   * Returns the memory after the end of the heap (up to the limit)
+   * to the OS, it reads as zeros.
+   */
+  void releaseUnused() { storage.release(_size, _limit - _size); }
+
+  /**
+   * Returns the size of the storage, including the large object space.
+   */
+  uint32_t totalSize() { return storage.size(); }
+
+  /**
+   * Returns the end of the large object space region.
+   */
+  uint32_t largeObjectSpaceEnd() { return _largeObjectSpaceEnd; }
+
+  /**
+   * Reserves a region of `n` bytes at the end of the storage,
+   * and returns its (word aligned) start address.
+   *
+   * The storage is reallocated, so the physical pointers
+   * to the heap are invalidated.
+   */
+  Word reserve(uint32_t n) {
+    auto start = align<Word>(storage.size());
+    storage.resize(start + n);
+    return start;
+  }
 
   /**
    * Returns an actual Word pointer for the virtual pointer address.
    */
-  Word* asWordPointer(Word address) { return (Word*)&storage[address]; }
+  Word* asWordPointer(Word address) {
+    return (Word*)(storage.data() + address);
+  }
 
   /**
    * Returns an actual byte pointer for the virtual pointer address.
    */
-  uint8_t* asBytePointer(Word address) { return &storage[address]; }
+  uint8_t* asBytePointer(Word address) { return storage.data() + address; }
 
   /**
    * Converts an actual Word pointer to the virtual address.
@@ -52,7 +128,12 @@ struct Heap {
   /**
    * Resets this heap.
    */
-  void reset() { memset(&storage[0], 0, storage.size()); }
+  void reset() { storage.clear(); }
+
+  /**
+   * Backs the heap with the transparent huge pages, if supported.
+   */
+  void useHugePages() { storage.useHugePages(); }
 
   /**
    * Dumps the heap memory.
@@ -80,4 +161,20 @@ struct Heap {
 
     std::cout << std::endl;
   }
+
+ private:
+  /**
+   * Size of the heap (without the large object space).
+   */
+  uint32_t _size;
+
+  /**
+   * Largest size of the heap (the large object space starts after it).
+   */
+  uint32_t _limit;
+
+  /**
+   * End of the large object space region.
+   */
+  uint32_t _largeObjectSpaceEnd;
 };
\ No newline at end of file
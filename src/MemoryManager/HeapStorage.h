@@ -0,0 +1,192 @@
+/**
+ * The MIT License (MIT)
+ * Copyright (c) 2018-present Dmitry Soshnikov <dmitry.soshnikov@gmail.com>
+ */
+
+#pragma once
+
+#include <stdint.h>
+#include <sys/mman.h>
+#include <unistd.h>
+#include <algorithm>
+#include <cstring>
+#include <new>
+
+/**
+ * Byte storage of the heap, mapped directly from the OS.
+ *
+ * The anonymous mapping only reserves the address space: a page is
+ * committed (and zero-filled by the kernel) on the first access, so the
+ * construction time, and the resident memory don't depend on the nominal
+ * heap size, only on the touched pages.
+ *
+ * Clearing drops the pages (they're committed again as the zero pages
+ * on the next access), instead of writing zeros to all of them. Small
+ * storages (under `DROP_THRESHOLD`) are cleared in place, which is
+ * cheaper than the system call.
+ *
+ * Optionally the mapping is advised to be backed by the transparent
+ * huge pages (fewer TLB misses in the traversal of large heaps).
+ */
+class HeapStorage {
+ public:
+  /**
+   * Storages from this size are cleared by dropping the pages.
+   */
+  static constexpr uint32_t DROP_THRESHOLD = 64 * 1024;
+
+  HeapStorage(uint32_t size) : _size(0), _mappedSize(0), _hugePages(false) {
+    _map(std::max(size, 1u));
+    _size = size;
+  }
+
+  ~HeapStorage() { munmap(_data, _mappedSize); }
+
+  HeapStorage(const HeapStorage&) = delete;
+  HeapStorage& operator=(const HeapStorage&) = delete;
+
+  uint8_t& operator[](uint32_t offset) { return _data[offset]; }
+
+  /**
+   * Returns the first byte of the storage.
+   */
+  uint8_t* data() { return _data; }
+
+  /**
+   * Returns the size of the storage.
+   */
+  uint32_t size() { return _size; }
+
+  /**
+   * Resizes the storage, the new bytes are zero. The mapping may
+   * be moved, so the physical pointers are invalidated.
+   */
+  void resize(uint32_t size) {
+    if (size > _mappedSize) {
+      _remap(size);
+    } else if (size < _size) {
+      // Zero, if the storage grows again.
+      release(size, _size - size);
+    }
+    _size = size;
+  }
+
+  /**
+   * Sets all bytes to zero.
+   */
+  void clear() {
+    if (_size < DROP_THRESHOLD) {
+      memset(_data, 0, _size);
+      return;
+    }
+    release(0, _size);
+  }
+
+  /**
+   * Sets the bytes of the range to zero: the whole pages of the range
+   * are dropped, and the partial ones are cleared in place.
+   */
+  void release(uint32_t offset, uint32_t size) {
+    size_t end = (size_t)offset + size;
+    auto first = std::min(_pageAlign(offset), end);
+    auto last = std::max(first, end / _pageSize() * _pageSize());
+
+    memset(_data + offset, 0, first - offset);
+    if (last > first) {
+      _drop(first, last - first);
+    }
+    memset(_data + last, 0, end - last);
+  }
+
+  /**
+   * Advises the kernel to back the storage with the transparent huge
+   * pages (no-op, if they're not supported).
+   */
+  void useHugePages() {
+    _hugePages = true;
+    _adviseHugePages();
+  }
+
+ private:
+  /**
+   * Mapped memory.
+   */
+  uint8_t* _data;
+
+  /**
+   * Size of the storage.
+   */
+  uint32_t _size;
+
+  /**
+   * Size of the mapping (whole pages).
+   */
+  size_t _mappedSize;
+
+  /**
+   * Whether the huge pages are requested.
+   */
+  bool _hugePages;
+
+  static size_t _pageSize() {
+    static const size_t pageSize = sysconf(_SC_PAGESIZE);
+    return pageSize;
+  }
+
+  static size_t _pageAlign(size_t n) {
+    return (n + _pageSize() - 1) / _pageSize() * _pageSize();
+  }
+
+  void _map(uint32_t size) {
+    _mappedSize = _pageAlign(size);
+    auto data = mmap(nullptr, _mappedSize, PROT_READ | PROT_WRITE,
+                     MAP_PRIVATE | MAP_ANONYMOUS | MAP_NORESERVE, -1, 0);
+    if (data == MAP_FAILED) {
+      throw std::bad_alloc();
+    }
+    _data = (uint8_t*)data;
+  }
+
+  /**
+   * Grows the mapping, preserving the contents.
+   */
+  void _remap(uint32_t size) {
+#ifdef __linux__
+    auto mappedSize = _pageAlign(size);
+    auto data = mremap(_data, _mappedSize, mappedSize, MREMAP_MAYMOVE);
+    if (data == MAP_FAILED) {
+      throw std::bad_alloc();
+    }
+    _data = (uint8_t*)data;
+    _mappedSize = mappedSize;
+#else
+    auto oldData = _data;
+    auto oldMappedSize = _mappedSize;
+    _map(size);
+    memcpy(_data, oldData, _size);
+    munmap(oldData, oldMappedSize);
+#endif
+    if (_hugePages) {
+      _adviseHugePages();
+    }
+  }
+
+  /**
+   * Drops the pages of the range (page aligned), so they read as zeros.
+   */
+  void _drop(size_t offset, size_t size) {
+#ifdef __linux__
+    madvise(_data + offset, size, MADV_DONTNEED);
+#else
+    // Map the fresh zero pages over the range.
+    mmap(_data + offset, size, PROT_READ | PROT_WRITE,
+         MAP_PRIVATE | MAP_ANONYMOUS | MAP_NORESERVE | MAP_FIXED, -1, 0);
+#endif
+  }
+
+  void _adviseHugePages() {
+#ifdef MADV_HUGEPAGE
+    madvise(_data, _mappedSize, MADV_HUGEPAGE);
+#endif
+  }
+};
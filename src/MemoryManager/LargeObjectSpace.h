@@ -0,0 +1,321 @@
+/**
+ * The MIT License (MIT)
+ * Copyright (c) 2018-present Dmitry Soshnikov <dmitry.soshnikov@gmail.com>
+ */
+
+#pragma once
+
+#include <stdint.h>
+#include <iterator>
+#include <map>
+#include <memory>
+#include <mutex>
+#include <stdexcept>
+#include <vector>
+
+#include "../Value/Value.h"
+#include "../util/number-util.h"
+
+#include "Heap.h"
+#include "ObjectHeader.h"
+
+/**
+ * Large object space.
+ *
+ * Objects above the `threshold` are not allocated in the heap, but
+ * get their own page-aligned chunks in the storage region after it:
+ *
+ *  +------------+--+----------------+----------------+------------+
+ *  | Heap       |  | Hdr | Object   | Hdr | Object   |    Free    |
+ *  +------------+--+----------------+----------------+------------+
+ *               ^  ^                ^
+ *  heap->limit()   Page             Page
+ *
+ * The large objects are never moved by a compacting collector, and
+ * don't fragment the free lists of the heap. The collectors mark them
+ * in place (the mark bit is in the chunk header), and the `sweep`
+ * returns the unmarked ones to the chunk free list.
+ *
+ * The header `size` can't record the size of a large object, so
+ * the sizes are kept in the object table. The tables are guarded by
+ * a lock, since a concurrent marker reads them while the mutator
+ * allocates.
+ *
+ * The pages of a freed object are returned to the OS (they're committed
+ * again as the zero pages, when the chunk is reused).
+ */
+struct LargeObjectSpace {
+  /**
+   * Chunk granularity.
+   */
+  static constexpr uint32_t PAGE_SIZE = 4096;
+
+  /**
+   * Objects above this size are allocated in the large object space.
+   */
+  static constexpr uint32_t DEFAULT_THRESHOLD =
+      ObjectHeader::MAX_SIZE < 2048 ? ObjectHeader::MAX_SIZE : 2048;
+
+  /**
+   * Associated heap, which reserves the storage for this space.
+   */
+  std::shared_ptr<Heap> heap;
+
+  /**
+   * Allocation size threshold.
+   */
+  uint32_t threshold;
+
+  LargeObjectSpace(std::shared_ptr<Heap> heap,
+                   uint32_t threshold = DEFAULT_THRESHOLD)
+      : heap(heap), threshold(threshold) {
+    reset();
+  }
+
+  /**
+   * Size of the storage the heap should reserve after itself, to fit
+   * `spaceSize` bytes of pages (the first page is aligned).
+   */
+  static uint32_t reservedSize(uint32_t heapSize, uint32_t spaceSize) {
+    return _pages(heapSize) - heapSize + spaceSize;
+  }
+
+  /**
+   * Whether the address belongs to the large object space.
+   */
+  bool contains(Word address) {
+    return address >= heap->limit() && address < heap->largeObjectSpaceEnd();
+  }
+
+  /**
+   * Allocates a chunk of whole pages for the object, using the first
+   * fit among the free chunks. The chunk starts with the object header.
+   *
+   * Value::Pointer(nullptr) payload signals OOM.
+   */
+  Value allocate(uint32_t n) {
+    std::lock_guard<std::mutex> lock(_mutex);
+
+    n = align<Word>(n);
+    auto chunkSize = _pages(n + sizeof(ObjectHeader));
+
+    for (auto it = _freeChunks.begin(); it != _freeChunks.end(); it++) {
+      auto chunk = it->first;
+      auto size = it->second;
+
+      if (size < chunkSize) {
+        continue;
+      }
+
+      _freeChunks.erase(it);
+
+      if (size > chunkSize) {
+        _freeChunks[chunk + chunkSize] = size - chunkSize;
+      }
+
+      *(ObjectHeader*)heap->asBytePointer(chunk) = ObjectHeader{.used = 1};
+
+      auto payload = chunk + sizeof(ObjectHeader);
+      _objects[payload] = n;
+
+      return Value::Pointer(payload);
+    }
+
+    return Value::Pointer(nullptr);
+  }
+
+  /**
+   * Returns the chunk of the object to the free chunks, merging it
+   * with the adjacent free chunks. The chunk pages are released.
+   * Throws, if there is no object at the `address` (e.g. it's freed
+   * twice), so the free chunks are not corrupted.
+   */
+  void free(Word address) {
+    std::lock_guard<std::mutex> lock(_mutex);
+    _free(address);
+  }
+
+  /**
+   * Returns the reference to the object header.
+   */
+  ObjectHeader* getHeader(Word address) {
+    return (ObjectHeader*)(heap->asBytePointer(address) - sizeof(ObjectHeader));
+  }
+
+  /**
+   * Returns the object size.
+   */
+  uint32_t sizeOf(Word address) {
+    std::lock_guard<std::mutex> lock(_mutex);
+    return _objects.at(address);
+  }
+
+  /**
+   * Returns the payload address of the object, which contains
+   * the `address`, or 0 if it's not in an object.
+   */
+  Word findObject(Word address) {
+    std::lock_guard<std::mutex> lock(_mutex);
+
+    auto it = _objects.upper_bound(address);
+    if (it == _objects.begin()) {
+      return 0;
+    }
+
+    it = std::prev(it);
+    return address < it->first + it->second ? it->first : 0;
+  }
+
+  /**
+   * Returns child pointers of this object.
+   */
+  std::vector<Value*> getPointers(Word address) {
+    std::vector<Value*> pointers;
+    forEachPointer(address, [&](Value* v) { pointers.push_back(v); });
+    return pointers;
+  }
+
+  /**
+   * Calls the `visitor` for each child pointer of this object.
+   */
+  template <typename Visitor>
+  void forEachPointer(Word address, Visitor visitor) {
+    auto words = sizeOf(address) / sizeof(Word);
+
+    while (words-- > 0) {
+      auto v = (Value*)heap->asWordPointer(address);
+      address += sizeof(Word);
+      if (!v->isPointer() || v->isNullPointer()) {
+        continue;
+      }
+      visitor(v);
+    }
+  }
+
+  /**
+   * Calls the `callback` with the address of each large object. The
+   * callback is called without the lock (it may call the space).
+   */
+  template <typename Callback>
+  void forEachObject(Callback callback) {
+    std::vector<Word> objects;
+    {
+      std::lock_guard<std::mutex> lock(_mutex);
+      objects.reserve(_objects.size());
+      for (const auto& object : _objects) {
+        objects.push_back(object.first);
+      }
+    }
+
+    for (const auto& address : objects) {
+      callback(address);
+    }
+  }
+
+  /**
+   * Returns total amount of large objects.
+   */
+  uint32_t getObjectCount() {
+    std::lock_guard<std::mutex> lock(_mutex);
+    return _objects.size();
+  }
+
+  /**
+   * Sweep phase for the large objects: resets the mark bit of
+   * the alive objects, and frees the rest. Returns the number
+   * of reclaimed objects.
+   */
+  uint32_t sweep() {
+    std::lock_guard<std::mutex> lock(_mutex);
+    std::vector<Word> garbage;
+
+    for (const auto& object : _objects) {
+      auto header = getHeader(object.first);
+      if (header->mark == 1) {
+        header->mark = 0;
+      } else {
+        garbage.push_back(object.first);
+      }
+    }
+
+    for (const auto& address : garbage) {
+      _free(address);
+    }
+
+    return garbage.size();
+  }
+
+  /**
+   * Resets the space: all the pages after the heap are free.
+   */
+  void reset() {
+    std::lock_guard<std::mutex> lock(_mutex);
+
+    _objects.clear();
+    _freeChunks.clear();
+
+    auto start = _pages(heap->limit());
+    auto end = heap->largeObjectSpaceEnd() / PAGE_SIZE * PAGE_SIZE;
+
+    if (end > start) {
+      _freeChunks[start] = end - start;
+    }
+  }
+
+ private:
+  /**
+   * Object table: payload address -> object size.
+   */
+  std::map<Word, uint32_t> _objects;
+
+  /**
+   * Free chunks: chunk address -> chunk size, in the address order.
+   */
+  std::map<Word, uint32_t> _freeChunks;
+
+  std::mutex _mutex;
+
+  /**
+   * Frees the object (the lock is held by the caller).
+   */
+  void _free(Word address) {
+    auto object = _objects.find(address);
+    if (object == _objects.end()) {
+      throw std::invalid_argument("LargeObjectSpace::free: unknown object.");
+    }
+
+    auto chunk = address - sizeof(ObjectHeader);
+    auto size = _pages(object->second + sizeof(ObjectHeader));
+    _objects.erase(object);
+
+    // The whole pages go back to the OS, instead of being written
+    // to with zeros.
+    heap->storage.release(chunk, size);
+
+    // Merge with the next free chunk.
+    auto next = _freeChunks.find(chunk + size);
+    if (next != _freeChunks.end()) {
+      size += next->second;
+      _freeChunks.erase(next);
+    }
+
+    // Merge with the previous free chunk.
+    auto it = _freeChunks.lower_bound(chunk);
+    if (it != _freeChunks.begin()) {
+      auto prev = std::prev(it);
+      if (prev->first + prev->second == chunk) {
+        prev->second += size;
+        return;
+      }
+    }
+
+    _freeChunks[chunk] = size;
+  }
+
+  /**
+   * Rounds the size up to the whole pages.
+   */
+  static uint32_t _pages(uint32_t n) {
+    return (n + PAGE_SIZE - 1) / PAGE_SIZE * PAGE_SIZE;
+  }
+};
@@ -9,8 +9,17 @@
  * Resets the memory setting each word to 0.
  */
 void MemoryManager::reset() {
+  heap->resize(_chunkSize);
   heap->reset();
   allocator->reset();
+
+  if (largeObjects != nullptr) {
+    largeObjects->reset();
+  }
+
+  if (nursery != nullptr) {
+    nursery->reset();
+  }
 }
 
 /**
@@ -43,10 +52,12 @@ Word* MemoryManager::asWordPointer(Word address) {
 }
 
 /**
- * Writes a word at address.
+ * Writes a word at address. The word may be read as a pointer by the
+ * collectors, so it's a store through the barrier as well.
  */
-void MemoryManager::writeWord(Word address, Word value) {
-  *asWordPointer(address) = value;
+void MemoryManager::writeWord(Word address, Word word) {
+  Value value(word);
+  writeValue(address, value);
 }
 
 /**
@@ -79,20 +90,21 @@ void MemoryManager::writeValue(Word address, Word value, Type valueType) {
  * Writes a Value at address.
  */
 void MemoryManager::writeValue(uint32_t address, Value& value) {
+  if (collector != nullptr &&
+      (collector->markPending || collector->writeBarrierEnabled)) {
+    collector->onWrite(address, value);
+  }
   if (writeBarrier_ != nullptr) {
     writeBarrier_(address, value);
   }
-  writeWord(address, value);
+  *readValue(address) = value;
 }
 
 /**
  * Writes a Value at address.
  */
 void MemoryManager::writeValue(uint32_t address, Value&& value) {
-  if (writeBarrier_ != nullptr) {
-    writeBarrier_(address, value);
-  }
-  writeWord(address, value);
+  writeValue(address, value);
 }
 
 /**
@@ -102,23 +114,19 @@ Value* MemoryManager::readValue(uint32_t address) {
   return (Value*)asWordPointer(address);
 }
 
-/**
- * Allocates a memory chunk with an object header.
- * The payload pointer is set to the first byte (after the header).
- *
- * This returns a "virtual pointer" (Value::Pointer), the byte address in
- * the virtual heap. To convert it to C++ pointer, use `asWordPointer(p)` or
- * `asBytePointer(p)`.
- *
- * Value::Pointer(nullptr) payload signals OOM.
- */
-Value MemoryManager::allocate(uint32_t n) { return allocator->allocate(n); }
-
 /**
  * Frees previously allocated block. The block should contain
  * correct object header, otherwise the result is not defined.
  */
-void MemoryManager::free(Word address) { allocator->free(address); }
+void MemoryManager::free(Word address) {
+  if (_isLargeObject(address)) {
+    largeObjects->free(address);
+  } else if (nursery != nullptr && nursery->contains(address)) {
+    nursery->free(address);
+  } else {
+    allocator->free(address);
+  }
+}
 
 /**
  * Runs a collection cycle.
@@ -128,36 +136,304 @@ std::shared_ptr<GCStats> MemoryManager::collect() {
     throw std::runtime_error("Collector is not specified.");
   }
 
-  return collector->collect();
+  auto stats = collector->collect();
+  _allocatedBytes = 0;
+  _resizeHeap();
+
+  return stats;
+}
+
+/**
+ * Runs a full collection cycle.
+ */
+std::shared_ptr<GCStats> MemoryManager::collectFull() {
+  if (!collector) {
+    throw std::runtime_error("Collector is not specified.");
+  }
+
+  auto stats = collector->collectFull();
+  _allocatedBytes = 0;
+  _resizeHeap();
+
+  return stats;
+}
+
+/**
+ * Runs a bounded step of the collection cycle. Returns true
+ * if the cycle is not finished yet.
+ */
+bool MemoryManager::collectStep(uint32_t budget) {
+  if (!collector) {
+    throw std::runtime_error("Collector is not specified.");
+  }
+
+  if (collector->collectStep(budget)) {
+    return true;
+  }
+
+  _allocatedBytes = 0;
+  _resizeHeap();
+  return false;
 }
 
 /**
  * Returns object header.
  */
 ObjectHeader* MemoryManager::getHeader(Word address) {
+  if (_isLargeObject(address)) {
+    return largeObjects->getHeader(address);
+  }
   return allocator->getHeader(address);
 }
 
 /**
  * Sizeof operator.
  */
-uint16_t MemoryManager::sizeOf(Word address) {
+uint32_t MemoryManager::sizeOf(Word address) {
+  if (_isLargeObject(address)) {
+    return largeObjects->sizeOf(address);
+  }
   return getHeader(address)->size;
 }
 
 /**
- * Returns child pointers of this object.
+ * Returns child pointers of this object. A typed object
+ * is traced by its pointer bitmap.
  */
 std::vector<Value*> MemoryManager::getPointers(Word address) {
+  if (types != nullptr) {
+    auto type = types->getType(address);
+    if (type != TypeTable::CONSERVATIVE) {
+      return types->getPointers(address, type, sizeOf(address) / sizeof(Word));
+    }
+  }
+  if (_isLargeObject(address)) {
+    return largeObjects->getPointers(address);
+  }
   return allocator->getPointers(address);
 }
 
 /**
  * Returns total amount of objects on the heap.
  */
-uint32_t MemoryManager::getObjectCount() { return allocator->getObjectCount(); }
+uint32_t MemoryManager::getObjectCount() {
+  auto count = allocator->getObjectCount();
+
+  if (largeObjects != nullptr) {
+    count += largeObjects->getObjectCount();
+  }
+
+  if (nursery != nullptr) {
+    count += nursery->getObjectCount();
+  }
+  return count;
+}
+
+/**
+ * Whether the object is in the large object space.
+ */
+bool MemoryManager::_isLargeObject(Word address) {
+  return largeObjects != nullptr && largeObjects->contains(address);
+}
+
+/**
+ * Grows the elastic heap by a chunk, when its occupancy after the
+ * collection is high, so the next collections are less frequent.
+ * Shrinks it, when the occupancy stays low for several collections,
+ * giving the chunk back to the OS. The decision is deferred while
+ * the lazy sweep is pending (the free memory is not known yet).
+ */
+void MemoryManager::_resizeHeap() {
+  auto size = heap->size();
+
+  if (heap->limit() == _chunkSize || collector->sweepPending ||
+      collector->markPending) {
+    return;
+  }
+
+  auto occupancy = (double)(size - allocator->getFreeSize()) / size;
+
+  if (occupancy > growThreshold) {
+    _lowOccupancyCount = 0;
+    if (size + _chunkSize <= heap->limit()) {
+      _resizeHeapTo(size + _chunkSize);
+    }
+    return;
+  }
+
+  if (occupancy < shrinkThreshold && size > _chunkSize) {
+    if (++_lowOccupancyCount >= shrinkDelay) {
+      _lowOccupancyCount = 0;
+      _resizeHeapTo(size - _chunkSize);
+    }
+    return;
+  }
+
+  _lowOccupancyCount = 0;
+}
+
+/**
+ * Resizes the heap, and the allocator. The released memory
+ * is returned to the OS.
+ */
+bool MemoryManager::_resizeHeapTo(uint32_t size) {
+  auto oldSize = heap->size();
+  heap->resize(size);
+
+  if (!allocator->resize(oldSize)) {
+    heap->resize(oldSize);
+    return false;
+  }
+
+  heap->releaseUnused();
+  return true;
+}
 
 /**
  * Prints memory dump.
  */
 void MemoryManager::dump() { heap->dump(); }
+
+/**
+ * Allocates an object of the type, which is traced by its pointer bitmap.
+ */
+Value MemoryManager::allocate(uint32_t n, TypeId type) {
+  auto object = _allocateCollecting(n);
+
+  if (!object.isNullPointer()) {
+    _getTypes()->setType(object, type);
+  }
+
+  return object;
+}
+
+/**
+ * Registers the object type with the pointer bitmap.
+ */
+TypeId MemoryManager::registerType(const std::vector<uint64_t>& pointerBitmap) {
+  return _getTypes()->registerType(pointerBitmap);
+}
+
+/**
+ * Returns the type table, creating it on the first use, so the untyped
+ * allocations don't pay for the types. It's shared with the collector.
+ */
+std::shared_ptr<TypeTable>& MemoryManager::_getTypes() {
+  if (types == nullptr) {
+    types = std::make_shared<TypeTable>(heap);
+
+    if (collector != nullptr) {
+      collector->types = types;
+    }
+  }
+
+  return types;
+}
+
+/**
+ * The collection runs before the allocation, which crosses the
+ * threshold, so the new object (not reachable yet) survives it.
+ */
+void MemoryManager::_countAllocation(uint32_t n) {
+  _allocatedBytes += n;
+
+  if (_allocatedBytes > allocationThreshold && collector != nullptr) {
+    _collectAuto(fullCollection);
+  }
+}
+
+/**
+ * Each retry runs a collection. A minor collection doesn't reclaim
+ * the old space, so the last one is full.
+ */
+Value MemoryManager::_retryAllocation(uint32_t n) {
+  auto object = Value::Pointer(nullptr);
+
+  if (collector != nullptr) {
+    for (uint32_t retry = 1; retry <= allocationRetries; retry++) {
+      _collectAuto(fullCollection || retry == allocationRetries);
+
+      object = _allocate(n);
+      if (!object.isNullPointer()) {
+        return object;
+      }
+    }
+  }
+
+  if (onOutOfMemory != nullptr) {
+    onOutOfMemory(n);
+  }
+
+  return object;
+}
+
+/**
+ * Runs the automatic collection (the elastic heap may grow after it).
+ */
+void MemoryManager::_collectAuto(bool full) {
+  if (full) {
+    collectFull();
+  } else {
+    collect();
+  }
+}
+
+/**
+ * Allocation while the lazy sweep is pending: when the allocator runs
+ * out of memory, the next heap regions are swept until the object fits
+ * (a pending concurrent mark is finished first). The collector is
+ * notified about the new object, so it's not reclaimed by the rest
+ * of the sweep, or by the current concurrent cycle (the reference
+ * counting collector tracks all new objects the same way).
+ */
+Value MemoryManager::_allocateReported(uint32_t n) {
+  auto object = allocator->allocate(n);
+
+  while (object.isNullPointer() && collector->sweepNext()) {
+    object = allocator->allocate(n);
+  }
+
+  if (!object.isNullPointer()) {
+    collector->onAllocate(object);
+  }
+
+  return object;
+}
+
+/**
+ * Allocation in the large object space. The objects allocated
+ * during the concurrent mark (or all, if the collector tracks the
+ * allocations) are reported to the collector.
+ */
+Value MemoryManager::_allocateLarge(uint32_t n) {
+  auto object = largeObjects->allocate(n);
+
+  if (!object.isNullPointer() && collector != nullptr &&
+      (collector->markPending || collector->allocationHookEnabled)) {
+    collector->onAllocate(object);
+  }
+
+  return object;
+}
+
+/**
+ * Allocation in the nursery. When it's full, a (minor) collection
+ * evacuates the survivors, and the allocation is retried. The objects,
+ * which don't fit the nursery, are allocated in the heap. The collection
+ * goes through `collect`, so the allocation threshold is reset, and
+ * the elastic old space may grow after the promotion.
+ */
+Value MemoryManager::_allocateYoung(uint32_t n) {
+  auto object = nursery->allocate(n);
+
+  if (object.isNullPointer() && n <= ObjectHeader::MAX_SIZE) {
+    collect();
+    object = nursery->allocate(n);
+  }
+
+  if (object.isNullPointer()) {
+    object = allocator->allocate(n);
+  }
+
+  return object;
+}
@@ -6,8 +6,11 @@
 #pragma once
 
 #include <stdint.h>
+#include <algorithm>
+#include <functional>
 #include <iostream>
 #include <list>
+#include <memory>
 #include <string>
 #include <vector>
 
@@ -15,7 +18,11 @@
 #include "../util/number-util.h"
 
 #include "Heap.h"
+#include "LargeObjectSpace.h"
+#include "Nursery.h"
 #include "ObjectHeader.h"
+#include "RootSet.h"
+#include "TypeTable.h"
 
 #include "../allocators/IAllocator.h"
 #include "../gc/ICollector.h"
@@ -32,6 +39,22 @@
  *                  IAllocator interface
  *
  *   - `collector`: a particular garbage collector
+ *
+ *   - `largeObjects`: optional large object space, the allocations
+ *                     above its threshold are routed to it
+ *
+ *   - `nursery`: the young generation of a generational collector,
+ *                the new objects are allocated in it
+ *
+ *   - `roots`: the handles, and the root ranges of the embedder,
+ *              traced by the collector
+ *
+ *   - `types`: optional type table, the typed objects are traced
+ *              by their pointer bitmaps
+ *
+ * The mutator entry points (the allocation, stores, headers, and the
+ * collection) are virtual, so a manager composed at compile time (see
+ * BasicMemoryManager.h) behaves the same through this interface.
  */
 class MemoryManager {
  public:
@@ -50,6 +73,71 @@ class MemoryManager {
    */
   std::shared_ptr<ICollector> collector;
 
+  /**
+   * Large object space (optional).
+   */
+  std::shared_ptr<LargeObjectSpace> largeObjects;
+
+  /**
+   * Nursery (set by a generational collector).
+   */
+  std::shared_ptr<Nursery> nursery;
+
+  /**
+   * Registered roots.
+   */
+  std::shared_ptr<RootSet> roots;
+
+  /**
+   * Type table (created by the first type registration,
+   * or typed allocation).
+   */
+  std::shared_ptr<TypeTable> types;
+
+  /**
+   * Heap occupancy after a collection, above which the elastic
+   * heap grows by a chunk.
+   */
+  double growThreshold = 0.75;
+
+  /**
+   * Heap occupancy after a collection, below which the elastic
+   * heap shrinks by a chunk...
+   */
+  double shrinkThreshold = 0.25;
+
+  /**
+   * ...if it stays low for this number of collections.
+   */
+  uint32_t shrinkDelay = 3;
+
+  /**
+   * Number of the collections run, when an allocation fails, each
+   * followed by the retry of the allocation (0: the failed allocation
+   * returns the null pointer right away).
+   */
+  uint32_t allocationRetries = 0;
+
+  /**
+   * Bytes allocated since the last collection, after which the next
+   * allocation runs a collection first (0: no threshold).
+   */
+  uint32_t allocationThreshold = 0;
+
+  /**
+   * Whether the automatic collections are full, or minor (the same
+   * for the non-generational collectors). The last retry of a failed
+   * allocation is always full.
+   */
+  bool fullCollection = false;
+
+  /**
+   * Called with the requested size, when the allocation fails after
+   * all retries (e.g. to report, or throw), before the null pointer
+   * is returned.
+   */
+  std::function<void(uint32_t n)> onOutOfMemory;
+
   MemoryManager(
       const std::shared_ptr<Heap> heap,
       const std::shared_ptr<IAllocator> allocator,
@@ -58,35 +146,81 @@ class MemoryManager {
       : heap(heap),
         allocator(allocator),
         collector(collector),
-        writeBarrier_(writeBarrier) {
+        nursery(collector != nullptr ? collector->nursery : nullptr),
+        roots(std::make_shared<RootSet>()),
+        writeBarrier_(writeBarrier),
+        _chunkSize(heap->size()),
+        _lowOccupancyCount(0),
+        _allocatedBytes(0) {
+    if (collector != nullptr) {
+      collector->rootSet = roots;
+    }
     reset();
   }
 
+  virtual ~MemoryManager() {}
+
   /**
    * Template factory.
+   *
+   * With the `maxHeapSize` the heap is elastic: it starts with
+   * `heapSize` bytes, and grows (or shrinks) by `heapSize` chunks,
+   * up to the max size.
    */
-  template <class Allocator, class Collector, uint32_t heapSize>
+  template <class Allocator, class Collector, uint32_t heapSize,
+            uint32_t largeObjectSpaceSize = 0, uint32_t maxHeapSize = 0>
   static std::shared_ptr<MemoryManager> create(
       std::function<void(Word, Value& value)> writeBarrier = nullptr) {
-    auto heap = std::make_shared<Heap>(heapSize);
+    static_assert(heapSize <= ObjectHeader::MAX_HEAP_SIZE &&
+                      maxHeapSize <= ObjectHeader::MAX_HEAP_SIZE,
+                  "Heap is too large for the object header, "
+                  "see MMGC_LARGE_HEAP.");
+    auto limit = std::max(heapSize, maxHeapSize);
+    auto heap = std::make_shared<Heap>(
+        heapSize,
+        largeObjectSpaceSize > 0
+            ? LargeObjectSpace::reservedSize(limit, largeObjectSpaceSize)
+            : 0,
+        limit);
     auto allocator = std::make_shared<Allocator>(heap);
     auto collector = std::make_shared<Collector>(allocator);
 
-    return std::make_shared<MemoryManager>(heap, allocator, collector,
-                                           writeBarrier);
+    auto mm = std::make_shared<MemoryManager>(heap, allocator, collector,
+                                              writeBarrier);
+
+    if (largeObjectSpaceSize > 0) {
+      mm->largeObjects = std::make_shared<LargeObjectSpace>(heap);
+      collector->largeObjects = mm->largeObjects;
+    }
+
+    return mm;
   }
 
   /**
    * Template factory.
    */
-  template <class Allocator, uint32_t heapSize>
+  template <class Allocator, uint32_t heapSize,
+            uint32_t largeObjectSpaceSize = 0>
   static std::shared_ptr<MemoryManager> create(
       std::function<void(Word, Value& value)> writeBarrier = nullptr) {
-    auto heap = std::make_shared<Heap>(heapSize);
+    static_assert(heapSize <= ObjectHeader::MAX_HEAP_SIZE,
+                  "Heap is too large for the object header, "
+                  "see MMGC_LARGE_HEAP.");
+    auto heap = std::make_shared<Heap>(
+        heapSize,
+        largeObjectSpaceSize > 0
+            ? LargeObjectSpace::reservedSize(heapSize, largeObjectSpaceSize)
+            : 0);
     auto allocator = std::make_shared<Allocator>(heap);
 
-    return std::make_shared<MemoryManager>(heap, allocator, nullptr,
-                                           writeBarrier);
+    auto mm = std::make_shared<MemoryManager>(heap, allocator, nullptr,
+                                              writeBarrier);
+
+    if (largeObjectSpaceSize > 0) {
+      mm->largeObjects = std::make_shared<LargeObjectSpace>(heap);
+    }
+
+    return mm;
   }
 
   /**
@@ -120,9 +254,9 @@ class MemoryManager {
   Word* asWordPointer(Word address);
 
   /**
-   * Writes a word at address.
+   * Writes a word at address (through the write barrier).
    */
-  void writeWord(uint32_t address, uint32_t value);
+  virtual void writeWord(uint32_t address, uint32_t value);
 
   /**
    * Reads a word at address.
@@ -142,17 +276,17 @@ class MemoryManager {
   /**
    * Writes a Value at address.
    */
-  void writeValue(Word address, uint32_t value, Type valueType);
+  virtual void writeValue(Word address, uint32_t value, Type valueType);
 
   /**
    * Writes a Value at address.
    */
-  void writeValue(Word address, Value& value);
+  virtual void writeValue(Word address, Value& value);
 
   /**
    * Writes a Value at address.
    */
-  void writeValue(Word address, Value&& value);
+  virtual void writeValue(Word address, Value&& value);
 
   /**
    * Reads a Value at address.
@@ -168,29 +302,70 @@ class MemoryManager {
    * `asBytePointer(p)`.
    *
    * Value::Pointer(nullptr) payload signals OOM.
+   *
+   * The allocator is called through its interface (the BasicMemoryManager
+   * calls it directly, inlining e.g. the bump pointer allocation).
+   * The objects above the large object threshold are allocated in
+   * the large object space, and the rest in the nursery, if the
+   * collector is generational.
+   *
+   * Once there is a type table, the object gets the conservative type
+   * (each word is tested when traced).
+   *
+   * A collection is run automatically, once the `allocationThreshold`
+   * is crossed, and on the failure (see `allocationRetries`).
    */
-  Value allocate(uint32_t n);
+  inline virtual Value allocate(uint32_t n) {
+    if (types != nullptr) {
+      return allocate(n, TypeTable::CONSERVATIVE);
+    }
+    return _allocateCollecting(n);
+  }
+
+  /**
+   * Allocates an object of the type (registered with `registerType`,
+   * or the `TypeTable::LEAF`), which is traced by its pointer bitmap.
+   */
+  virtual Value allocate(uint32_t n, TypeId type);
+
+  /**
+   * Registers the object type with the pointer bitmap (bit `i` is set,
+   * if the payload word `i` is a pointer). Returns the type id.
+   */
+  TypeId registerType(const std::vector<uint64_t>& pointerBitmap);
 
   /**
    * Frees previously allocated block. The block should contain
    * correct object header, otherwise the result is not defined.
    */
-  void free(Word address);
+  virtual void free(Word address);
 
   /**
    * Runs a collection cycle.
    */
-  std::shared_ptr<GCStats> collect();
+  virtual std::shared_ptr<GCStats> collect();
+
+  /**
+   * Runs a full collection cycle (the major one of the generational
+   * collectors).
+   */
+  virtual std::shared_ptr<GCStats> collectFull();
+
+  /**
+   * Runs a bounded step of the collection cycle (incremental
+   * collectors). Returns true if the cycle is not finished yet.
+   */
+  virtual bool collectStep(uint32_t budget);
 
   /**
    * Returns object header.
    */
-  ObjectHeader* getHeader(Word address);
+  virtual ObjectHeader* getHeader(Word address);
 
   /**
    * Sizeof operator.
    */
-  uint16_t sizeOf(Word address);
+  virtual uint32_t sizeOf(Word address);
 
   /**
    * Prints memory dump.
@@ -200,14 +375,14 @@ class MemoryManager {
   /**
    * Returns child pointers of this object.
    */
-  std::vector<Value*> getPointers(Word address);
+  virtual std::vector<Value*> getPointers(Word address);
 
   /**
    * Returns total amount of objects on the heap.
    */
   uint32_t getObjectCount();
 
- private:
+ protected:
   /**
    * Write barrier.
    *
@@ -215,6 +390,114 @@ class MemoryManager {
    * before pointer operations. E.g. Reference Counting collector
    * updates the counter, generation collector handles inter-generational
    * pointers, etc.
+   *
+   * The collector's own barrier (`ICollector::onWrite`) is called
+   * before this one, while the concurrent mark is pending.
    */
   std::function<void(Word, Value& value)> writeBarrier_;
+
+  /**
+   * Chunk of the elastic heap (its initial size).
+   */
+  uint32_t _chunkSize;
+
+  /**
+   * Number of the last collections with the low heap occupancy.
+   */
+  uint32_t _lowOccupancyCount;
+
+  /**
+   * Bytes allocated since the last collection.
+   */
+  uint32_t _allocatedBytes;
+
+  /**
+   * Whether the object is in the large object space.
+   */
+  bool _isLargeObject(Word address);
+
+  /**
+   * Grows, or shrinks the elastic heap after a collection,
+   * depending on its occupancy.
+   */
+  void _resizeHeap();
+
+  /**
+   * Resizes the heap, if the allocator supports it.
+   */
+  bool _resizeHeapTo(uint32_t size);
+
+  /**
+   * Returns the type table, creating it on the first use.
+   */
+  std::shared_ptr<TypeTable>& _getTypes();
+
+  /**
+   * Allocation of an untyped object (see `allocate`).
+   */
+  inline Value _allocate(uint32_t n) {
+    if (largeObjects != nullptr && n > largeObjects->threshold) {
+      return _allocateLarge(n);
+    }
+    if (collector != nullptr &&
+        (collector->sweepPending || collector->markPending ||
+         collector->allocationHookEnabled)) {
+      return _allocateReported(n);
+    }
+    if (nursery != nullptr) {
+      return _allocateYoung(n);
+    }
+    return allocator->allocate(n);
+  }
+
+  /**
+   * Allocation with the automatic collections: before it, if the
+   * threshold is crossed, and after it, if it fails.
+   */
+  inline Value _allocateCollecting(uint32_t n) {
+    if (allocationThreshold != 0) {
+      _countAllocation(n);
+    }
+
+    auto object = _allocate(n);
+
+    if (object.isNullPointer()) {
+      return _retryAllocation(n);
+    }
+    return object;
+  }
+
+  /**
+   * Counts the allocated bytes, running a collection, once
+   * the threshold is crossed.
+   */
+  void _countAllocation(uint32_t n);
+
+  /**
+   * Retries the failed allocation after the collections, calling
+   * the `onOutOfMemory`, if it still fails.
+   */
+  Value _retryAllocation(uint32_t n);
+
+  /**
+   * Runs the automatic collection.
+   */
+  void _collectAuto(bool full);
+
+  /**
+   * Allocation reported to the collector: while the lazy sweep, or
+   * the concurrent mark is pending, or if the collector tracks
+   * all allocations.
+   */
+  Value _allocateReported(uint32_t n);
+
+  /**
+   * Allocation in the large object space.
+   */
+  Value _allocateLarge(uint32_t n);
+
+  /**
+   * Allocation in the nursery.
+   */
+  Value _allocateYoung(uint32_t n);
 };
\ No newline at end of file
@@ -0,0 +1,143 @@
+/**
+ * The MIT License (MIT)
+ * Copyright (c) 2018-present Dmitry Soshnikov <dmitry.soshnikov@gmail.com>
+ */
+
+#pragma once
+
+#include <stdint.h>
+#include <cstring>
+#include <memory>
+
+#include "../Value/Value.h"
+#include "../util/number-util.h"
+
+#include "Heap.h"
+#include "ObjectHeader.h"
+
+/**
+ * Nursery (the young generation).
+ *
+ * A region of the storage after the heap (and the large object space),
+ * where the new objects are bump-allocated:
+ *
+ *  +------------+-------------+--------+--------+-----------------+
+ *  | Heap (old) | Large obj.  | Object | Object |      Free       |
+ *  +------------+-------------+--------+--------+-----------------+
+ *                             ^                 ^                 ^
+ *                             Start             Cursor            End
+ *
+ * The objects have the usual headers, so the heap allocator can read
+ * their headers, and pointers. A generational collector evacuates
+ * the surviving objects to the heap, and resets the nursery.
+ */
+struct Nursery {
+  /**
+   * Associated heap, which reserves the storage for the nursery.
+   */
+  std::shared_ptr<Heap> heap;
+
+  Nursery(std::shared_ptr<Heap> heap, uint32_t size)
+      : heap(heap),
+        _start(heap->reserve(size)),
+        _end(_start + size),
+        _cursor(_start) {
+    reset();
+  }
+
+  /**
+   * Whether the address belongs to the nursery.
+   */
+  bool contains(Word address) { return address >= _start && address < _end; }
+
+  /**
+   * Bump-allocates the object.
+   *
+   * Value::Pointer(nullptr) payload signals that the nursery is full.
+   */
+  Value allocate(uint32_t n) {
+    n = align<Word>(n);
+
+    if (n > ObjectHeader::MAX_SIZE ||
+        _end - _cursor < sizeof(ObjectHeader) + n) {
+      return Value::Pointer(nullptr);
+    }
+
+    *(ObjectHeader*)heap->asBytePointer(_cursor) =
+        ObjectHeader{.used = 1, .size = (ObjectHeader::Size)n};
+
+    auto payload = _cursor + sizeof(ObjectHeader);
+    _cursor = payload + n;
+    _objectCount++;
+
+    return Value::Pointer(payload);
+  }
+
+  /**
+   * Marks the object as free. The memory is reclaimed
+   * by the next collection.
+   */
+  void free(Word address) {
+    getHeader(address)->used = 0;
+    _objectCount--;
+  }
+
+  /**
+   * Returns the reference to the object header.
+   */
+  ObjectHeader* getHeader(Word address) {
+    return (ObjectHeader*)(heap->asBytePointer(address) - sizeof(ObjectHeader));
+  }
+
+  /**
+   * Calls the `callback` with the address of each (used) object.
+   */
+  template <typename Callback>
+  void forEachObject(Callback callback) {
+    for (auto block = _start; block < _cursor;) {
+      auto payload = block + sizeof(ObjectHeader);
+      auto header = getHeader(payload);
+      if (header->used) {
+        callback(payload);
+      }
+      block = payload + header->size;
+    }
+  }
+
+  /**
+   * Returns total amount of objects in the nursery.
+   */
+  uint32_t getObjectCount() { return _objectCount; }
+
+  /**
+   * Returns the start address of the nursery.
+   */
+  Word start() { return _start; }
+
+  /**
+   * Resets the nursery: all objects are reclaimed,
+   * and the used memory is cleared.
+   */
+  void reset() {
+    memset(heap->asBytePointer(_start), 0, _cursor - _start);
+    _cursor = _start;
+    _objectCount = 0;
+  }
+
+ private:
+  /**
+   * Region bounds.
+   */
+  Word _start;
+  Word _end;
+
+  /**
+   * Address of the next block header.
+   */
+  Word _cursor;
+
+  /**
+   * Number of objects in the nursery.
+   */
+  uint32_t _objectCount = 0;
+};
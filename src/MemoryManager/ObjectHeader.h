@@ -13,17 +13,114 @@
  * The header stores meta-information for the Collector, and Allocator
  * purposes. It's located in the word prior to the payload pointer.
  *
+ * The layout is chosen at compile time:
+ *
+ *   - Default, 32-bit header: blocks up to 255 bytes, forwarding
+ *     addresses up to 64 KiB:
+ *
+ *       +-----------------------+------+----+
+ *       | Forward:14 | U | P    | Size | GC |
+ *       +-----------------------+------+----+
+ *
+ *   - Large heap (MMGC_LARGE_HEAP), 64-bit header: blocks up to 16 MiB,
+ *     forwarding addresses up to 1 GiB:
+ *
+ *       +-----------------------+---------+----+
+ *       | Forward:30 | U | P    | Size:24 | GC |
+ *       +-----------------------+---------+----+
+ *
+ * The forwarding address is stored in words (the payloads are word
+ * aligned), so the 14 bits, left after the `used`, and `prevFree` bits,
+ * still address the 64 KiB heap of the original 16-bit byte address.
+ * It's accessed with `getForward`, and `setForward`.
+ *
+ * The free space larger than `MAX_SIZE` is described by several
+ * free blocks.
  */
 struct ObjectHeader {
+#ifdef MMGC_LARGE_HEAP
+
+  /**
+   * Type of the block size field.
+   */
+  using Size = uint32_t;
+
+  /**
+   * Binary representation of the header.
+   */
+  using Bits = uint64_t;
+
+  /**
+   * Width of the forwarding address.
+   */
+  static constexpr uint32_t FORWARD_BITS = 30;
+
+  /**
+   * Width of the block size.
+   */
+  static constexpr uint32_t SIZE_BITS = 24;
+
+#else
+
+  using Size = uint8_t;
+  using Bits = uint32_t;
+  static constexpr uint32_t FORWARD_BITS = 14;
+  static constexpr uint32_t SIZE_BITS = 8;
+
+#endif
+
+  /**
+   * Max (word aligned) block size which can be recorded in the header.
+   */
+  static constexpr uint32_t MAX_SIZE = ((1u << SIZE_BITS) - 1) & ~3u;
+
   /**
-   * The forwarding address (using by moving/copying collectors).
+   * The forwarding address is stored in words.
    */
-  uint16_t forward;
+  static constexpr uint32_t FORWARD_SHIFT = 2;
+
+#ifdef MMGC_LARGE_HEAP
+
+  /**
+   * Max heap size (the heap offsets, and sizes are 32-bit).
+   */
+  static constexpr uint32_t MAX_HEAP_SIZE = 1u << 30;
+
+#else
+
+  /**
+   * Max heap size, addressable by the forwarding address.
+   */
+  static constexpr uint32_t MAX_HEAP_SIZE = 1u
+                                            << (FORWARD_BITS + FORWARD_SHIFT);
+
+#endif
+
+  /**
+   * The forwarding address in words (using by moving/copying collectors),
+   * see `getForward`.
+   *
+   * Outside of a compaction, if the previous block is free, this field
+   * stores the size of that block (the "boundary tag"), which allows
+   * coalescing allocators to find the previous block.
+   */
+  Bits forward : FORWARD_BITS;
+
+  /**
+   * Whether the block is allocated (1), or is free (0). Allows heap
+   * walkers (e.g. the sweep phase) to skip already free blocks.
+   */
+  Bits used : 1;
+
+  /**
+   * Whether the previous block is free, and `forward` is its size.
+   */
+  Bits prevFree : 1;
 
   /**
    * The block size.
    */
-  uint8_t size;
+  Bits size : SIZE_BITS;
 
   /**
    * Specific GC data.
@@ -40,6 +137,20 @@ struct ObjectHeader {
     uint8_t rc;
   };
 
-  operator uint32_t() { return toInt(); }
-  uint32_t toInt() { return *reinterpret_cast<uint32_t*>(this); }
-};
\ No newline at end of file
+  /**
+   * Returns the forwarding address (or the boundary tag) in bytes.
+   */
+  uint32_t getForward() { return (uint32_t)forward << FORWARD_SHIFT; }
+
+  /**
+   * Sets the forwarding address (or the boundary tag), which is
+   * word aligned.
+   */
+  void setForward(uint32_t address) { forward = address >> FORWARD_SHIFT; }
+
+  operator Bits() { return toInt(); }
+  Bits toInt() { return *reinterpret_cast<Bits*>(this); }
+};
+
+static_assert(sizeof(ObjectHeader) == sizeof(ObjectHeader::Bits),
+              "Unexpected object header layout.");
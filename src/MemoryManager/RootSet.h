@@ -0,0 +1,158 @@
+/**
+ * The MIT License (MIT)
+ * Copyright (c) 2018-present Dmitry Soshnikov <dmitry.soshnikov@gmail.com>
+ */
+
+#pragma once
+
+#include <stdint.h>
+#include <algorithm>
+#include <vector>
+
+#include "../Value/Value.h"
+
+/**
+ * Root set: the values outside of the heap, which keep the objects alive.
+ *
+ *   - Shadow stack: the `Value` slots, owned by the root set, and
+ *     accessed through the handles (see `HandleScope`)
+ *   - Ranges: the `Value` slots owned by the embedder (e.g. globals),
+ *     registered with `addRange`
+ *
+ * The collectors trace the objects referenced from the slots, and the
+ * moving collectors update the slots in place, so a handle always
+ * refers to the current address of the object.
+ */
+class RootSet {
+ public:
+  /**
+   * Pushes the value to the shadow stack. Returns the slot index.
+   */
+  uint32_t push(Value value) {
+    _stack.push_back(value);
+    return _stack.size() - 1;
+  }
+
+  /**
+   * Returns the shadow stack slot.
+   */
+  Value& get(uint32_t index) { return _stack[index]; }
+
+  /**
+   * Returns the number of the shadow stack slots.
+   */
+  uint32_t height() { return _stack.size(); }
+
+  /**
+   * Pops the shadow stack slots down to the `height`.
+   */
+  void truncate(uint32_t height) {
+    _stack.resize(std::min(height, (uint32_t)_stack.size()), Value(0));
+  }
+
+  /**
+   * Registers `count` slots at `start` as the roots.
+   */
+  void addRange(Value* start, uint32_t count) {
+    _ranges.push_back({start, count});
+  }
+
+  /**
+   * Unregisters the range starting at `start`.
+   */
+  void removeRange(Value* start) {
+    _ranges.erase(std::remove_if(_ranges.begin(), _ranges.end(),
+                                 [&](const Range& range) {
+                                   return range.start == start;
+                                 }),
+                  _ranges.end());
+  }
+
+  /**
+   * Calls the `callback` for each slot, which stores a pointer.
+   */
+  template <typename Callback>
+  void forEachSlot(Callback callback) {
+    for (auto& value : _stack) {
+      _visit(&value, callback);
+    }
+    for (const auto& range : _ranges) {
+      for (uint32_t i = 0; i < range.count; i++) {
+        _visit(range.start + i, callback);
+      }
+    }
+  }
+
+ private:
+  /**
+   * Embedder-owned slots.
+   */
+  struct Range {
+    Value* start;
+    uint32_t count;
+  };
+
+  /**
+   * Shadow stack slots.
+   */
+  std::vector<Value> _stack;
+
+  /**
+   * Registered ranges.
+   */
+  std::vector<Range> _ranges;
+
+  template <typename Callback>
+  static void _visit(Value* slot, Callback& callback) {
+    if (slot->isPointer() && !slot->isNullPointer()) {
+      callback(slot);
+    }
+  }
+};
+
+/**
+ * Handle: a shadow stack slot, which roots the object.
+ */
+class Handle {
+ public:
+  Handle(RootSet& roots, uint32_t index) : _roots(&roots), _index(index) {}
+
+  /**
+   * The current value of the slot.
+   */
+  Value& operator*() { return _roots->get(_index); }
+  Value* operator->() { return &_roots->get(_index); }
+
+ private:
+  RootSet* _roots;
+  uint32_t _index;
+};
+
+/**
+ * Handle scope (RAII): the handles created in the scope
+ * are popped from the shadow stack when it's destroyed.
+ *
+ *   {
+ *     HandleScope scope(*mm->roots);
+ *     auto object = scope.handle(mm->allocate(8));
+ *     mm->collect();  // `*object` is alive (and updated if moved)
+ *   }
+ */
+class HandleScope {
+ public:
+  HandleScope(RootSet& roots) : _roots(roots), _height(roots.height()) {}
+
+  ~HandleScope() { _roots.truncate(_height); }
+
+  HandleScope(const HandleScope&) = delete;
+  HandleScope& operator=(const HandleScope&) = delete;
+
+  /**
+   * Creates a handle to the value.
+   */
+  Handle handle(Value value) { return Handle(_roots, _roots.push(value)); }
+
+ private:
+  RootSet& _roots;
+  uint32_t _height;
+};
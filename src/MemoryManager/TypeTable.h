@@ -0,0 +1,161 @@
+/**
+ * The MIT License (MIT)
+ * Copyright (c) 2018-present Dmitry Soshnikov <dmitry.soshnikov@gmail.com>
+ */
+
+#pragma once
+
+#include <stdint.h>
+#include <memory>
+#include <stdexcept>
+#include <vector>
+
+#include "../Value/Value.h"
+
+#include "Heap.h"
+
+/**
+ * Type id of an object, an index in the type table.
+ */
+using TypeId = uint8_t;
+
+/**
+ * Object type descriptor: the pointer bitmap of the payload
+ * (bit `i` is set, if the word `i` is a pointer).
+ */
+struct TypeDescriptor {
+  std::vector<uint64_t> pointerBitmap;
+};
+
+/**
+ * Type table: the registered type descriptors, and the type ids
+ * of the objects.
+ *
+ * The object header has no spare bits, so the ids are stored in a side
+ * byte map (one entry per heap word, indexed by the payload address),
+ * similar to the mark bitmap. The moving collectors copy the id with
+ * the object.
+ *
+ * The tracing of a typed object visits only the words from its pointer
+ * bitmap, so the cost depends on the number of pointers rather than
+ * on the object size, and the numbers are never mistaken for pointers.
+ * The objects of the `LEAF` type are not scanned at all.
+ */
+class TypeTable {
+ public:
+  /**
+   * Default type: each word is tested with `isPointer`.
+   */
+  static constexpr TypeId CONSERVATIVE = 0;
+
+  /**
+   * No pointers (e.g. strings, number arrays).
+   */
+  static constexpr TypeId LEAF = 1;
+
+  TypeTable(std::shared_ptr<Heap> heap)
+      : _heap(heap),
+        _descriptors(2),
+        _types(heap->totalSize() / sizeof(Word), CONSERVATIVE) {}
+
+  /**
+   * Registers the type with the pointer bitmap. Returns its id.
+   */
+  TypeId registerType(const std::vector<uint64_t>& pointerBitmap) {
+    if (_descriptors.size() > UINT8_MAX) {
+      throw std::runtime_error("Too many types.");
+    }
+
+    _descriptors.push_back(TypeDescriptor{pointerBitmap});
+    return _descriptors.size() - 1;
+  }
+
+  /**
+   * Returns the type descriptor.
+   */
+  const TypeDescriptor& getDescriptor(TypeId type) {
+    return _descriptors[type];
+  }
+
+  /**
+   * Sets the type of the object.
+   */
+  void setType(Word address, TypeId type) {
+    auto index = address / sizeof(Word);
+
+    // The heap may reserve more storage (e.g. for the nursery).
+    if (index >= _types.size()) {
+      _types.resize(_heap->totalSize() / sizeof(Word), CONSERVATIVE);
+    }
+
+    _types[index] = type;
+  }
+
+  /**
+   * Returns the type of the object.
+   */
+  TypeId getType(Word address) {
+    auto index = address / sizeof(Word);
+    return index < _types.size() ? _types[index] : CONSERVATIVE;
+  }
+
+  /**
+   * Copies the type of the object to its new location.
+   */
+  void moveType(Word from, Word to) { setType(to, getType(from)); }
+
+  /**
+   * Returns the pointers of the typed object with `words` payload
+   * words: only the slots of the pointer bitmap are visited.
+   */
+  std::vector<Value*> getPointers(Word address, TypeId type, uint32_t words) {
+    std::vector<Value*> pointers;
+    forEachPointer(address, type, words,
+                   [&](Value* v) { pointers.push_back(v); });
+    return pointers;
+  }
+
+  /**
+   * Calls the `visitor` for each pointer of the typed object.
+   */
+  template <typename Visitor>
+  void forEachPointer(Word address, TypeId type, uint32_t words,
+                      Visitor visitor) {
+    if (type == LEAF) {
+      return;
+    }
+
+    auto& bitmap = _descriptors[type].pointerBitmap;
+
+    for (uint32_t i = 0; i < bitmap.size(); i++) {
+      auto bits = bitmap[i];
+
+      while (bits != 0) {
+        auto word = i * 64 + __builtin_ctzll(bits);
+        bits &= bits - 1;
+
+        if (word >= words) {
+          break;
+        }
+
+        auto v = (Value*)_heap->asWordPointer(address + word * sizeof(Word));
+        if (v->isPointer() && !v->isNullPointer()) {
+          visitor(v);
+        }
+      }
+    }
+  }
+
+ private:
+  std::shared_ptr<Heap> _heap;
+
+  /**
+   * Registered types (the first two are predefined).
+   */
+  std::vector<TypeDescriptor> _descriptors;
+
+  /**
+   * Type ids of the objects, one per heap word.
+   */
+  std::vector<TypeId> _types;
+};
@@ -0,0 +1,142 @@
+/**
+ * The MIT License (MIT)
+ * Copyright (c) 2018-present Dmitry Soshnikov <dmitry.soshnikov@gmail.com>
+ */
+
+#pragma once
+
+#include <type_traits>
+
+#include "../Value/Value.h"
+
+class GenerationalGC;
+class MarkSweepGC;
+class RCCollector;
+
+/**
+ * Write barrier policies of the `BasicMemoryManager`.
+ *
+ * A policy is a class with the static `onWrite(collector, address, slot,
+ * value)`, called before the `value` is stored to the `slot` at the
+ * `address` (so the old value can still be read). The collector type is
+ * known at compile time, so the barrier is inlined to the store, and
+ * the stores of the non-pointers are filtered out by the tag test before
+ * any barrier work:
+ *
+ *   - `NoBarrier`: the stop-the-world collectors (MarkSweepGC without
+ *     the concurrent, or incremental mode, MarkCompactGC, SemiSpaceGC,
+ *     ImmixGC)
+ *
+ *   - `CardBarrier`: the card marking of the GenerationalGC
+ *
+ *   - `SATBBarrier`: the concurrent (snapshot-at-the-beginning),
+ *     and incremental mark of the MarkSweepGC
+ *
+ *   - `RCBarrier`: the buffered increments, and decrements of the
+ *     RCCollector
+ *
+ *   - `CollectorBarrier`: any collector, its own `onWrite` is called
+ *     while it's enabled
+ *
+ * The policies, which a collector works with, are listed by the
+ * `SupportsBarrier` trait below.
+ */
+
+/**
+ * No barrier.
+ */
+struct NoBarrier {
+  template <class Collector>
+  static inline void onWrite(Collector* collector, Word address, Value* slot,
+                             Value& value) {}
+};
+
+/**
+ * Card marking: only a stored pointer can create an old-to-young
+ * reference.
+ */
+struct CardBarrier {
+  template <class Collector>
+  static inline void onWrite(Collector* collector, Word address, Value* slot,
+                             Value& value) {
+    if (value.isObjectPointer()) {
+      collector->markCard(address, value.toInt());
+    }
+  }
+};
+
+/**
+ * Mark barrier: only while the mark is pending, and only if either
+ * the overwritten value (SATB), or the stored one (incremental)
+ * is a pointer.
+ */
+struct SATBBarrier {
+  template <class Collector>
+  static inline void onWrite(Collector* collector, Word address, Value* slot,
+                             Value& value) {
+    if (collector->markPending &&
+        (slot->isObjectPointer() || value.isObjectPointer())) {
+      collector->Collector::onWrite(address, value);
+    }
+  }
+};
+
+/**
+ * Reference counting: only the pointer stores, and the overwritten
+ * pointers change the counts.
+ */
+struct RCBarrier {
+  template <class Collector>
+  static inline void onWrite(Collector* collector, Word address, Value* slot,
+                             Value& value) {
+    if (slot->isObjectPointer() || value.isObjectPointer()) {
+      collector->Collector::onWrite(address, value);
+    }
+  }
+};
+
+/**
+ * The collector's own barrier (`onWrite`), called directly while it's
+ * enabled: during the concurrent mark, or if the collector always needs
+ * it (e.g. the card marking of the generational collector). Neither
+ * of them is interested in a store, which neither overwrites, nor
+ * stores a pointer.
+ */
+struct CollectorBarrier {
+  template <class Collector>
+  static inline void onWrite(Collector* collector, Word address, Value* slot,
+                             Value& value) {
+    if ((slot->isObjectPointer() || value.isObjectPointer()) &&
+        (collector->markPending || collector->writeBarrierEnabled)) {
+      collector->Collector::onWrite(address, value);
+    }
+  }
+};
+
+/**
+ * Whether the `Collector` works with the `Barrier` policy. The
+ * stop-the-world collectors need no barrier, the rest need their own
+ * one (or the `CollectorBarrier`). The MarkSweepGC may run without the
+ * barrier, if its concurrent, and incremental modes are not used (the
+ * `BasicMemoryManager` throws on them then).
+ */
+template <class Collector, class Barrier>
+struct SupportsBarrier
+    : std::bool_constant<std::is_same_v<Barrier, NoBarrier> ||
+                         std::is_same_v<Barrier, CollectorBarrier>> {};
+
+template <class Barrier>
+struct SupportsBarrier<MarkSweepGC, Barrier>
+    : std::bool_constant<std::is_same_v<Barrier, NoBarrier> ||
+                         std::is_same_v<Barrier, SATBBarrier> ||
+                         std::is_same_v<Barrier, CollectorBarrier>> {};
+
+template <class Barrier>
+struct SupportsBarrier<GenerationalGC, Barrier>
+    : std::bool_constant<std::is_same_v<Barrier, CardBarrier> ||
+                         std::is_same_v<Barrier, CollectorBarrier>> {};
+
+template <class Barrier>
+struct SupportsBarrier<RCCollector, Barrier>
+    : std::bool_constant<std::is_same_v<Barrier, RCBarrier> ||
+                         std::is_same_v<Barrier, CollectorBarrier>> {};
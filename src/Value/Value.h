@@ -91,6 +91,15 @@ class Value {
    */
   bool isNullPointer();
 
+  /**
+   * Checks whether a value is a non-null Pointer. The tag test is inlined
+   * (e.g. to filter the stores in the write barriers).
+   */
+  inline bool isObjectPointer() const {
+    return (_value & 1) == 0 && _value != 0 && _value != TRUE &&
+           _value != FALSE;
+  }
+
   /**
    * Encodes a boolean.
    */
@@ -0,0 +1,157 @@
+/**
+ * The MIT License (MIT)
+ * Copyright (c) 2018-present Dmitry Soshnikov <dmitry.soshnikov@gmail.com>
+ */
+
+#include "BumpPointerAllocator.h"
+
+#include <algorithm>
+
+/**
+ * Marks the block as free. The memory is reclaimed
+ * only by the next compaction.
+ */
+void BumpPointerAllocator::free(Word address) {
+  getHeader(address)->used = 0;
+
+  // Update total object count.
+  _objectCount--;
+}
+
+/**
+ * Returns child pointers of this object.
+ */
+std::vector<Value*> BumpPointerAllocator::getPointers(Word address) {
+  std::vector<Value*> pointers;
+  forEachPointer(address, [&](Value* v) { pointers.push_back(v); });
+  return pointers;
+}
+
+/**
+ * Returns total amount of objects on the heap.
+ */
+uint32_t BumpPointerAllocator::getObjectCount() { return _objectCount; }
+
+/**
+ * Resets the allocator.
+ */
+void BumpPointerAllocator::reset() {
+  _resetFrom(0);
+  _rebuildChunkStarts();
+  _objectCount = 0;
+}
+
+/**
+ * Resets the cursor to the compaction frontier.
+ */
+void BumpPointerAllocator::resetFrontier(Word frontier, uint32_t objectCount) {
+  _resetFrom(frontier);
+  _rebuildChunkStarts();
+  _objectCount = objectCount;
+}
+
+/**
+ * Returns the first block of the chunk of the `address`. If a larger
+ * block spans the chunk start, the block of a previous chunk is used.
+ * After the cursor, the walk starts from the cursor.
+ */
+Word BumpPointerAllocator::findBlockStart(Word address) {
+  if (address >= _cursor) {
+    return _cursor;
+  }
+
+  for (int k = address / CHUNK_SIZE; k >= 0; k--) {
+    if (_chunkStarts[k] <= address) {
+      return _chunkStarts[k];
+    }
+  }
+  return 0;
+}
+
+/**
+ * Adapts the allocator to the resized heap: the free space after the
+ * cursor is described again up to the new end. The heap can't shrink
+ * below the cursor (the freed objects are not reused before the
+ * compaction anyway).
+ */
+bool BumpPointerAllocator::resize(uint32_t oldSize) {
+  if (_cursor > heap->size()) {
+    return false;
+  }
+
+  _resetFrom(_cursor);
+  return true;
+}
+
+/**
+ * Returns the amount of the free memory after the cursor.
+ */
+uint32_t BumpPointerAllocator::getFreeSize() {
+  return heap->size() - _cursor;
+}
+
+/**
+ * Slow path: the block doesn't fit the current free block, so the
+ * following free blocks are absorbed, until the block fits.
+ */
+Value BumpPointerAllocator::_allocateSlow(uint32_t n) {
+  auto next = _cursor + sizeof(ObjectHeader) + n;
+
+  if (n > MAX_BLOCK_SIZE) {
+    return Value::Pointer(nullptr);
+  }
+
+  while (_limit < next && heap->size() - _limit >= sizeof(ObjectHeader)) {
+    auto header = (ObjectHeader*)heap->asBytePointer(_limit);
+    _limit += sizeof(ObjectHeader) + header->size;
+  }
+
+  if (next > _limit) {
+    return Value::Pointer(nullptr);
+  }
+
+  return _bump(n, next);
+}
+
+/**
+ * The free space starting from the `address` is split into the largest
+ * blocks which can be recorded in the header. The cursor is set to
+ * the first of these blocks.
+ */
+void BumpPointerAllocator::_resetFrom(Word address) {
+  _cursor = address;
+  _limit = address;
+
+  auto block = address;
+
+  while (block < heap->size() &&
+         heap->size() - block >= sizeof(ObjectHeader)) {
+    auto size = std::min<uint32_t>(heap->size() - block - sizeof(ObjectHeader),
+                                   MAX_BLOCK_SIZE);
+    *(ObjectHeader*)heap->asBytePointer(block) = ObjectHeader{.size = (ObjectHeader::Size)size};
+    block += sizeof(ObjectHeader) + size;
+
+    if (_limit == address) {
+      _limit = block;
+    }
+  }
+}
+
+/**
+ * Walks the blocks before the cursor (the compacted ones), and records
+ * the first block of each chunk. The table covers the heap up to its
+ * limit, so the cursor may move into the grown space.
+ */
+void BumpPointerAllocator::_rebuildChunkStarts() {
+  _chunkStarts.assign((heap->limit() + CHUNK_SIZE - 1) / CHUNK_SIZE,
+                      UINT32_MAX);
+
+  Word block = 0;
+
+  while (block <= _cursor && block < heap->size()) {
+    auto& start = _chunkStarts[block / CHUNK_SIZE];
+    start = std::min(start, block);
+    block += sizeof(ObjectHeader) +
+             ((ObjectHeader*)heap->asBytePointer(block))->size;
+  }
+}
@@ -0,0 +1,183 @@
+/**
+ * The MIT License (MIT)
+ * Copyright (c) 2018-present Dmitry Soshnikov <dmitry.soshnikov@gmail.com>
+ */
+
+#pragma once
+
+#include <stdint.h>
+#include <vector>
+
+#include "../../Value/Value.h"
+#include "../../util/number-util.h"
+#include "../IAllocator.h"
+
+/**
+ * Bump Pointer Allocator.
+ *
+ * Allocation is just a pointer bump with a limit check: the free space
+ * is always one contiguous region after the cursor.
+ *
+ *  +--------+--------+--------+---------------------------+
+ *  | Object | Object | Object |        Free space         |
+ *  +--------+--------+--------+---------------------------+
+ *                             ^                           ^
+ *                             Cursor                      Limit
+ *
+ * The freed blocks are not reused until a compacting collector
+ * (e.g. MarkCompactGC) slides the live objects to the beginning of the
+ * heap, and resets the cursor to the compaction frontier.
+ *
+ * To keep the heap walkable for the collectors, the free space after
+ * the cursor is always described by free block headers.
+ *
+ * The allocation fast path is inlined, and since the class is final,
+ * the BasicMemoryManager calls it without a virtual dispatch.
+ */
+class BumpPointerAllocator final : public IAllocator {
+  /**
+   * Total object count on the heap.
+   */
+  uint32_t _objectCount;
+
+  /**
+   * Address of the next block header.
+   */
+  Word _cursor;
+
+  /**
+   * End of the free block at the cursor.
+   */
+  Word _limit;
+
+  /**
+   * Largest block size which can be recorded in the object header.
+   */
+  static constexpr uint32_t MAX_BLOCK_SIZE = ObjectHeader::MAX_SIZE;
+
+  /**
+   * Size of the heap chunk, for which the first block is recorded.
+   */
+  static constexpr uint32_t CHUNK_SIZE = 256;
+
+  /**
+   * Header address of the first block, starting in each chunk before
+   * the cursor (UINT32_MAX if a larger block spans the whole chunk).
+   * The blocks before the cursor don't change until the compaction.
+   */
+  std::vector<Word> _chunkStarts;
+
+ public:
+  BumpPointerAllocator(std::shared_ptr<Heap> heap) : IAllocator(heap) {
+    reset();
+  }
+
+  ~BumpPointerAllocator() {}
+
+  /**
+   * Allocates a memory chunk with an object header, bumping the cursor.
+   *
+   * Value::Pointer(nullptr) payload signals OOM.
+   */
+  inline Value allocate(uint32_t n) {
+    n = align<Word>(n);
+
+    auto next = _cursor + sizeof(ObjectHeader) + n;
+
+    // Doesn't fit the current free block, try absorbing next blocks.
+    if (next > _limit) {
+      return _allocateSlow(n);
+    }
+
+    return _bump(n, next);
+  }
+
+  /**
+   * Marks the block as free. The memory is reclaimed
+   * only by the next compaction.
+   */
+  void free(Word address);
+
+  /**
+   * Resets the allocator.
+   */
+  void reset();
+
+  /**
+   * Resets the cursor to the compaction frontier.
+   */
+  void resetFrontier(Word frontier, uint32_t objectCount);
+
+  /**
+   * Adapts the allocator to the resized heap.
+   */
+  bool resize(uint32_t oldSize);
+
+  /**
+   * Returns the amount of the free memory in the heap.
+   */
+  uint32_t getFreeSize();
+
+  /**
+   * Returns the reference to the object header (inlined to the direct
+   * calls of the collectors, and the BasicMemoryManager).
+   */
+  inline ObjectHeader* getHeader(Word address) {
+    return (ObjectHeader*)(heap->asBytePointer(address) -
+                           sizeof(ObjectHeader));
+  }
+
+  /**
+   * Returns total amount of objects on the heap.
+   */
+  uint32_t getObjectCount();
+
+  /**
+   * Returns child pointers of this object.
+   */
+  std::vector<Value*> getPointers(Word address);
+
+  /**
+   * Returns the address of the next block header.
+   */
+  Word getCursor() { return _cursor; }
+
+  /**
+   * Returns the header address of the block, which contains
+   * the `address` (or starts before it).
+   */
+  Word findBlockStart(Word address);
+
+ private:
+  /**
+   * Allocates the block at the cursor, moving the cursor to `next`.
+   */
+  inline Value _bump(uint32_t n, Word next) {
+    *(ObjectHeader*)heap->asBytePointer(_cursor) = ObjectHeader{.used = 1, .size = (ObjectHeader::Size)n};
+
+    auto payload = _cursor + sizeof(ObjectHeader);
+
+    // The next block is the first one of its chunk.
+    if (next / CHUNK_SIZE != _cursor / CHUNK_SIZE &&
+        next / CHUNK_SIZE < _chunkStarts.size()) {
+      _chunkStarts[next / CHUNK_SIZE] = next;
+    }
+
+    _cursor = next;
+
+    // The rest of the current free block.
+    if (_limit - _cursor >= sizeof(ObjectHeader)) {
+      *(ObjectHeader*)heap->asBytePointer(_cursor) = ObjectHeader{
+          .size = (ObjectHeader::Size)(_limit - _cursor - sizeof(ObjectHeader)),
+      };
+    }
+
+    _objectCount++;
+
+    return Value::Pointer(payload);
+  }
+
+  Value _allocateSlow(uint32_t n);
+  void _resetFrom(Word address);
+  void _rebuildChunkStarts();
+};
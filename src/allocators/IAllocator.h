@@ -6,8 +6,9 @@
 #pragma once
 
 #include <stdint.h>
-#include <vector>
+#include <functional>
 #include <memory>
+#include <vector>
 
 #include "../MemoryManager/Heap.h"
 #include "../MemoryManager/ObjectHeader.h"
@@ -51,6 +52,28 @@ struct IAllocator {
    */
   virtual void reset() = 0;
 
+  /**
+   * Resets the allocator after a compacting collection: `objectCount`
+   * live objects occupy the heap up to the `frontier` address,
+   * and the rest of the heap is free.
+   */
+  virtual void resetFrontier(Word frontier, uint32_t objectCount) = 0;
+
+  /**
+   * Adapts the allocator to the heap, resized from the `oldSize`
+   * (elastic heap). The grown space is free; the released one (after
+   * the new size) must be free, otherwise the allocator is not changed,
+   * and false is returned. The allocators of the fixed heap always
+   * return false.
+   */
+  virtual bool resize(uint32_t oldSize) { return false; }
+
+  /**
+   * Returns the amount of the free memory in the heap (for the heap
+   * occupancy), 0 if it's not tracked.
+   */
+  virtual uint32_t getFreeSize() { return 0; }
+
   /**
    * Returns the pointer to the object header.
    *
@@ -68,4 +91,52 @@ struct IAllocator {
    * Returns child pointers of this object.
    */
   virtual std::vector<Value*> getPointers(Word address) = 0;
+
+  /**
+   * Calls the `visitor` for each child pointer of the object, without
+   * building the vector (the hot path of the tracing).
+   */
+  template <typename Visitor>
+  void forEachPointer(Word address, Visitor visitor) {
+    forEachPointer(address, getHeader(address)->size, visitor);
+  }
+
+  /**
+   * Calls the `visitor` for each child pointer in the `size` bytes
+   * of the payload (the header is already read by the caller).
+   */
+  template <typename Visitor>
+  void forEachPointer(Word address, uint32_t size, Visitor visitor) {
+    auto words = size / sizeof(Word);
+
+    while (words-- > 0) {
+      auto v = (Value*)heap->asWordPointer(address);
+      address += sizeof(Word);
+      if (!v->isPointer() || v->isNullPointer()) {
+        continue;
+      }
+      visitor(v);
+    }
+  }
+
+  /**
+   * Sweeps the heap with several threads: the used blocks for which
+   * `isAlive` returns false are reclaimed, and `reclaimed` is set to
+   * their number. The `isAlive` is called concurrently, once per used block.
+   *
+   * Returns false if the allocator doesn't support the parallel sweep,
+   * and the heap should be swept sequentially with `free`.
+   */
+  virtual bool sweepParallel(uint32_t threads,
+                             const std::function<bool(Word)>& isAlive,
+                             uint32_t& reclaimed) {
+    return false;
+  }
+
+  /**
+   * Returns the header address of a block, which starts at, or before
+   * the `address`, to walk the heap from (e.g. to scan a card). By default
+   * it's the first block of the heap.
+   */
+  virtual Word findBlockStart(Word address) { return 0; }
 };
@@ -0,0 +1,186 @@
+/**
+ * The MIT License (MIT)
+ * Copyright (c) 2018-present Dmitry Soshnikov <dmitry.soshnikov@gmail.com>
+ */
+
+#include "ImmixAllocator.h"
+
+#include <algorithm>
+
+/**
+ * Allocates a memory chunk with an object header in the current
+ * hole, or in the next one, which fits it.
+ *
+ * Value::Pointer(nullptr) payload signals OOM.
+ */
+Value ImmixAllocator::allocate(uint32_t n) {
+  n = align<Word>(n);
+
+  if (n > MAX_BLOCK_SIZE) {
+    return Value::Pointer(nullptr);
+  }
+
+  auto size = sizeof(ObjectHeader) + n;
+
+  if (_limit - _cursor < size && !_nextHole(size)) {
+    return Value::Pointer(nullptr);
+  }
+
+  *(ObjectHeader*)heap->asBytePointer(_cursor) =
+      ObjectHeader{.used = 1, .size = (ObjectHeader::Size)n};
+
+  auto payload = _cursor + sizeof(ObjectHeader);
+  _cursor = payload + n;
+
+  // Update total object count.
+  _objectCount++;
+
+  return Value::Pointer(payload);
+}
+
+/**
+ * Moves the cursor to the next hole (after the limit), which fits
+ * `size` bytes. The lines of the evacuated blocks are skipped, and
+ * a hole never crosses a block boundary. If there is no such hole,
+ * the current one is kept for the smaller objects.
+ */
+bool ImmixAllocator::_nextHole(uint32_t size) {
+  auto heapSize = heap->size();
+  auto lines = _lineCount();
+  auto line = (_limit + LINE_SIZE - 1) / LINE_SIZE;
+
+  while (line < lines) {
+    auto block = line / LINES_PER_BLOCK;
+
+    if (_lineMarks[line] || _evacuating[block]) {
+      line++;
+      continue;
+    }
+
+    auto start = line;
+    while (line < lines && !_lineMarks[line] &&
+           line / LINES_PER_BLOCK == block) {
+      line++;
+    }
+
+    Word holeStart = start * LINE_SIZE;
+    Word holeEnd = std::min(line * LINE_SIZE, heapSize);
+
+    if (holeEnd - holeStart >= size) {
+      _cursor = holeStart;
+      _limit = holeEnd;
+      return true;
+    }
+  }
+
+  return false;
+}
+
+/**
+ * Marks the block as free. The memory is reclaimed
+ * by the next collection.
+ */
+void ImmixAllocator::free(Word address) {
+  getHeader(address)->used = 0;
+
+  // Update total object count.
+  _objectCount--;
+}
+
+/**
+ * Returns child pointers of this object.
+ */
+std::vector<Value*> ImmixAllocator::getPointers(Word address) {
+  std::vector<Value*> pointers;
+  forEachPointer(address, [&](Value* v) { pointers.push_back(v); });
+  return pointers;
+}
+
+/**
+ * Returns total amount of objects on the heap.
+ */
+uint32_t ImmixAllocator::getObjectCount() { return _objectCount; }
+
+/**
+ * Resets the allocator (all lines are free).
+ */
+void ImmixAllocator::reset() {
+  _lineMarks.assign(_lineCount(), 0);
+  _nextLineMarks.assign(_lineCount(), 0);
+  _evacuating.assign(_blockCount(), 0);
+  _cursor = 0;
+  _limit = 0;
+  _objectCount = 0;
+}
+
+/**
+ * Resets the allocator to the `frontier`: the lines before it are live
+ * (after a compacting collection), the allocation continues from the
+ * frontier.
+ */
+void ImmixAllocator::resetFrontier(Word frontier, uint32_t objectCount) {
+  for (uint32_t line = 0; line < _lineCount(); line++) {
+    _lineMarks[line] = line * LINE_SIZE < frontier;
+  }
+
+  _cursor = frontier;
+  _limit = frontier;
+  _objectCount = objectCount;
+}
+
+/**
+ * Starts the collection: the blocks, which were sparsely live after
+ * the last collection, are evacuated. The current hole is dropped,
+ * if it's in an evacuated block, so the copies are allocated
+ * in the rest of the heap.
+ */
+uint32_t ImmixAllocator::startCollection() {
+  uint32_t evacuated = 0;
+  auto lines = _lineCount();
+
+  for (uint32_t block = 0; block < _blockCount(); block++) {
+    auto first = block * LINES_PER_BLOCK;
+    auto last = std::min(first + LINES_PER_BLOCK, lines);
+    uint32_t live = 0;
+
+    for (auto line = first; line < last; line++) {
+      live += _lineMarks[line];
+    }
+
+    _evacuating[block] = live > 0 && live * EVACUATE_RATIO <= last - first;
+    evacuated += _evacuating[block];
+  }
+
+  if (_cursor < heap->size() && isEvacuating(_cursor)) {
+    _limit = _cursor;
+  }
+
+  std::fill(_nextLineMarks.begin(), _nextLineMarks.end(), 0);
+
+  return evacuated;
+}
+
+/**
+ * Marks the lines of the alive object (including its header).
+ */
+void ImmixAllocator::markLines(Word address) {
+  auto first = (address - sizeof(ObjectHeader)) / LINE_SIZE;
+  auto last = (address + getHeader(address)->size - 1) / LINE_SIZE;
+
+  for (auto line = first; line <= last; line++) {
+    _nextLineMarks[line] = 1;
+  }
+}
+
+/**
+ * Finishes the collection: the marked lines become live, and the rest
+ * are free. The allocation restarts from the first hole.
+ */
+void ImmixAllocator::finishCollection(uint32_t objectCount) {
+  _lineMarks.swap(_nextLineMarks);
+  std::fill(_evacuating.begin(), _evacuating.end(), 0);
+
+  _cursor = 0;
+  _limit = 0;
+  _objectCount = objectCount;
+}
@@ -0,0 +1,184 @@
+/**
+ * The MIT License (MIT)
+ * Copyright (c) 2018-present Dmitry Soshnikov <dmitry.soshnikov@gmail.com>
+ */
+
+#pragma once
+
+#include <stdint.h>
+#include <vector>
+
+#include "../../Value/Value.h"
+#include "../../util/number-util.h"
+#include "../IAllocator.h"
+
+/**
+ * Immix-style mark-region allocator.
+ *
+ * The heap is split into blocks, and the blocks into lines. A line is
+ * live if an object, which survived the last collection, overlaps it.
+ * The free lines form the holes, and the allocation is a pointer bump
+ * in the current hole:
+ *
+ *   Block:  | live | free | free | live | free | free | free | live |
+ *                  ^                    ^
+ *                  Cursor      Limit    (the next hole is searched
+ *                  +-----------+         from the limit)
+ *
+ * The small holes, which don't fit an object, are skipped, and an object
+ * never crosses a block boundary. So the neighbor objects are allocated
+ * contiguously, as with a bump allocator, while the dead objects are
+ * reclaimed by whole lines without a sweep.
+ *
+ * The line marks are set by the collector (ImmixGC), which also evacuates
+ * the objects of the fragmented blocks (see `startCollection`).
+ */
+class ImmixAllocator : public IAllocator {
+ public:
+  /**
+   * Size of a line.
+   */
+  static constexpr uint32_t LINE_SIZE = 128;
+
+  /**
+   * Size of a block (the default heap is too small for 32 KiB blocks).
+   */
+#ifdef MMGC_LARGE_HEAP
+  static constexpr uint32_t BLOCK_SIZE = 32 * 1024;
+#else
+  static constexpr uint32_t BLOCK_SIZE = 2 * 1024;
+#endif
+
+  static constexpr uint32_t LINES_PER_BLOCK = BLOCK_SIZE / LINE_SIZE;
+
+  /**
+   * A block is evacuated, if at most `1 / EVACUATE_RATIO`
+   * of its lines is live.
+   */
+  static constexpr uint32_t EVACUATE_RATIO = 4;
+
+  ImmixAllocator(std::shared_ptr<Heap> heap) : IAllocator(heap) { reset(); }
+
+  ~ImmixAllocator() {}
+
+  /**
+   * Allocates a memory chunk with an object header in the current
+   * hole, or in the next one, which fits it.
+   *
+   * Value::Pointer(nullptr) payload signals OOM.
+   */
+  Value allocate(uint32_t n);
+
+  /**
+   * Marks the block as free. The memory is reclaimed
+   * by the next collection.
+   */
+  void free(Word address);
+
+  /**
+   * Resets the allocator (all lines are free).
+   */
+  void reset();
+
+  /**
+   * Resets the allocator to the `frontier`: the lines
+   * before it are live.
+   */
+  void resetFrontier(Word frontier, uint32_t objectCount);
+
+  /**
+   * Returns the reference to the object header (inlined to the direct
+   * calls of the collectors, and the BasicMemoryManager).
+   */
+  inline ObjectHeader* getHeader(Word address) {
+    return (ObjectHeader*)(heap->asBytePointer(address) -
+                           sizeof(ObjectHeader));
+  }
+
+  /**
+   * Returns total amount of objects on the heap.
+   */
+  uint32_t getObjectCount();
+
+  /**
+   * Returns child pointers of this object.
+   */
+  std::vector<Value*> getPointers(Word address);
+
+  /**
+   * Starts the collection: selects the fragmented blocks for the
+   * evacuation (no new objects are allocated in them), and clears
+   * the line marks of the collection. Returns the number of
+   * the evacuated blocks.
+   */
+  uint32_t startCollection();
+
+  /**
+   * Whether the object is in an evacuated block.
+   */
+  bool isEvacuating(Word address) {
+    return _evacuating[address / BLOCK_SIZE] == 1;
+  }
+
+  /**
+   * Marks the lines of the alive object.
+   */
+  void markLines(Word address);
+
+  /**
+   * Finishes the collection: the marked lines become live, and the rest
+   * are free. The allocation restarts from the first hole.
+   */
+  void finishCollection(uint32_t objectCount);
+
+  /**
+   * Whether the line of the address is live.
+   */
+  bool isLineLive(Word address) { return _lineMarks[address / LINE_SIZE]; }
+
+ private:
+  /**
+   * Total object count on the heap.
+   */
+  uint32_t _objectCount;
+
+  /**
+   * Current hole: [cursor, limit).
+   */
+  Word _cursor;
+  Word _limit;
+
+  /**
+   * Line marks of the last collection (1 is live).
+   */
+  std::vector<uint8_t> _lineMarks;
+
+  /**
+   * Line marks of the current collection.
+   */
+  std::vector<uint8_t> _nextLineMarks;
+
+  /**
+   * Blocks evacuated by the current collection.
+   */
+  std::vector<uint8_t> _evacuating;
+
+  /**
+   * Largest block size which can be recorded in the object header.
+   */
+  static constexpr uint32_t MAX_BLOCK_SIZE = ObjectHeader::MAX_SIZE;
+
+  /**
+   * Moves the cursor to the next hole (after the limit), which fits
+   * `size` bytes. Returns false if there is none.
+   */
+  bool _nextHole(uint32_t size);
+
+  /**
+   * Number of lines, and blocks (the last ones may be partial).
+   */
+  uint32_t _lineCount() { return (heap->size() + LINE_SIZE - 1) / LINE_SIZE; }
+  uint32_t _blockCount() {
+    return (heap->size() + BLOCK_SIZE - 1) / BLOCK_SIZE;
+  }
+};
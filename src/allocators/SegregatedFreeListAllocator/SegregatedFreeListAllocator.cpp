@@ -0,0 +1,240 @@
+/**
+ * The MIT License (MIT)
+ * Copyright (c) 2018-present Dmitry Soshnikov <dmitry.soshnikov@gmail.com>
+ */
+
+#include "SegregatedFreeListAllocator.h"
+#include "../../util/number-util.h"
+
+#include <algorithm>
+
+/**
+ * Allocates a memory chunk with an object header.
+ * The payload pointer is set to the first byte (after the header).
+ *
+ * Value::Pointer(nullptr) payload signals OOM.
+ */
+Value SegregatedFreeListAllocator::allocate(uint32_t n) {
+  n = n == 0 ? sizeof(Word) : align<Word>(n);
+
+  Word block;
+
+  if (n > MAX_BLOCK_SIZE || !_takeBlock(n, block)) {
+    return Value::Pointer(nullptr);
+  }
+
+  auto header = (ObjectHeader*)heap->asBytePointer(block);
+  auto size = header->size;
+  auto payload = block + sizeof(ObjectHeader);
+
+  // See if we can split the larger block, reserving at least
+  // one word with a header, and returning the rest to its bin.
+  auto canSplit = (size >= n + sizeof(ObjectHeader) + sizeof(Word));
+
+  if (canSplit) {
+    header->size = n;
+
+    auto nextHeaderP = payload + n;
+    auto nextSize = (ObjectHeader::Size)(size - n - sizeof(ObjectHeader));
+    *(ObjectHeader*)heap->asBytePointer(nextHeaderP) = ObjectHeader{.size = nextSize};
+    _pushBlock(nextHeaderP);
+    _addBlockStart(nextHeaderP);
+  }
+
+  header->used = 1;
+
+  // Update total object count.
+  _objectCount++;
+
+  return Value::Pointer(payload);
+}
+
+/**
+ * Returns the block to the bin of its size class.
+ */
+void SegregatedFreeListAllocator::free(Word address) {
+  auto header = getHeader(address);
+  header->used = 0;
+
+  _pushBlock(address - sizeof(ObjectHeader));
+
+  // Update total object count.
+  _objectCount--;
+}
+
+/**
+ * Returns child pointers of this object.
+ */
+std::vector<Value*> SegregatedFreeListAllocator::getPointers(Word address) {
+  std::vector<Value*> pointers;
+  forEachPointer(address, [&](Value* v) { pointers.push_back(v); });
+  return pointers;
+}
+
+/**
+ * Returns total amount of objects on the heap.
+ */
+uint32_t SegregatedFreeListAllocator::getObjectCount() { return _objectCount; }
+
+/**
+ * Resets the allocator.
+ */
+void SegregatedFreeListAllocator::reset() {
+  _resetBins();
+  _rebuildChunkStarts();
+  _objectCount = 0;
+}
+
+/**
+ * Resets the allocator to the compaction frontier: the rest
+ * of the heap after the frontier is put into the bins.
+ */
+void SegregatedFreeListAllocator::resetFrontier(Word frontier,
+                                                uint32_t objectCount) {
+  _resetBins(frontier);
+  _rebuildChunkStarts();
+  _objectCount = objectCount;
+}
+
+/**
+ * Returns the first block of the chunk of the `address`. If a larger
+ * block spans the chunk start, the block of a previous chunk is used.
+ */
+Word SegregatedFreeListAllocator::findBlockStart(Word address) {
+  for (int k = address / CHUNK_SIZE; k >= 0; k--) {
+    if (_chunkStarts[k] <= address) {
+      return _chunkStarts[k];
+    }
+  }
+  return 0;
+}
+
+/**
+ * Returns the size class of a free block of size `n`: exact word
+ * class for small blocks, and floor power of two for large ones.
+ */
+uint32_t SegregatedFreeListAllocator::blockClass(uint32_t n) {
+  if (n <= SMALL_LIMIT) {
+    return n / sizeof(Word) - 1;
+  }
+  auto log2 = 31 - __builtin_clz(n);
+  return SMALL_CLASSES + log2 - 6;
+}
+
+/**
+ * Returns the first size class, all blocks of which fit `n` bytes:
+ * exact word class for small requests, and ceiling power of two
+ * for large ones.
+ */
+uint32_t SegregatedFreeListAllocator::requestClass(uint32_t n) {
+  if (n <= SMALL_LIMIT) {
+    return n / sizeof(Word) - 1;
+  }
+  auto log2 = 32 - __builtin_clz(n - 1);
+  return SMALL_CLASSES + log2 - 6;
+}
+
+/**
+ * Finds a free block of at least `n` bytes, and removes it from its bin.
+ */
+bool SegregatedFreeListAllocator::_takeBlock(uint32_t n, Word& block) {
+  auto sizeClass = requestClass(n);
+
+  // First non-empty bin, starting from the request class.
+  auto candidates = sizeClass < CLASSES ? binMap >> sizeClass << sizeClass : 0;
+
+  if (candidates != 0) {
+    auto& bin = bins[__builtin_ctzll(candidates)];
+    block = bin.back();
+    bin.pop_back();
+    if (bin.empty()) {
+      binMap &= ~(1ull << __builtin_ctzll(candidates));
+    }
+    return true;
+  }
+
+  // Large request, which still may fit some block in the lower
+  // power-of-two class: first fit among the last `FLOOR_PROBE` blocks
+  // of this bin (the bounded probe keeps the allocation O(1), a fitting
+  // block deeper in the bin is skipped).
+  if (n > SMALL_LIMIT) {
+    auto floorClass = blockClass(n);
+    auto& bin = bins[floorClass];
+    auto probed = std::min<size_t>(bin.size(), FLOOR_PROBE);
+
+    for (auto i = bin.size(); i > bin.size() - probed; i--) {
+      if (((ObjectHeader*)heap->asBytePointer(bin[i - 1]))->size < n) {
+        continue;
+      }
+
+      // The order in the bin doesn't matter: swap with the last block.
+      block = bin[i - 1];
+      bin[i - 1] = bin.back();
+      bin.pop_back();
+      if (bin.empty()) {
+        binMap &= ~(1ull << floorClass);
+      }
+      return true;
+    }
+  }
+
+  return false;
+}
+
+/**
+ * Adds a free block (header address) to the bin of its size class.
+ */
+void SegregatedFreeListAllocator::_pushBlock(Word block) {
+  auto header = (ObjectHeader*)heap->asBytePointer(block);
+  auto sizeClass = blockClass(header->size);
+  bins[sizeClass].push_back(block);
+  binMap |= 1ull << sizeClass;
+}
+
+/**
+ * Initially the heap (starting from the `address`) is split into the
+ * largest blocks which can be recorded in the header, and all of them
+ * are put into the bins.
+ */
+void SegregatedFreeListAllocator::_resetBins(Word address) {
+  for (auto& bin : bins) {
+    bin.clear();
+  }
+  binMap = 0;
+
+  auto block = address;
+
+  while (block < heap->size() &&
+         heap->size() - block >= sizeof(ObjectHeader) + sizeof(Word)) {
+    auto size = std::min<uint32_t>(heap->size() - block - sizeof(ObjectHeader),
+                                   MAX_BLOCK_SIZE);
+    *(ObjectHeader*)heap->asBytePointer(block) = ObjectHeader{.size = (ObjectHeader::Size)size};
+    _pushBlock(block);
+    block += sizeof(ObjectHeader) + size;
+  }
+}
+
+/**
+ * A new block is split at the `block` header address.
+ */
+void SegregatedFreeListAllocator::_addBlockStart(Word block) {
+  auto& start = _chunkStarts[block / CHUNK_SIZE];
+  start = std::min(start, block);
+}
+
+/**
+ * Walks the heap, and records the first block of each chunk
+ * (the compacted blocks before the frontier are new).
+ */
+void SegregatedFreeListAllocator::_rebuildChunkStarts() {
+  _chunkStarts.assign((heap->size() + CHUNK_SIZE - 1) / CHUNK_SIZE,
+                      UINT32_MAX);
+
+  Word block = 0;
+
+  while (heap->size() - block >= sizeof(ObjectHeader) + sizeof(Word)) {
+    _addBlockStart(block);
+    block += sizeof(ObjectHeader) +
+             ((ObjectHeader*)heap->asBytePointer(block))->size;
+  }
+}
@@ -0,0 +1,170 @@
+/**
+ * The MIT License (MIT)
+ * Copyright (c) 2018-present Dmitry Soshnikov <dmitry.soshnikov@gmail.com>
+ */
+
+#pragma once
+
+#include <stdint.h>
+#include <array>
+#include <vector>
+
+#include "../../Value/Value.h"
+#include "../IAllocator.h"
+
+/**
+ * Segregated Free List Allocator.
+ *
+ * Instead of one free list, maintains a set of "bins", each storing
+ * free blocks of its size class:
+ *
+ *   - Small classes are word-granular: 4, 8, 12, ..., 64 bytes. A block
+ *     from a small bin is an exact fit for the request.
+ *
+ *   - Large classes are powers of two: [65, 128), [128, 256), ... Any
+ *     block from a class above the ceiling of the request fits it.
+ *
+ * A bitmap of non-empty bins allows finding the first suitable bin
+ * with one bit scan, so both allocation and freeing are O(1). If no bin
+ * above the ceiling class of a large request is available, a bounded
+ * number of the blocks in its floor class is checked (first fit).
+ *
+ *  Bins:
+ *
+ *   [4]  -> 0x14 -> 0x2C
+ *   [8]  -> 0x40
+ *   [12] -> (empty)
+ *   ...
+ *   [128, 256) -> 0x80
+ *
+ * The block layout is the same as in the SingleFreeListAllocator: the
+ * object header is stored in the word prior to the payload pointer.
+ */
+class SegregatedFreeListAllocator : public IAllocator {
+  /**
+   * Total object count on the heap.
+   */
+  uint32_t _objectCount;
+
+  /**
+   * Number of word-granular size classes (up to `SMALL_LIMIT` bytes).
+   */
+  static constexpr uint32_t SMALL_CLASSES = 16;
+
+  /**
+   * Largest block size served by an exact-fit small class.
+   */
+  static constexpr uint32_t SMALL_LIMIT = SMALL_CLASSES * sizeof(Word);
+
+  /**
+   * Total number of classes: small ones, and a power-of-two class
+   * for each remaining bit of the 32-bit size.
+   */
+  static constexpr uint32_t CLASSES = SMALL_CLASSES + 32 - 6;
+
+  /**
+   * Largest block size which can be recorded in the object header.
+   */
+  static constexpr uint32_t MAX_BLOCK_SIZE = ObjectHeader::MAX_SIZE;
+
+  /**
+   * Number of the last blocks of the floor class, checked for a large
+   * request, which doesn't fit a higher class.
+   */
+  static constexpr uint32_t FLOOR_PROBE = 8;
+
+  /**
+   * Free blocks (header addresses) per size class.
+   */
+  std::array<std::vector<Word>, CLASSES> bins;
+
+  /**
+   * Bit `i` is set if the bin `i` is not empty.
+   */
+  uint64_t binMap;
+
+  /**
+   * Size of the heap chunk, for which the first block is recorded.
+   */
+  static constexpr uint32_t CHUNK_SIZE = 256;
+
+  /**
+   * Header address of the first block, starting in each chunk (UINT32_MAX
+   * if a larger block spans the whole chunk). The blocks are only split,
+   * and never merged, so a recorded start stays valid until the reset.
+   */
+  std::vector<Word> _chunkStarts;
+
+ public:
+  SegregatedFreeListAllocator(std::shared_ptr<Heap> heap)
+      : IAllocator(heap), bins(), binMap(0) {
+    reset();
+  }
+
+  ~SegregatedFreeListAllocator() {}
+
+  /**
+   * Allocates a memory chunk with an object header.
+   * The payload pointer is set to the first byte (after the header).
+   *
+   * Value::Pointer(nullptr) payload signals OOM.
+   */
+  Value allocate(uint32_t n);
+
+  /**
+   * Returns the block to the bin of its size class.
+   */
+  void free(Word address);
+
+  /**
+   * Resets the allocator.
+   */
+  void reset();
+
+  /**
+   * Resets the allocator to the compaction frontier.
+   */
+  void resetFrontier(Word frontier, uint32_t objectCount);
+
+  /**
+   * Returns the reference to the object header (inlined to the direct
+   * calls of the collectors, and the BasicMemoryManager).
+   */
+  inline ObjectHeader* getHeader(Word address) {
+    return (ObjectHeader*)(heap->asBytePointer(address) -
+                           sizeof(ObjectHeader));
+  }
+
+  /**
+   * Returns total amount of objects on the heap.
+   */
+  uint32_t getObjectCount();
+
+  /**
+   * Returns child pointers of this object.
+   */
+  std::vector<Value*> getPointers(Word address);
+
+  /**
+   * Returns the header address of the block, which contains
+   * the `address` (or starts before it).
+   */
+  Word findBlockStart(Word address);
+
+  /**
+   * Returns the size class of a free block of size `n`.
+   */
+  static uint32_t blockClass(uint32_t n);
+
+  /**
+   * Returns the first size class, all blocks of which fit `n` bytes.
+   */
+  static uint32_t requestClass(uint32_t n);
+
+ private:
+  bool _takeBlock(uint32_t n, Word& block);
+  void _pushBlock(Word block);
+  void _resetBins(Word address = 0);
+  void _addBlockStart(Word block);
+  void _rebuildChunkStarts();
+};
@@ -0,0 +1,95 @@
+/**
+ * The MIT License (MIT)
+ * Copyright (c) 2018-present Dmitry Soshnikov <dmitry.soshnikov@gmail.com>
+ */
+
+#include "SemiSpaceAllocator.h"
+
+#include <cstring>
+
+/**
+ * Allocates a memory chunk with an object header, bumping the cursor.
+ *
+ * Value::Pointer(nullptr) payload signals OOM.
+ */
+Value SemiSpaceAllocator::allocate(uint32_t n) {
+  n = align<Word>(n);
+
+  if (n > MAX_BLOCK_SIZE ||
+      _spaceEnd - _cursor < sizeof(ObjectHeader) + n) {
+    return Value::Pointer(nullptr);
+  }
+
+  *(ObjectHeader*)heap->asBytePointer(_cursor) =
+      ObjectHeader{.used = 1, .size = (ObjectHeader::Size)n};
+
+  auto payload = _cursor + sizeof(ObjectHeader);
+  _cursor = payload + n;
+
+  // Update total object count.
+  _objectCount++;
+
+  return Value::Pointer(payload);
+}
+
+/**
+ * Marks the block as free. The memory is reclaimed
+ * by the next copying collection.
+ */
+void SemiSpaceAllocator::free(Word address) {
+  getHeader(address)->used = 0;
+
+  // Update total object count.
+  _objectCount--;
+}
+
+/**
+ * Returns child pointers of this object.
+ */
+std::vector<Value*> SemiSpaceAllocator::getPointers(Word address) {
+  std::vector<Value*> pointers;
+  forEachPointer(address, [&](Value* v) { pointers.push_back(v); });
+  return pointers;
+}
+
+/**
+ * Returns total amount of objects in the current space.
+ */
+uint32_t SemiSpaceAllocator::getObjectCount() { return _objectCount; }
+
+/**
+ * Resets the allocator (the first half is the current space).
+ */
+void SemiSpaceAllocator::reset() {
+  _spaceStart = 0;
+  _spaceEnd = _spaceSize();
+  _cursor = _spaceStart;
+  _objectCount = 0;
+}
+
+/**
+ * Resets the cursor to the `frontier` of the current space.
+ */
+void SemiSpaceAllocator::resetFrontier(Word frontier, uint32_t objectCount) {
+  _cursor = frontier;
+  _objectCount = objectCount;
+}
+
+/**
+ * Switches to the other space, which becomes empty.
+ */
+void SemiSpaceAllocator::flip() {
+  _spaceStart = _spaceStart == 0 ? _spaceSize() : 0;
+  _spaceEnd = _spaceStart + _spaceSize();
+  _cursor = _spaceStart;
+  _objectCount = 0;
+}
+
+/**
+ * Clears the space, which is not current (after the copying), so the
+ * new objects never see the stale pointers.
+ */
+void SemiSpaceAllocator::clearOtherSpace() {
+  auto other = _spaceStart == 0 ? _spaceSize() : 0;
+  memset(heap->asBytePointer(other), 0, _spaceSize());
+}
@@ -0,0 +1,135 @@
+/**
+ * The MIT License (MIT)
+ * Copyright (c) 2018-present Dmitry Soshnikov <dmitry.soshnikov@gmail.com>
+ */
+
+#pragma once
+
+#include <stdint.h>
+#include <vector>
+
+#include "../../Value/Value.h"
+#include "../../util/number-util.h"
+#include "../IAllocator.h"
+
+/**
+ * Semi-space allocator.
+ *
+ * The heap is split into two equal halves (semi-spaces), and only one
+ * of them is used at a time. Allocation is a pointer bump in the
+ * current space:
+ *
+ *  +--------+--------+-----------------+--------------------------+
+ *  | Object | Object |      Free       |         (unused)         |
+ *  +--------+--------+-----------------+--------------------------+
+ *  ^                 ^                 ^                          ^
+ *  Space start       Cursor            Space end                  Heap size
+ *
+ * A copying collector (SemiSpaceGC) `flip`s the spaces, and copies the
+ * alive objects to the new current space with the `allocate`, after
+ * which the old space is cleared.
+ */
+class SemiSpaceAllocator : public IAllocator {
+  /**
+   * Total object count in the current space.
+   */
+  uint32_t _objectCount;
+
+  /**
+   * Current space bounds.
+   */
+  Word _spaceStart;
+  Word _spaceEnd;
+
+  /**
+   * Address of the next block header.
+   */
+  Word _cursor;
+
+  /**
+   * Largest block size which can be recorded in the object header.
+   */
+  static constexpr uint32_t MAX_BLOCK_SIZE = ObjectHeader::MAX_SIZE;
+
+ public:
+  SemiSpaceAllocator(std::shared_ptr<Heap> heap) : IAllocator(heap) {
+    reset();
+  }
+
+  ~SemiSpaceAllocator() {}
+
+  /**
+   * Allocates a memory chunk with an object header, bumping the cursor.
+   *
+   * Value::Pointer(nullptr) payload signals OOM.
+   */
+  Value allocate(uint32_t n);
+
+  /**
+   * Marks the block as free. The memory is reclaimed
+   * by the next copying collection.
+   */
+  void free(Word address);
+
+  /**
+   * Resets the allocator (the first half is the current space).
+   */
+  void reset();
+
+  /**
+   * Resets the cursor to the `frontier` of the current space.
+   */
+  void resetFrontier(Word frontier, uint32_t objectCount);
+
+  /**
+   * Returns the reference to the object header (inlined to the direct
+   * calls of the collectors, and the BasicMemoryManager).
+   */
+  inline ObjectHeader* getHeader(Word address) {
+    return (ObjectHeader*)(heap->asBytePointer(address) -
+                           sizeof(ObjectHeader));
+  }
+
+  /**
+   * Returns total amount of objects in the current space.
+   */
+  uint32_t getObjectCount();
+
+  /**
+   * Returns child pointers of this object.
+   */
+  std::vector<Value*> getPointers(Word address);
+
+  /**
+   * Switches to the other space, which becomes empty.
+   */
+  void flip();
+
+  /**
+   * Clears the space, which is not current (after the copying).
+   */
+  void clearOtherSpace();
+
+  /**
+   * Whether the address is in the current space.
+   */
+  bool contains(Word address) {
+    return address >= _spaceStart && address < _spaceEnd;
+  }
+
+  /**
+   * Returns the start address of the current space.
+   */
+  Word getSpaceStart() { return _spaceStart; }
+
+  /**
+   * Returns the address of the next block header.
+   */
+  Word getCursor() { return _cursor; }
+
+ private:
+  /**
+   * Size of a semi-space.
+   */
+  Word _spaceSize() { return heap->size() / 2 / sizeof(Word) * sizeof(Word); }
+};
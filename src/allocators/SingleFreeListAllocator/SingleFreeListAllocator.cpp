@@ -6,6 +6,9 @@
 #include "SingleFreeListAllocator.h"
 #include "../../util/number-util.h"
 
+#include <algorithm>
+#include <thread>
+
 /**
  * Allocates a memory chunk with an object header.
  * The payload pointer is set to the first byte (after the header).
@@ -17,10 +20,10 @@
  * Value::Pointer(nullptr) payload signals OOM.
  */
 Value SingleFreeListAllocator::allocate(uint32_t n) {
-  n = align<uint32_t>(n);
+  n = std::max(align<uint32_t>(n), MIN_BLOCK_SIZE);
 
-  for (const auto& free : freeList) {
-    auto header = (ObjectHeader*)(heap->asWordPointer(free));
+  for (auto payload = freeList; payload != 0; payload = _links(payload)[0]) {
+    auto header = getHeader(payload);
     auto size = header->size;
 
     // Too small block, move further.
@@ -28,27 +31,31 @@ Value SingleFreeListAllocator::allocate(uint32_t n) {
       continue;
     }
 
-    // Found block of a needed size:
-    freeList.remove(free);
-
-    auto rawPayload = ((Word*)header) + 1;
-    auto payload = heap->asVirtualAddress(rawPayload);
+    // Found block of a needed size, unlink it:
+    _unlink(payload);
 
     // See if we can split the larger block, reserving at least
-    // one word with a header.
-    auto canSplit = (size >= n + (sizeof(Word) * 2));
+    // the smallest block with a header.
+    auto canSplit = (size >= n + sizeof(ObjectHeader) + MIN_BLOCK_SIZE);
 
     if (canSplit) {
       // This block becomes of size `n`.
       header->size = n;
 
-      // Split the new block.
+      // Split the new block, which goes back to the free list,
+      // and becomes the boundary tag of the following block.
       auto nextHeaderP = payload + n;
-      auto nextSize = (uint8_t)(size - n - sizeof(ObjectHeader));
-      *heap->asWordPointer(nextHeaderP) = ObjectHeader{.size = nextSize};
-      freeList.push_back(nextHeaderP);
+      auto nextSize = (ObjectHeader::Size)(size - n - sizeof(ObjectHeader));
+      *(ObjectHeader*)heap->asBytePointer(nextHeaderP) = ObjectHeader{.size = nextSize};
+      _push(nextHeaderP + sizeof(ObjectHeader));
+      _setBoundaryTag(nextHeaderP + sizeof(ObjectHeader));
+      _addBlockStart(nextHeaderP);
+    } else {
+      _clearBoundaryTag(payload);
     }
 
+    header->used = 1;
+
     // Update total object count.
     _objectCount++;
 
@@ -59,45 +66,66 @@ Value SingleFreeListAllocator::allocate(uint32_t n) {
 }
 
 /**
- * Returns the block to the allocator.
+ * Returns the block to the allocator, coalescing it with the
+ * adjacent free blocks.
+ *
+ * The next block is found by the size, and the previous one by the
+ * boundary tag (the `prevFree` bit, and the size in the `forward`
+ * field of this header), so the merge is O(1):
+ *
+ *  +-----+-------+   +------------+---------+   +-----+-------+
+ *  | Hdr | Free  |   | Hdr: prev  | Freed   |   | Hdr | Free  |
+ *  |     | (8)   |   | free, 8    | block   |   |     |       |
+ *  +-----+-------+   +------------+---------+   +-----+-------+
+ *  ^------------------ merged free block ---------------------^
  */
 void SingleFreeListAllocator::free(Word address) {
   auto header = getHeader(address);
+  header->used = 0;
+
+  auto block = address;
+  auto size = header->size;
+
+  // Coalesce with the next block, if it's free.
+  auto next = address + size + sizeof(ObjectHeader);
+
+  if (next < heap->size()) {
+    auto nextHeader = getHeader(next);
+    auto mergedSize = size + sizeof(ObjectHeader) + nextHeader->size;
+
+    if (!nextHeader->used && mergedSize <= MAX_BLOCK_SIZE) {
+      _unlink(next);
+      size = mergedSize;
+      _removeBlockStart(next - sizeof(ObjectHeader), address + size);
+    }
+  }
+
+  // Coalesce with the previous block, if it's free. It's
+  // already in the free list, and just grows.
+  auto mergedSize = header->getForward() + sizeof(ObjectHeader) + size;
 
-  freeList.push_back((uint8_t*)header - heap->asBytePointer(0));
+  if (header->prevFree && mergedSize <= MAX_BLOCK_SIZE) {
+    block = address - sizeof(ObjectHeader) - header->getForward();
+    _freeSize += mergedSize - getHeader(block)->size;
+    getHeader(block)->size = mergedSize;
+    _removeBlockStart(address - sizeof(ObjectHeader), address + size);
+  } else {
+    header->size = size;
+    _push(block);
+  }
 
-  // Reset the block to 0.
-  memset(heap->asBytePointer(address), header->size, 0x0);
+  _setBoundaryTag(block);
 
   // Update total object count.
   _objectCount--;
 }
 
-/**
- * Returns the reference to the object header.
- */
-ObjectHeader* SingleFreeListAllocator::getHeader(Word address) {
-  return (ObjectHeader*)(heap->asWordPointer(address) - 1);
-}
-
 /**
  * Returns child pointers of this object.
  */
 std::vector<Value*> SingleFreeListAllocator::getPointers(Word address) {
   std::vector<Value*> pointers;
-
-  auto header = getHeader(address);
-  auto words = header->size / sizeof(Word);
-
-  while (words-- > 0) {
-    auto v = (Value*)heap->asWordPointer(address);
-    address += sizeof(Word);
-    if (!v->isPointer() || v->isNullPointer()) {
-      continue;
-    }
-    pointers.push_back(v);
-  }
-
+  forEachPointer(address, [&](Value* v) { pointers.push_back(v); });
   return pointers;
 }
 
@@ -110,22 +138,438 @@ uint32_t SingleFreeListAllocator::getObjectCount() { return _objectCount; }
  * Resets the allocator.
  */
 void SingleFreeListAllocator::reset() {
-  _resetFirstBlock();
   _resetFreeList();
+  _rebuildChunkStarts();
   _objectCount = 0;
 }
 
-void SingleFreeListAllocator::_resetFreeList() {
-  freeList.clear();
-  freeList.push_back(0);
+/**
+ * Resets the allocator to the compaction frontier: the rest
+ * of the heap after the frontier becomes free.
+ */
+void SingleFreeListAllocator::resetFrontier(Word frontier,
+                                            uint32_t objectCount) {
+  _resetFreeList(frontier);
+  _rebuildChunkStarts();
+  _objectCount = objectCount;
+}
+
+/**
+ * Adapts the allocator to the resized heap: the grown space is split
+ * into the free blocks, and the released space is removed from the
+ * free list, if all its blocks are free.
+ */
+bool SingleFreeListAllocator::resize(uint32_t oldSize) {
+  auto resized = heap->size() >= oldSize ? _grow(oldSize) : _shrink(oldSize);
+
+  if (resized) {
+    _rebuildChunkStarts();
+  }
+
+  return resized;
 }
 
 /**
- * Initially the object header stored at the beginning
- * of the heap defines the whole heap as a "free block".
+ * Returns the amount of the free memory (the payloads of the free blocks).
+ * It's counted, as the blocks are linked, and unlinked.
+ */
+uint32_t SingleFreeListAllocator::getFreeSize() { return _freeSize; }
+
+/**
+ * The new free blocks start after the last block of the old heap
+ * (there may be a tail, too small for a block, before the old end).
  */
-void SingleFreeListAllocator::_resetFirstBlock() {
-  *heap->asWordPointer(0) = ObjectHeader{
-      .size = (uint8_t)(heap->size() - sizeof(ObjectHeader)),
+bool SingleFreeListAllocator::_grow(uint32_t oldSize) {
+  auto block = findBlockStart(oldSize - 1);
+  Word last = 0;
+
+  while (oldSize - block >= sizeof(ObjectHeader) + MIN_BLOCK_SIZE) {
+    last = block + sizeof(ObjectHeader);
+    block = last + getHeader(last)->size;
+  }
+
+  _addFreeSpace(block);
+
+  // The first new block may be merged with the last free one.
+  if (last != 0 && !getHeader(last)->used) {
+    _setBoundaryTag(last);
+  }
+
+  return true;
+}
+
+/**
+ * The blocks from the one, which contains the new end, are unlinked.
+ * The part of that block before the new end stays free.
+ */
+bool SingleFreeListAllocator::_shrink(uint32_t oldSize) {
+  auto size = heap->size();
+  auto first = findBlockStart(size);
+
+  while (oldSize - first >= sizeof(ObjectHeader) + MIN_BLOCK_SIZE) {
+    auto payload = first + sizeof(ObjectHeader);
+    auto next = payload + getHeader(payload)->size;
+
+    if (next > size) {
+      break;
+    }
+    first = next;
+  }
+
+  auto rest = size - first;
+  if (rest > 0 && rest < sizeof(ObjectHeader) + MIN_BLOCK_SIZE) {
+    return false;
+  }
+
+  std::vector<Word> released;
+
+  for (auto block = first;
+       oldSize - block >= sizeof(ObjectHeader) + MIN_BLOCK_SIZE;) {
+    auto payload = block + sizeof(ObjectHeader);
+    if (getHeader(payload)->used) {
+      return false;
+    }
+    released.push_back(payload);
+    block = payload + getHeader(payload)->size;
+  }
+
+  for (const auto& payload : released) {
+    _unlink(payload);
+  }
+
+  if (rest > 0) {
+    auto payload = first + sizeof(ObjectHeader);
+    getHeader(payload)->size = rest - sizeof(ObjectHeader);
+    _push(payload);
+  }
+
+  return true;
+}
+
+/**
+ * Links of the free block: the next (index 0), and
+ * the previous (index 1) free block payload addresses.
+ */
+SingleFreeListAllocator::Link* SingleFreeListAllocator::_links(Word block) {
+  return (Link*)heap->asWordPointer(block);
+}
+
+/**
+ * Pushes the free block to the head of the free list.
+ */
+void SingleFreeListAllocator::_push(Word block) {
+  _freeSize += getHeader(block)->size;
+
+  auto links = _links(block);
+  links[0] = freeList;
+  links[1] = 0;
+
+  if (freeList != 0) {
+    _links(freeList)[1] = block;
+  }
+  freeList = block;
+}
+
+/**
+ * Removes the free block from the free list.
+ */
+void SingleFreeListAllocator::_unlink(Word block) {
+  _freeSize -= getHeader(block)->size;
+
+  auto links = _links(block);
+  auto next = links[0];
+  auto prev = links[1];
+
+  if (prev != 0) {
+    _links(prev)[0] = next;
+  } else {
+    freeList = next;
+  }
+
+  if (next != 0) {
+    _links(next)[1] = prev;
+  }
+}
+
+/**
+ * Records the size of the free block in the header
+ * of the following block.
+ */
+void SingleFreeListAllocator::_setBoundaryTag(Word block) {
+  auto size = getHeader(block)->size;
+  auto next = block + size + sizeof(ObjectHeader);
+
+  if (next < heap->size()) {
+    auto nextHeader = getHeader(next);
+    nextHeader->prevFree = 1;
+    nextHeader->setForward(size);
+  }
+}
+
+/**
+ * Clears the boundary tag, once the block becomes allocated.
+ */
+void SingleFreeListAllocator::_clearBoundaryTag(Word block) {
+  auto next = block + getHeader(block)->size + sizeof(ObjectHeader);
+
+  if (next < heap->size()) {
+    getHeader(next)->prevFree = 0;
+  }
+}
+
+/**
+ * Initially the free space (the whole heap, or the rest of it after
+ * the `address`) is split into the largest blocks which can be recorded
+ * in the header, and all of them are put into the free list in
+ * the address order.
+ */
+void SingleFreeListAllocator::_resetFreeList(Word address) {
+  freeList = 0;
+  _freeSize = 0;
+  _addFreeSpace(address);
+}
+
+/**
+ * Splits the free space after the `address` (up to the end of the heap)
+ * into the largest blocks, and appends them to the free list.
+ */
+void SingleFreeListAllocator::_addFreeSpace(Word address) {
+  auto tail = freeList;
+  while (tail != 0 && _links(tail)[0] != 0) {
+    tail = _links(tail)[0];
+  }
+
+  auto block = address;
+
+  while (block < heap->size() &&
+         heap->size() - block >= sizeof(ObjectHeader) + MIN_BLOCK_SIZE) {
+    auto rest = heap->size() - block - sizeof(ObjectHeader);
+    auto size = std::min<uint32_t>(rest, MAX_BLOCK_SIZE);
+
+    // Don't leave a tail which is too small for a block.
+    auto minTail = sizeof(ObjectHeader) + MIN_BLOCK_SIZE;
+    if (rest > size && rest - size < minTail) {
+      size -= minTail - (rest - size);
+    }
+
+    *(ObjectHeader*)heap->asBytePointer(block) = ObjectHeader{.size = (ObjectHeader::Size)size};
+
+    auto payload = block + sizeof(ObjectHeader);
+    auto links = _links(payload);
+    links[0] = 0;
+    links[1] = tail;
+
+    if (tail != 0) {
+      _links(tail)[0] = payload;
+      _setBoundaryTag(tail);
+    } else {
+      freeList = payload;
+    }
+
+    _freeSize += size;
+    tail = payload;
+    block = payload + size;
+  }
+}
+
+/**
+ * Returns the first block of the chunk of the `address`. If a larger
+ * block spans the chunk start, the block of a previous chunk is used.
+ */
+Word SingleFreeListAllocator::findBlockStart(Word address) {
+  for (int k = address / SWEEP_CHUNK_SIZE; k >= 0; k--) {
+    if (_chunkStarts[k] <= address) {
+      return _chunkStarts[k];
+    }
+  }
+  return 0;
+}
+
+/**
+ * Sweeps the chunks of the heap in parallel.
+ *
+ * Each thread walks its range of chunks, reclaims the dead blocks,
+ * coalesces the adjacent free blocks (within its range), and links them
+ * into its own free list. The lists are spliced together in the address
+ * order, and the boundary tags, which fall into the next range,
+ * are set at the end.
+ */
+bool SingleFreeListAllocator::sweepParallel(
+    uint32_t threads, const std::function<bool(Word)>& isAlive,
+    uint32_t& reclaimed) {
+  auto chunks = (uint32_t)_chunkStarts.size();
+  auto threadCount = std::min(threads, chunks);
+
+  std::vector<SweepList> lists(threadCount);
+
+  // The first block of each range is taken before the sweep, since
+  // the coalescing updates the chunk starts.
+  std::vector<Word> starts(threadCount);
+  for (uint32_t id = 0; id < threadCount; id++) {
+    starts[id] = _chunkStarts[chunks * id / threadCount];
+  }
+
+  auto worker = [&](uint32_t id) {
+    auto to = chunks * (id + 1) / threadCount;
+    auto end = std::min<Word>(to * SWEEP_CHUNK_SIZE, heap->size());
+    _sweepChunks(starts[id], end, isAlive, lists[id]);
   };
+
+  std::vector<std::thread> workers;
+  for (uint32_t id = 1; id < threadCount; id++) {
+    workers.emplace_back(worker, id);
+  }
+  worker(0);
+
+  for (auto& thread : workers) {
+    thread.join();
+  }
+
+  // Splice the lists.
+  freeList = 0;
+  _freeSize = 0;
+  reclaimed = 0;
+  Word tail = 0;
+
+  for (const auto& list : lists) {
+    reclaimed += list.reclaimed;
+    _freeSize += list.freeSize;
+
+    if (list.lastFree != 0) {
+      _setBoundaryTag(list.lastFree);
+    }
+
+    if (list.head == 0) {
+      continue;
+    }
+
+    if (tail != 0) {
+      _links(tail)[0] = list.head;
+      _links(list.head)[1] = tail;
+    } else {
+      freeList = list.head;
+    }
+    tail = list.tail;
+  }
+
+  _objectCount -= reclaimed;
+
+  return true;
+}
+
+/**
+ * Sweeps the blocks, starting from the `block` (header address), which
+ * start before the `end`. The runs of the free blocks are coalesced.
+ */
+void SingleFreeListAllocator::_sweepChunks(
+    Word block, Word end, const std::function<bool(Word)>& isAlive,
+    SweepList& list) {
+  Word run = 0;
+  uint32_t runSize = 0;
+
+  while (block < end &&
+         heap->size() - block >= sizeof(ObjectHeader) + MIN_BLOCK_SIZE) {
+    auto payload = block + sizeof(ObjectHeader);
+    auto header = getHeader(payload);
+    auto size = header->size;
+
+    if (header->used && isAlive(payload)) {
+      if (run != 0) {
+        _appendRun(run, runSize, end, list);
+        run = 0;
+      }
+    } else {
+      if (header->used) {
+        header->used = 0;
+        list.reclaimed++;
+      }
+
+      auto mergedSize = runSize + sizeof(ObjectHeader) + size;
+
+      if (run != 0 && mergedSize <= MAX_BLOCK_SIZE) {
+        runSize = mergedSize;
+        _removeBlockStart(block, payload + size);
+      } else {
+        if (run != 0) {
+          _appendRun(run, runSize, end, list);
+        }
+        run = payload;
+        runSize = size;
+      }
+    }
+
+    block = payload + size;
+  }
+
+  if (run != 0) {
+    _appendRun(run, runSize, end, list);
+  }
+}
+
+/**
+ * Appends the coalesced run of the free blocks to the chunk free list,
+ * and sets its boundary tag (unless it's in the next range of chunks).
+ */
+void SingleFreeListAllocator::_appendRun(Word run, uint32_t size, Word end,
+                                         SweepList& list) {
+  getHeader(run)->size = size;
+  list.freeSize += size;
+
+  auto links = _links(run);
+  links[0] = 0;
+  links[1] = list.tail;
+
+  if (list.tail != 0) {
+    _links(list.tail)[0] = run;
+  } else {
+    list.head = run;
+  }
+  list.tail = run;
+
+  if (run + size < end) {
+    _setBoundaryTag(run);
+  } else {
+    list.lastFree = run;
+  }
+}
+
+/**
+ * Walks the heap, and records the first block of each chunk.
+ */
+void SingleFreeListAllocator::_rebuildChunkStarts() {
+  auto chunks = (heap->size() + SWEEP_CHUNK_SIZE - 1) / SWEEP_CHUNK_SIZE;
+  _chunkStarts.assign(chunks, heap->size());
+
+  Word block = 0;
+
+  while (heap->size() - block >= sizeof(ObjectHeader) + MIN_BLOCK_SIZE) {
+    if (_chunkStarts[block / SWEEP_CHUNK_SIZE] == heap->size()) {
+      _addBlockStart(block);
+    }
+    block += sizeof(ObjectHeader) + getHeader(block + sizeof(ObjectHeader))->size;
+  }
+}
+
+/**
+ * A new block is split at the `block` header address. It also becomes
+ * the start of the preceding chunks which have no own blocks.
+ */
+void SingleFreeListAllocator::_addBlockStart(Word block) {
+  for (int k = block / SWEEP_CHUNK_SIZE; k >= 0 && _chunkStarts[k] > block;
+       k--) {
+    _chunkStarts[k] = block;
+  }
+}
+
+/**
+ * The block at the `block` header address is merged into the previous
+ * one, and the `following` block takes its place in the chunk starts.
+ */
+void SingleFreeListAllocator::_removeBlockStart(Word block, Word following) {
+  following = std::min<Word>(following, heap->size());
+
+  for (int k = block / SWEEP_CHUNK_SIZE; k >= 0 && _chunkStarts[k] == block;
+       k--) {
+    _chunkStarts[k] = following;
+  }
 }
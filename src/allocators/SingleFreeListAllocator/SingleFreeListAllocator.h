@@ -6,7 +6,6 @@
 #pragma once
 
 #include <stdint.h>
-#include <list>
 #include <vector>
 
 #include "../../Value/Value.h"
@@ -18,6 +17,23 @@
  *
  * Maintains a linked list of available blocks.
  *
+ * The list is intrusive, and is stored in the heap itself: the first
+ * payload word of a free block contains (16-bit) payload addresses of
+ * the next, and the previous free blocks, 0 terminates the list. So the
+ * free list maintenance doesn't allocate any memory outside the heap.
+ * In the large heap mode (MMGC_LARGE_HEAP) the links are 32-bit, and
+ * take two payload words.
+ *
+ *  freeList -> +----+------+-----------+    +----+------+-----------+
+ *              | GC | Size | 0x00 0x1C | <> | GC | Size | 0x04 0x00 |
+ *              +----+------+-----------+    +----+------+-----------+
+ *                            prev next
+ *
+ * Adjacent free blocks are coalesced on `free`, using boundary tags.
+ *
+ * For the parallel sweep the heap is split into chunks, which are walked
+ * independently: the allocator tracks the first block of each chunk.
+ *
  * On allocation returns a pointer, set to the next byte after the
  * object header. Maintains the Free list abstraction for allocation.
  *
@@ -34,14 +50,65 @@ class SingleFreeListAllocator : public IAllocator {
   uint32_t _objectCount;
 
   /**
-   * Free list: linked list of all free memory chunks.
+   * Free list: payload address of the first free block, or 0
+   * if there are no free blocks.
    */
-  std::list<uint32_t> freeList;
+  Word freeList;
+
+  /**
+   * Total payload size of the free blocks, kept with the free list.
+   */
+  uint32_t _freeSize;
+
+  /**
+   * Largest block size which can be recorded in the object header.
+   */
+  static constexpr uint32_t MAX_BLOCK_SIZE = ObjectHeader::MAX_SIZE;
+
+  /**
+   * Size of the independently walkable heap chunk.
+   */
+  static constexpr uint32_t SWEEP_CHUNK_SIZE = 1024;
+
+  /**
+   * Header address of the first block, starting in each chunk (or the
+   * next block after the chunk, if a larger block spans the whole chunk).
+   */
+  std::vector<Word> _chunkStarts;
+
+  /**
+   * Free list, built by a sweeping thread for its chunks.
+   */
+  struct SweepList {
+    Word head = 0;
+    Word tail = 0;
+
+    /**
+     * Last free block, which boundary tag is in the next chunk.
+     */
+    Word lastFree = 0;
+
+    uint32_t reclaimed = 0;
+    uint32_t freeSize = 0;
+  };
 
  public:
+  /**
+   * Free list link: the payload address of the neighbour free block.
+   */
+#ifdef MMGC_LARGE_HEAP
+  using Link = uint32_t;
+#else
+  using Link = uint16_t;
+#endif
+
+  /**
+   * Smallest block size, which can store the free list links.
+   */
+  static constexpr uint32_t MIN_BLOCK_SIZE = 2 * sizeof(Link);
 
   SingleFreeListAllocator(std::shared_ptr<Heap> heap)
-      : IAllocator(heap), freeList() {
+      : IAllocator(heap), freeList(0) {
     reset();
   }
 
@@ -60,7 +127,8 @@ class SingleFreeListAllocator : public IAllocator {
   Value allocate(uint32_t n);
 
   /**
-   * Returns the block to the allocator.
+   * Returns the block to the allocator, coalescing
+   * it with the adjacent free blocks.
    */
   void free(Word address);
 
@@ -70,9 +138,28 @@ class SingleFreeListAllocator : public IAllocator {
   void reset();
 
   /**
-   * Returns the reference to the object header.
+   * Resets the allocator to the compaction frontier.
+   */
+  void resetFrontier(Word frontier, uint32_t objectCount);
+
+  /**
+   * Adapts the allocator to the resized heap.
+   */
+  bool resize(uint32_t oldSize);
+
+  /**
+   * Returns the amount of the free memory in the heap.
    */
-  ObjectHeader* getHeader(Word address);
+  uint32_t getFreeSize();
+
+  /**
+   * Returns the reference to the object header (inlined to the direct
+   * calls of the collectors, and the BasicMemoryManager).
+   */
+  inline ObjectHeader* getHeader(Word address) {
+    return (ObjectHeader*)(heap->asBytePointer(address) -
+                           sizeof(ObjectHeader));
+  }
 
   /**
    * Returns total amount of objects on the heap.
@@ -84,7 +171,35 @@ class SingleFreeListAllocator : public IAllocator {
    */
   std::vector<Value*> getPointers(Word address);
 
+  /**
+   * Returns the first block of the chunk of the `address`
+   * (using the chunk starts table).
+   */
+  Word findBlockStart(Word address);
+
+  /**
+   * Sweeps the chunks of the heap in parallel, each thread builds
+   * a free list for its chunks, and the lists are spliced together.
+   */
+  bool sweepParallel(uint32_t threads,
+                     const std::function<bool(Word)>& isAlive,
+                     uint32_t& reclaimed);
+
  private:
-  void _resetFreeList();
-  void _resetFirstBlock();
+  Link* _links(Word block);
+  void _push(Word block);
+  void _unlink(Word block);
+  void _setBoundaryTag(Word block);
+  void _clearBoundaryTag(Word block);
+  void _resetFreeList(Word address = 0);
+  void _addFreeSpace(Word address);
+  bool _grow(uint32_t oldSize);
+  bool _shrink(uint32_t oldSize);
+  void _rebuildChunkStarts();
+  void _addBlockStart(Word block);
+  void _removeBlockStart(Word block, Word following);
+  void _sweepChunks(Word block, Word end,
+                    const std::function<bool(Word)>& isAlive,
+                    SweepList& list);
+  void _appendRun(Word run, uint32_t size, Word end, SweepList& list);
 };
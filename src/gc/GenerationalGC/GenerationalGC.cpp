@@ -0,0 +1,340 @@
+/**
+ * The MIT License (MIT)
+ * Copyright (c) 2018-present Dmitry Soshnikov <dmitry.soshnikov@gmail.com>
+ */
+
+#include "GenerationalGC.h"
+#include "../../MemoryManager/ObjectHeader.h"
+
+#include <algorithm>
+#include <cstring>
+
+GenerationalGC::GenerationalGC(const std::shared_ptr<IAllocator>& allocator,
+                               uint32_t nurserySize)
+    : ICollector(allocator) {
+  auto heap = allocator->heap;
+
+  if (nurserySize == 0) {
+    nurserySize = align<Word>(heap->size() / NURSERY_RATIO);
+  }
+
+  nursery = std::make_shared<Nursery>(heap, nurserySize);
+  writeBarrierEnabled = true;
+
+  // The cards cover the old space, and the large object space.
+  _cards.assign((heap->largeObjectSpaceEnd() + CARD_SIZE - 1) / CARD_SIZE, 0);
+}
+
+/**
+ * Minor collection: evacuates the young survivors to the old space.
+ * If they don't fit, the major collection is run.
+ */
+std::shared_ptr<GCStats> GenerationalGC::collect() {
+  stats->total = nursery->getObjectCount();
+  stats->alive = 0;
+  stats->reclaimed = 0;
+
+  auto survivors = _markYoung();
+
+  if (!_promote(survivors)) {
+    for (const auto& survivor : survivors) {
+      nursery->getHeader(survivor)->mark = 0;
+    }
+    return collectMajor();
+  }
+
+  stats->alive = survivors.size();
+  stats->reclaimed = stats->total - stats->alive;
+
+  nursery->reset();
+  _clearCards();
+
+  return stats;
+}
+
+/**
+ * Major collection: marks the whole heap (the old, large, and young
+ * objects), sweeps the old space, and promotes the young survivors.
+ * If even then they don't fit the old space, they stay in the nursery.
+ */
+std::shared_ptr<GCStats> GenerationalGC::collectMajor() {
+  _resetStats();
+  stats->total += nursery->getObjectCount();
+
+  _markFromRoots();
+
+  stats->reclaimed += _sweepOld();
+  _sweepLargeObjects();
+
+  std::vector<Word> survivors;
+  nursery->forEachObject([&](Word address) {
+    if (nursery->getHeader(address)->mark) {
+      survivors.push_back(address);
+    }
+  });
+
+  if (!_promote(survivors)) {
+    for (const auto& survivor : survivors) {
+      nursery->getHeader(survivor)->mark = 0;
+    }
+    return stats;
+  }
+
+  stats->reclaimed += nursery->getObjectCount() - survivors.size();
+
+  nursery->reset();
+  _clearCards();
+
+  return stats;
+}
+
+/**
+ * Card marking write barrier: a young pointer written to the old
+ * space (or to the large object space) dirties the card.
+ */
+void GenerationalGC::onWrite(Word address, Value& value) {
+  if (value.isObjectPointer()) {
+    markCard(address, value.decode());
+  }
+}
+
+/**
+ * The first object: in the old space, or in the nursery,
+ * before it's promoted.
+ */
+std::vector<Word> GenerationalGC::getRootObjects() {
+  auto roots = ICollector::getRootObjects();
+
+  if (roots.empty() && nursery->getObjectCount() > 0) {
+    auto root = nursery->start() + sizeof(ObjectHeader);
+    if (nursery->getHeader(root)->used) {
+      roots.push_back(root);
+    }
+  }
+
+  return roots;
+}
+
+/**
+ * Whether the card of the address is dirty.
+ */
+bool GenerationalGC::isCardDirty(Word address) {
+  return _cards[address / CARD_SIZE] == 1;
+}
+
+/**
+ * Marks the young objects reachable from the roots, and the dirty
+ * cards. The old objects are not traced (all of them are considered
+ * alive). Returns the survivors in the address order.
+ */
+std::vector<Word> GenerationalGC::_markYoung() {
+  std::vector<Word> survivors;
+  std::vector<Word> worklist;
+
+  auto shade = [&](Word address) {
+    auto header = nursery->getHeader(address);
+    if (!header->mark) {
+      header->mark = 1;
+      survivors.push_back(address);
+      worklist.push_back(address);
+    }
+  };
+
+  for (const auto& root : getRootObjects()) {
+    if (nursery->contains(root)) {
+      shade(root);
+      continue;
+    }
+    _forEachPointer(root, [&](Value* p) {
+      if (nursery->contains(p->decode())) {
+        shade(p->decode());
+      }
+    });
+  }
+
+  _forEachRootSlot([&](Value* slot) {
+    if (nursery->contains(slot->decode())) {
+      shade(slot->decode());
+    }
+  });
+
+  _forEachCardSlot([&](Value* p) { shade(p->decode()); });
+
+  while (!worklist.empty()) {
+    auto v = worklist.back();
+    worklist.pop_back();
+
+    _forEachPointer(v, [&](Value* p) {
+      if (nursery->contains(p->decode())) {
+        shade(p->decode());
+      }
+    });
+  }
+
+  std::sort(survivors.begin(), survivors.end());
+
+  return survivors;
+}
+
+/**
+ * Copies the survivors to the old space (in the address order, so the
+ * nursery root becomes the first old object), leaving the forwarding
+ * addresses in the nursery headers, and updates the young pointers
+ * of the roots (and the root slots), the dirty cards, and the promoted
+ * objects.
+ */
+bool GenerationalGC::_promote(std::vector<Word>& survivors) {
+  auto heap = allocator->heap;
+  std::vector<Word> copies;
+
+  for (const auto& survivor : survivors) {
+    auto copy = allocator->allocate(nursery->getHeader(survivor)->size);
+
+    // Doesn't fit, the old space is not changed.
+    if (copy.isNullPointer()) {
+      for (const auto& allocated : copies) {
+        allocator->free(allocated);
+      }
+      return false;
+    }
+
+    copies.push_back(copy);
+  }
+
+  for (uint32_t i = 0; i < survivors.size(); i++) {
+    auto header = nursery->getHeader(survivors[i]);
+    header->setForward(copies[i]);
+    memcpy(heap->asBytePointer(copies[i]), heap->asBytePointer(survivors[i]),
+           header->size);
+    _moveType(survivors[i], copies[i]);
+  }
+
+  auto update = [&](Value* p) {
+    *p = Value::Pointer(nursery->getHeader(p->decode())->getForward());
+  };
+
+  for (const auto& root : ICollector::getRootObjects()) {
+    _forEachPointer(root, [&](Value* p) {
+      if (nursery->contains(p->decode())) {
+        update(p);
+      }
+    });
+  }
+
+  _forEachRootSlot([&](Value* slot) {
+    if (nursery->contains(slot->decode())) {
+      update(slot);
+    }
+  });
+
+  _forEachCardSlot(update);
+
+  for (const auto& copy : copies) {
+    _forEachPointer(copy, [&](Value* p) {
+      if (nursery->contains(p->decode())) {
+        update(p);
+      }
+    });
+  }
+
+  return true;
+}
+
+/**
+ * Calls the `callback` for each slot with a young pointer in the dirty
+ * cards. Only the slots of the used blocks are visited: the first block
+ * of a card in the heap is found by the allocator, and in the large
+ * object space a card belongs to at most one object.
+ */
+void GenerationalGC::_forEachCardSlot(
+    const std::function<void(Value*)>& callback) {
+  auto heapSize = allocator->heap->size();
+
+  for (const auto& card : _dirtyCards) {
+    auto start = card * CARD_SIZE;
+    auto end = start + CARD_SIZE;
+
+    if (start < heapSize) {
+      end = std::min(end, heapSize);
+      auto block = allocator->findBlockStart(start);
+
+      while (block < end) {
+        Word payload = block + sizeof(ObjectHeader);
+        auto header = allocator->getHeader(payload);
+
+        if (header->used) {
+          _forEachYoungSlot(std::max(payload, start),
+                            std::min(payload + header->size, end), callback);
+        }
+
+        block = payload + header->size;
+      }
+      continue;
+    }
+
+    if (largeObjects == nullptr) {
+      continue;
+    }
+
+    auto object = largeObjects->findObject(start);
+    if (object == 0) {
+      object = largeObjects->findObject(start + sizeof(ObjectHeader));
+    }
+
+    if (object != 0) {
+      _forEachYoungSlot(
+          std::max(object, start),
+          std::min(object + largeObjects->sizeOf(object), end), callback);
+    }
+  }
+}
+
+/**
+ * Calls the `callback` for each slot with a young pointer
+ * in [start, end).
+ */
+void GenerationalGC::_forEachYoungSlot(
+    Word start, Word end, const std::function<void(Value*)>& callback) {
+  for (auto address = start; address < end; address += sizeof(Word)) {
+    auto v = (Value*)allocator->heap->asWordPointer(address);
+    if (v->isPointer() && !v->isNullPointer() &&
+        nursery->contains(v->decode())) {
+      callback(v);
+    }
+  }
+}
+
+/**
+ * Sweeps the old space: resets the mark bit of the alive objects,
+ * and frees the rest.
+ */
+uint32_t GenerationalGC::_sweepOld() {
+  uint32_t reclaimed = 0;
+  auto heapSize = allocator->heap->size();
+  Word scan = sizeof(ObjectHeader);
+
+  while (scan < heapSize) {
+    auto header = allocator->getHeader(scan);
+
+    if (header->mark) {
+      header->mark = 0;
+    } else if (header->used) {
+      allocator->free(scan);
+      reclaimed++;
+    }
+
+    scan += header->size + sizeof(ObjectHeader);
+  }
+
+  return reclaimed;
+}
+
+/**
+ * Clears the card table, once there are no young objects.
+ */
+void GenerationalGC::_clearCards() {
+  for (const auto& card : _dirtyCards) {
+    _cards[card] = 0;
+  }
+  _dirtyCards.clear();
+}
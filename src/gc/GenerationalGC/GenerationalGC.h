@@ -0,0 +1,155 @@
+/**
+ * The MIT License (MIT)
+ * Copyright (c) 2018-present Dmitry Soshnikov <dmitry.soshnikov@gmail.com>
+ */
+
+#pragma once
+
+#include <functional>
+#include <memory>
+#include <vector>
+
+#include "../ICollector.h"
+
+#include "../../Value/Value.h"
+#include "../../allocators/IAllocator.h"
+
+/**
+ * Generational garbage collector.
+ *
+ * The new objects are bump-allocated in the nursery, and most of them
+ * die young. The minor collection (`collect`) evacuates the surviving
+ * young objects to the heap (the old space, managed by the free-list
+ * allocator), and resets the nursery:
+ *
+ *   - Mark: the young objects, reachable from the roots, and from
+ *     the old objects (the dirty cards), are traced
+ *   - Promote: the survivors are copied to the old space, and leave
+ *     the forwarding addresses in the nursery headers
+ *   - Update: the pointers in the dirty cards, and in the promoted
+ *     objects are set to the forwarding addresses
+ *
+ * The old-to-young pointers are tracked by the card marking write
+ * barrier: the old space (and the large object space) is split into
+ * the cards, and a write of a young pointer marks the card as dirty.
+ * So the minor collection depends on the number of the survivors, and
+ * the dirty cards, not on the heap size.
+ *
+ * The major collection (`collectMajor`) is a mark-sweep of the whole
+ * heap, which also promotes the young survivors. It's also run, when
+ * the survivors don't fit the old space.
+ *
+ * The mark bits are always in the object headers (the mark bitmap
+ * doesn't cover the nursery).
+ */
+class GenerationalGC : public ICollector {
+ public:
+  /**
+   * Size of the card (bytes of the old space per a card table entry).
+   */
+  static constexpr uint32_t CARD_SIZE = 128;
+
+  /**
+   * Nursery size is `heap size / NURSERY_RATIO` by default.
+   */
+  static constexpr uint32_t NURSERY_RATIO = 4;
+
+  GenerationalGC(const std::shared_ptr<IAllocator>& allocator,
+                 uint32_t nurserySize = 0);
+
+  /**
+   * Minor collection.
+   */
+  std::shared_ptr<GCStats> collect();
+
+  /**
+   * Major collection of the whole heap.
+   */
+  std::shared_ptr<GCStats> collectMajor();
+
+  /**
+   * Full collection is the major one.
+   */
+  std::shared_ptr<GCStats> collectFull() { return collectMajor(); }
+
+  /**
+   * Card marking write barrier.
+   */
+  void onWrite(Word address, Value& value);
+
+  /**
+   * Dirties the card of the `address`, if it's in the old space (or in
+   * the large object space), and the `target` is young. The slow path
+   * of the card marking barrier.
+   */
+  inline void markCard(Word address, Word target) {
+    if (address >= allocator->heap->largeObjectSpaceEnd() ||
+        !nursery->contains(target)) {
+      return;
+    }
+
+    auto card = address / CARD_SIZE;
+
+    if (_cards[card] == 0) {
+      _cards[card] = 1;
+      _dirtyCards.push_back(card);
+    }
+  }
+
+  /**
+   * The first object: in the old space, or in the nursery,
+   * before it's promoted.
+   */
+  std::vector<Word> getRootObjects();
+
+  /**
+   * Whether the card of the address is dirty.
+   */
+  bool isCardDirty(Word address);
+
+ private:
+  /**
+   * Card table, one byte per card (1 is dirty).
+   */
+  std::vector<uint8_t> _cards;
+
+  /**
+   * Indices of the dirty cards.
+   */
+  std::vector<uint32_t> _dirtyCards;
+
+  /**
+   * Marks the young objects reachable from the roots, and the dirty
+   * cards. Returns the survivors.
+   */
+  std::vector<Word> _markYoung();
+
+  /**
+   * Copies the survivors to the old space, and updates the pointers.
+   * Returns false (nothing is changed), if they don't fit.
+   */
+  bool _promote(std::vector<Word>& survivors);
+
+  /**
+   * Calls the `callback` for each slot with a young pointer
+   * in the dirty cards.
+   */
+  void _forEachCardSlot(const std::function<void(Value*)>& callback);
+
+  /**
+   * Calls the `callback` for each slot with a young pointer
+   * in [start, end).
+   */
+  void _forEachYoungSlot(Word start, Word end,
+                         const std::function<void(Value*)>& callback);
+
+  /**
+   * Sweeps the old space. Returns the number of reclaimed objects.
+   */
+  uint32_t _sweepOld();
+
+  /**
+   * Clears the card table, once there are no young objects.
+   */
+  void _clearCards();
+};
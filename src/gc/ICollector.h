@@ -6,13 +6,25 @@
 #pragma once
 
 #include <stdint.h>
+#include <algorithm>
+#include <atomic>
+#include <chrono>
 #include <memory>
+#include <thread>
+#include <type_traits>
 #include <vector>
 
 #include "../allocators/IAllocator.h"
 
 #include "../MemoryManager/Heap.h"
+#include "../MemoryManager/LargeObjectSpace.h"
+#include "../MemoryManager/Nursery.h"
 #include "../MemoryManager/ObjectHeader.h"
+#include "../MemoryManager/RootSet.h"
+#include "../MemoryManager/TypeTable.h"
+
+#include "MarkBitmap.h"
+#include "WorkStealingDeque.h"
 
 /**
  * Stats for the collection cycle.
@@ -54,6 +66,64 @@ class ICollector {
    */
   std::shared_ptr<GCStats> stats;
 
+  /**
+   * Large object space (optional), its objects are marked
+   * in place, and are never moved.
+   */
+  std::shared_ptr<LargeObjectSpace> largeObjects;
+
+  /**
+   * Nursery (generational collectors), the new objects
+   * are allocated in it.
+   */
+  std::shared_ptr<Nursery> nursery;
+
+  /**
+   * Side mark bitmap (optional), otherwise the mark bits
+   * are stored in the object headers.
+   */
+  std::shared_ptr<MarkBitmap> markBitmap;
+
+  /**
+   * Registered roots (the handles, and the root ranges),
+   * shared with the memory manager.
+   */
+  std::shared_ptr<RootSet> rootSet;
+
+  /**
+   * Type table (optional), the typed objects are traced
+   * by their pointer bitmaps.
+   */
+  std::shared_ptr<TypeTable> types;
+
+  /**
+   * Number of the marking threads.
+   */
+  uint32_t markThreads = 1;
+
+  /**
+   * Whether a part of the heap is not swept yet (lazy sweeping).
+   */
+  bool sweepPending = false;
+
+  /**
+   * Whether the marking runs concurrently with the mutator: the writes
+   * and the allocations are reported to the collector.
+   */
+  bool markPending = false;
+
+  /**
+   * Whether all the writes are reported to the collector
+   * (e.g. the card marking of a generational collector).
+   */
+  bool writeBarrierEnabled = false;
+
+  /**
+   * Whether all the allocations are reported to the collector
+   * (e.g. the reference counting tracks the new objects).
+   */
+  bool allocationHookEnabled = false;
+
   ICollector(std::shared_ptr<IAllocator> allocator)
       : allocator(allocator), stats(std::make_shared<GCStats>()) {}
 
@@ -65,12 +135,64 @@ class ICollector {
   virtual std::shared_ptr<GCStats> collect() = 0;
 
   /**
-   * Returns GC roots.
+   * Executes a full collection of the whole heap. Only the generational
+   * collectors distinguish it from the (minor) `collect`.
+   */
+  virtual std::shared_ptr<GCStats> collectFull() { return collect(); }
+
+  /**
+   * Sweeps the next region of the heap, if the sweeping is lazy
+   * (a pending concurrent mark is finished first). Returns false
+   * if there is nothing to sweep.
+   */
+  virtual bool sweepNext() { return false; }
+
+  /**
+   * Called for the objects allocated while the sweep
+   * or the mark is pending, or if the `allocationHookEnabled` is set.
+   */
+  virtual void onAllocate(Word address) {}
+
+  /**
+   * Write barrier, called before the `address` is overwritten
+   * with the `value` while the mark is pending, or if the
+   * `writeBarrierEnabled` is set.
+   */
+  virtual void onWrite(Word address, Value& value) {}
+
+  /**
+   * Advances the collection cycle by a bounded amount of work
+   * (the `budget`), starting a new cycle if needed. Returns true
+   * if the cycle is not finished yet.
+   *
+   * Non-incremental collectors run the whole cycle at once.
+   */
+  virtual bool collectStep(uint32_t budget) {
+    collect();
+    return false;
+  }
+
+  /**
+   * Returns GC roots: the root objects, and the objects
+   * referenced from the registered root slots.
    */
   std::vector<Word> getRoots() {
+    auto roots = getRootObjects();
+    _forEachRootSlot([&](Value* slot) { roots.push_back(slot->decode()); });
+    return roots;
+  }
+
+  /**
+   * Returns the root objects: the first block, if it's allocated.
+   */
+  virtual std::vector<Word> getRootObjects() {
     std::vector<Word> roots;
-    // TODO: impelement actual roots, use first block for now.
-    roots.push_back(0 + sizeof(ObjectHeader));
+    auto root = 0 + sizeof(ObjectHeader);
+
+    // A free block is not a root (its payload may store allocator links).
+    if (allocator->getHeader(root)->used) {
+      roots.push_back(root);
+    }
     return roots;
   }
 
@@ -81,7 +203,35 @@ class ICollector {
     _resetStats();
   }
 
+  /**
+   * Binds the mark loop to the concrete `Allocator` of the collector
+   * (the BasicMemoryManager does it): the loop calls the allocator
+   * directly, without the virtual dispatch per object. By default
+   * the allocator is called through the `IAllocator`.
+   */
+  template <class Allocator>
+  void bindAllocator() {
+    _markFromRootsFn = &ICollector::_markFromRootsWith<Allocator>;
+  }
+
  protected:
+  /**
+   * The mark loop, instantiated for the allocator (see `bindAllocator`).
+   */
+  void (ICollector::*_markFromRootsFn)() =
+      &ICollector::_markFromRootsWith<IAllocator>;
+
+  /**
+   * Calls the `callback` for each registered root slot with a pointer.
+   * The moving collectors update the slots to the new addresses.
+   */
+  template <typename Callback>
+  void _forEachRootSlot(Callback callback) {
+    if (rootSet != nullptr) {
+      rootSet->forEachSlot(callback);
+    }
+  }
+
   /**
    * Resets the GC stats.
    */
@@ -89,5 +239,301 @@ class ICollector {
     stats->total = allocator->getObjectCount();
     stats->alive = 0;
     stats->reclaimed = 0;
+
+    if (largeObjects != nullptr) {
+      stats->total += largeObjects->getObjectCount();
+    }
+  }
+
+  /**
+   * Marks all objects reachable from the roots,
+   * counting them in the `stats->alive`.
+   */
+  void _markFromRoots() { (this->*_markFromRootsFn)(); }
+
+  /**
+   * The mark loop for the `Allocator`.
+   */
+  template <class Allocator>
+  void _markFromRootsWith() {
+    if (markThreads > 1) {
+      _markParallel<Allocator>();
+      return;
+    }
+
+    auto worklist = getRoots();
+
+    while (!worklist.empty()) {
+      auto v = worklist.back();
+      worklist.pop_back();
+
+      // Mark the object if it's not marked yet, and move to the child
+      // pointers.
+      if (_setMarked<Allocator>(v)) {
+        stats->alive++;
+        _forEachPointer<Allocator>(
+            v, [&](Value* p) { worklist.push_back(p->decode()); });
+      }
+    }
+  }
+
+  /**
+   * Parallel marking: each thread traces from its own work-stealing
+   * deque, and steals from the other deques when it runs out of work.
+   * The mark bits are set atomically, so each object is traced once.
+   *
+   * The marking is finished, when all threads are idle: a thread goes
+   * idle only with the empty deque, and only the owner pushes to it,
+   * so no work can appear after that. The idle threads poll the deques
+   * without locks, and back off, so they don't slow down the marking
+   * threads.
+   */
+  template <class Allocator = IAllocator>
+  void _markParallel() {
+    auto threadCount = markThreads;
+    std::vector<WorkStealingDeque<Word>> deques(threadCount);
+
+    auto roots = getRoots();
+    for (uint32_t i = 0; i < roots.size(); i++) {
+      deques[i % threadCount].push(roots[i]);
+    }
+
+    std::atomic<uint32_t> idle(0);
+    std::atomic<uint32_t> alive(0);
+
+    auto hasWork = [&]() {
+      for (auto& deque : deques) {
+        if (!deque.empty()) {
+          return true;
+        }
+      }
+      return false;
+    };
+
+    // Yields first, then sleeps for a growing time (up to 256 us).
+    auto backoff = [](uint32_t attempt) {
+      if (attempt < 8) {
+        std::this_thread::yield();
+        return;
+      }
+      std::this_thread::sleep_for(
+          std::chrono::microseconds(1 << std::min(attempt - 8, 8u)));
+    };
+
+    auto worker = [&](uint32_t id) {
+      auto& own = deques[id];
+      uint32_t marked = 0;
+      Word v;
+
+      while (true) {
+        auto found = own.pop(v);
+
+        for (uint32_t i = 1; !found && i < threadCount; i++) {
+          found = deques[(id + i) % threadCount].steal(v);
+        }
+
+        if (found) {
+          if (_setMarkedAtomic<Allocator>(v)) {
+            marked++;
+            _forEachPointer<Allocator>(
+                v, [&](Value* p) { own.push(p->decode()); });
+          }
+          continue;
+        }
+
+        // No work: wait until either all threads are idle,
+        // or some work appears.
+        idle++;
+        for (uint32_t attempt = 0;; attempt++) {
+          if (idle == threadCount) {
+            alive += marked;
+            return;
+          }
+          if (hasWork()) {
+            idle--;
+            break;
+          }
+          backoff(attempt);
+        }
+      }
+    };
+
+    std::vector<std::thread> threads;
+    for (uint32_t id = 1; id < threadCount; id++) {
+      threads.emplace_back(worker, id);
+    }
+    worker(0);
+
+    for (auto& thread : threads) {
+      thread.join();
+    }
+
+    stats->alive += alive;
+  }
+
+  /**
+   * Atomically marks the object. Returns false if it's already marked.
+   */
+  template <class Allocator = IAllocator>
+  bool _setMarkedAtomic(Word address) {
+    if (markBitmap != nullptr && !_isLargeObject(address)) {
+      return markBitmap->markAtomic(address);
+    }
+
+    auto header = _getHeader<Allocator>(address);
+    if (__atomic_load_n(&header->mark, __ATOMIC_RELAXED)) {
+      return false;
+    }
+    return !__atomic_exchange_n(&header->mark, true, __ATOMIC_RELAXED);
+  }
+
+  /**
+   * Whether the object is in the large object space.
+   */
+  bool _isLargeObject(Word address) {
+    return largeObjects != nullptr && largeObjects->contains(address);
+  }
+
+  /**
+   * Returns the object header from the heap, or the large object space.
+   */
+  template <class Allocator = IAllocator>
+  ObjectHeader* _getHeader(Word address) {
+    return _isLargeObject(address) ? largeObjects->getHeader(address)
+                                   : _allocatorHeader<Allocator>(address);
+  }
+
+  /**
+   * Returns the object header from the allocator: the concrete
+   * `Allocator` is called directly (the call is inlined).
+   */
+  template <class Allocator = IAllocator>
+  ObjectHeader* _allocatorHeader(Word address) {
+    if constexpr (std::is_same_v<Allocator, IAllocator>) {
+      return allocator->getHeader(address);
+    } else {
+      return static_cast<Allocator*>(allocator.get())
+          ->Allocator::getHeader(address);
+    }
+  }
+
+  /**
+   * Returns the block to the allocator, calling the concrete
+   * `Allocator` directly.
+   */
+  template <class Allocator = IAllocator>
+  void _allocatorFree(Word address) {
+    if constexpr (std::is_same_v<Allocator, IAllocator>) {
+      allocator->free(address);
+    } else {
+      static_cast<Allocator*>(allocator.get())->Allocator::free(address);
+    }
+  }
+
+  /**
+   * Returns child pointers of the object from the heap,
+   * or the large object space. A typed object is traced by its
+   * pointer bitmap (a leaf object is not scanned).
+   */
+  std::vector<Value*> _getPointers(Word address) {
+    std::vector<Value*> pointers;
+    _forEachPointer(address, [&](Value* p) { pointers.push_back(p); });
+    return pointers;
+  }
+
+  /**
+   * Calls the `visitor` for each child pointer of the object (same
+   * dispatch as `_getPointers`), without allocating the vector. This is
+   * the tracing hot path.
+   */
+  template <class Allocator = IAllocator, typename Visitor>
+  void _forEachPointer(Word address, Visitor visitor) {
+    auto isLarge = _isLargeObject(address);
+
+    if (types != nullptr) {
+      auto type = types->getType(address);
+
+      if (type != TypeTable::CONSERVATIVE) {
+        auto size = isLarge ? largeObjects->sizeOf(address)
+                            : _allocatorHeader<Allocator>(address)->size;
+        types->forEachPointer(address, type, size / sizeof(Word), visitor);
+        return;
+      }
+    }
+
+    if (isLarge) {
+      largeObjects->forEachPointer(address, visitor);
+    } else {
+      allocator->forEachPointer(
+          address, _allocatorHeader<Allocator>(address)->size, visitor);
+    }
+  }
+
+  /**
+   * Copies the type of the moved object to its new location.
+   */
+  void _moveType(Word from, Word to) {
+    if (types != nullptr) {
+      types->moveType(from, to);
+    }
+  }
+
+  /**
+   * Whether the object is marked. The large objects are
+   * always marked in their headers.
+   */
+  template <class Allocator = IAllocator>
+  bool _isMarked(Word address) {
+    if (markBitmap != nullptr && !_isLargeObject(address)) {
+      return markBitmap->isMarked(address);
+    }
+    return _getHeader<Allocator>(address)->mark == 1;
+  }
+
+  /**
+   * Marks the object. Returns false if it's already marked.
+   */
+  template <class Allocator = IAllocator>
+  bool _setMarked(Word address) {
+    if (markBitmap != nullptr && !_isLargeObject(address)) {
+      return markBitmap->mark(address);
+    }
+
+    auto header = _getHeader<Allocator>(address);
+    if (header->mark == 1) {
+      return false;
+    }
+    header->mark = 1;
+    return true;
+  }
+
+  /**
+   * Returns the first marked object in the heap starting from
+   * the `address`, or the heap size if there are no more marked objects.
+   * With the mark bitmap the dead objects are not visited at all.
+   */
+  template <class Allocator = IAllocator>
+  Word _nextMarked(Word address) {
+    if (markBitmap != nullptr) {
+      return markBitmap->nextMarked(address);
+    }
+
+    auto heapSize = allocator->heap->size();
+
+    while (address < heapSize && !_isMarked<Allocator>(address)) {
+      address +=
+          _allocatorHeader<Allocator>(address)->size + sizeof(ObjectHeader);
+    }
+
+    return std::min(address, heapSize);
+  }
+
+  /**
+   * Reclaims the unmarked large objects.
+   */
+  void _sweepLargeObjects() {
+    if (largeObjects != nullptr) {
+      stats->reclaimed += largeObjects->sweep();
+    }
   }
 };
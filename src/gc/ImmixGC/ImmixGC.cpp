@@ -0,0 +1,115 @@
+/**
+ * The MIT License (MIT)
+ * Copyright (c) 2018-present Dmitry Soshnikov <dmitry.soshnikov@gmail.com>
+ */
+
+#include "ImmixGC.h"
+#include "../../MemoryManager/ObjectHeader.h"
+
+#include <cstring>
+#include <stdexcept>
+
+ImmixGC::ImmixGC(const std::shared_ptr<IAllocator>& allocator)
+    : ICollector(allocator),
+      _blocks(dynamic_cast<ImmixAllocator*>(allocator.get())) {
+  if (_blocks == nullptr) {
+    throw std::runtime_error("ImmixGC requires ImmixAllocator.");
+  }
+}
+
+/**
+ * Main collection cycle.
+ */
+std::shared_ptr<GCStats> ImmixGC::collect() {
+  _resetStats();
+
+  _blocks->startCollection();
+
+  // The roots are pinned: marked in place before the trace, so they
+  // are never evacuated (the trace checks the mark first).
+  for (const auto& root : getRoots()) {
+    if (_isLargeObject(root)) {
+      _trace(root);
+    } else if (!_blocks->getHeader(root)->mark) {
+      _mark(root);
+    }
+  }
+
+  while (!_worklist.empty()) {
+    auto v = _worklist.back();
+    _worklist.pop_back();
+
+    _forEachPointer(
+        v, [&](Value* p) { *p = Value::Pointer(_trace(p->decode())); });
+  }
+
+  for (const auto& address : _marked) {
+    _blocks->getHeader(address)->mark = 0;
+  }
+
+  _blocks->finishCollection(_marked.size());
+  _marked.clear();
+
+  _sweepLargeObjects();
+
+  stats->reclaimed = stats->total - stats->alive;
+
+  return stats;
+}
+
+/**
+ * Marks the object once, and returns its address. An object of an
+ * evacuated block (except a root, which is marked before the trace) is
+ * copied first, if it fits the free lines; the copy is marked, and the
+ * forwarding address is installed in the old header. The large objects
+ * are marked in place.
+ */
+Word ImmixGC::_trace(Word address) {
+  if (_isLargeObject(address)) {
+    if (_setMarked(address)) {
+      stats->alive++;
+      _worklist.push_back(address);
+    }
+    return address;
+  }
+
+  auto header = _blocks->getHeader(address);
+
+  if (header->forward != 0) {
+    return header->getForward();
+  }
+
+  if (header->mark) {
+    return address;
+  }
+
+  if (_blocks->isEvacuating(address)) {
+    auto copy = _blocks->allocate(header->size);
+
+    if (!copy.isNullPointer()) {
+      auto heap = allocator->heap;
+      memcpy(heap->asBytePointer(copy), heap->asBytePointer(address),
+             header->size);
+      _moveType(address, copy);
+
+      header->setForward(copy);
+      address = copy;
+      header = _blocks->getHeader(copy);
+    }
+  }
+
+  _mark(address);
+
+  return address;
+}
+
+/**
+ * Marks the object, and its lines in place.
+ */
+void ImmixGC::_mark(Word address) {
+  _blocks->getHeader(address)->mark = 1;
+  _blocks->markLines(address);
+  _marked.push_back(address);
+  _worklist.push_back(address);
+  stats->alive++;
+}
@@ -0,0 +1,70 @@
+/**
+ * The MIT License (MIT)
+ * Copyright (c) 2018-present Dmitry Soshnikov <dmitry.soshnikov@gmail.com>
+ */
+
+#pragma once
+
+#include <memory>
+#include <vector>
+
+#include "../ICollector.h"
+
+#include "../../Value/Value.h"
+#include "../../allocators/IAllocator.h"
+#include "../../allocators/ImmixAllocator/ImmixAllocator.h"
+
+/**
+ * Immix-style mark-region garbage collector.
+ *
+ * Works with the ImmixAllocator. The collection marks the alive objects,
+ * and their lines; the unmarked lines are reclaimed as a whole, so there
+ * is no sweep of the dead objects:
+ *
+ *   - The fragmented blocks (sparsely live after the last collection)
+ *     are selected for the evacuation
+ *   - Trace: an object in an evacuated block is copied to the free lines
+ *     of the other blocks, and leaves the forwarding address; the rest
+ *     (and the objects which don't fit anymore) are marked in place
+ *   - The pointers are updated to the copies during the trace
+ *
+ * So the evacuation is opportunistic, and the pause is a single trace,
+ * unlike the full compaction. The roots (also the objects referenced
+ * from the registered root slots) are never moved. The large objects
+ * are marked, and scanned in place.
+ */
+class ImmixGC : public ICollector {
+ public:
+  ImmixGC(const std::shared_ptr<IAllocator>& allocator);
+
+  /**
+   * Main collection cycle.
+   */
+  std::shared_ptr<GCStats> collect();
+
+ private:
+  /**
+   * The allocator of the blocks.
+   */
+  ImmixAllocator* _blocks;
+
+  /**
+   * Marked heap objects, their mark bits are reset after the trace.
+   */
+  std::vector<Word> _marked;
+
+  /**
+   * Objects to be scanned.
+   */
+  std::vector<Word> _worklist;
+
+  /**
+   * Marks (or evacuates) the object once, and returns its address.
+   */
+  Word _trace(Word address);
+
+  /**
+   * Marks the object in place, and adds it to the worklist.
+   */
+  void _mark(Word address);
+};
@@ -0,0 +1,107 @@
+/**
+ * The MIT License (MIT)
+ * Copyright (c) 2018-present Dmitry Soshnikov <dmitry.soshnikov@gmail.com>
+ */
+
+#pragma once
+
+#include <stdint.h>
+#include <algorithm>
+#include <memory>
+#include <vector>
+
+#include "../MemoryManager/Heap.h"
+
+/**
+ * Side mark bitmap.
+ *
+ * One mark bit per heap word, kept outside of the heap storage: the
+ * bit of an object is the bit of its payload address. Marking doesn't
+ * write to the object memory, the marked objects are found by scanning
+ * the bitmap a 64-bit word at a time, and all marks are cleared at once.
+ *
+ *   Heap:    | H | Obj | H | Obj      | H | Obj |
+ *   Bitmap:      1         0              1
+ *
+ * The bitmap covers the heap up to its `limit()`, so the elastic heap
+ * may grow without reallocating it.
+ */
+class MarkBitmap {
+ public:
+  MarkBitmap(std::shared_ptr<Heap> heap)
+      : _heap(heap), _bits((heap->limit() / sizeof(Word) + 63) / 64, 0) {}
+
+  /**
+   * Whether the object is marked.
+   */
+  bool isMarked(Word address) {
+    auto bit = address / sizeof(Word);
+    return (_bits[bit / 64] >> (bit % 64)) & 1;
+  }
+
+  /**
+   * Marks the object. Returns false if it's already marked.
+   */
+  bool mark(Word address) {
+    auto bit = address / sizeof(Word);
+    auto mask = 1ull << (bit % 64);
+
+    if (_bits[bit / 64] & mask) {
+      return false;
+    }
+    _bits[bit / 64] |= mask;
+    return true;
+  }
+
+  /**
+   * Atomically marks the object (used by the parallel marking).
+   * Returns false if it's already marked.
+   */
+  bool markAtomic(Word address) {
+    auto bit = address / sizeof(Word);
+    uint64_t mask = 1ull << (bit % 64);
+    auto old = __atomic_fetch_or(&_bits[bit / 64], mask, __ATOMIC_RELAXED);
+    return (old & mask) == 0;
+  }
+
+  /**
+   * Returns the address of the first marked object starting from
+   * the `address`, or the heap size if there are no more marked objects.
+   * The unmarked runs are skipped 64 words at a time.
+   */
+  Word nextMarked(Word address) {
+    auto bit = address / sizeof(Word);
+    auto index = bit / 64;
+
+    if (index >= _bits.size()) {
+      return _heap->size();
+    }
+
+    auto bits = _bits[index] & (~0ull << (bit % 64));
+
+    while (bits == 0) {
+      if (++index == _bits.size()) {
+        return _heap->size();
+      }
+      bits = _bits[index];
+    }
+
+    return (index * 64 + __builtin_ctzll(bits)) * sizeof(Word);
+  }
+
+  /**
+   * Clears all mark bits.
+   */
+  void clear() { std::fill(_bits.begin(), _bits.end(), 0); }
+
+ private:
+  /**
+   * The covered heap.
+   */
+  std::shared_ptr<Heap> _heap;
+
+  /**
+   * The bits, one per heap word.
+   */
+  std::vector<uint64_t> _bits;
+};
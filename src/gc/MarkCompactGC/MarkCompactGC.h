@@ -5,8 +5,10 @@
 
 #pragma once
 
+#include <cstring>
 #include <list>
 #include <memory>
+#include <vector>
 
 #include "../ICollector.h"
 
@@ -17,7 +19,14 @@
  * Mark-Compact garbage collector.
  *
  *   - Mark phase: trace, marks reachable objects as alive
- *   - Compact phase: relocates objects in place using Lisp2 algorithm.
+ *   - Compact phase: relocates objects in place using Lisp2 algorithm:
+ *
+ *       1. Compute locations: forwarding addresses of the alive objects
+ *       2. Update references: child pointers are set to forwarding addresses
+ *       3. Relocate: the objects slide to their new locations
+ *
+ * After the compaction the free space is one contiguous region after the
+ * last alive object, so the allocator can bump-allocate from it.
  *
  * Collects stats during collection.
  *
@@ -40,23 +49,180 @@ class MarkCompactGC : public ICollector {
   /**
    * Compact phase. Resets the mark bit, relocates objects to
    * one side of the heap, doing a defragmentation, using Lisp2 algorithm.
+   * The allocator is reset to the compaction frontier afterwards.
    */
   void compact();
 
+  /**
+   * Binds the mark, and the compaction loops to the concrete `Allocator`.
+   */
+  template <class Allocator>
+  void bindAllocator() {
+    ICollector::bindAllocator<Allocator>();
+    _compactObjectsFn = &MarkCompactGC::_compactObjects<Allocator>;
+  }
+
  private:
+  /**
+   * Compaction frontier: the address after the last relocated
+   * object, from which the free space begins.
+   */
+  Word _frontier;
+
+  /**
+   * Moves the heap objects (the Lisp2 phases) for the `Allocator`.
+   */
+  template <class Allocator>
+  void _compactObjects() {
+    _computeLocations<Allocator>();
+    _updateReferences<Allocator>();
+    _relocate<Allocator>();
+  }
+
+  /**
+   * The compaction loops, instantiated for the allocator
+   * (see `bindAllocator`).
+   */
+  void (MarkCompactGC::*_compactObjectsFn)() =
+      &MarkCompactGC::_compactObjects<IAllocator>;
+
   /**
    * Computes new locations for the objects.
    */
+  template <class Allocator>
   void _computeLocations();
 
   /**
    * Updates child references of the object according
    * to the new locations.
    */
+  template <class Allocator>
   void _updateReferences();
 
+  /**
+   * Sets the pointer to the new location.
+   */
+  template <class Allocator>
+  void _updatePointer(Value* p);
+
   /**
    * Relocates the objects to the new locations.
    */
+  template <class Allocator>
   void _relocate();
-};
\ No newline at end of file
+};
+
+/**
+ * Computes new locations for the objects: each alive object
+ * is forwarded to the next free address from the beginning of the heap.
+ *
+ * All compaction phases visit only the alive objects, which with
+ * the mark bitmap allows skipping the dead runs without reading them.
+ */
+template <class Allocator>
+void MarkCompactGC::_computeLocations() {
+  auto free = 0 + sizeof(ObjectHeader);
+  uint32_t alive = 0;
+
+  auto heapSize = allocator->heap->size();
+
+  for (auto scan = _nextMarked<Allocator>(free); scan < heapSize;) {
+    auto header = _allocatorHeader<Allocator>(scan);
+
+    // Alive object, the mark bit is kept for the next phases.
+    header->setForward(free);
+    free += header->size + sizeof(ObjectHeader);
+    alive++;
+
+    // Move to the next alive object.
+    scan = _nextMarked<Allocator>(scan + header->size + sizeof(ObjectHeader));
+  }
+
+  stats->reclaimed += allocator->getObjectCount() - alive;
+
+  // The free space begins from the header of the next relocated object.
+  _frontier = free - sizeof(ObjectHeader);
+}
+
+/**
+ * Updates child references of the object according
+ * to the new locations.
+ *
+ * The root object (the first block) is never moved, since it's
+ * the first alive object in the heap, so it's always forwarded
+ * to its own address. The registered root slots are updated.
+ */
+template <class Allocator>
+void MarkCompactGC::_updateReferences() {
+  auto scan = _nextMarked<Allocator>(0 + sizeof(ObjectHeader));
+
+  while (scan < allocator->heap->size()) {
+    _forEachPointer<Allocator>(
+        scan, [&](Value* p) { _updatePointer<Allocator>(p); });
+
+    // Move to the next alive object.
+    scan = _nextMarked<Allocator>(
+        scan + _allocatorHeader<Allocator>(scan)->size + sizeof(ObjectHeader));
+  }
+
+  _forEachRootSlot([&](Value* slot) { _updatePointer<Allocator>(slot); });
+
+  // Alive large objects may point to the moved objects.
+  if (largeObjects != nullptr) {
+    largeObjects->forEachObject([&](Word address) {
+      if (largeObjects->getHeader(address)->mark == 1) {
+        _forEachPointer<Allocator>(
+            address, [&](Value* p) { _updatePointer<Allocator>(p); });
+      }
+    });
+  }
+}
+
+/**
+ * Sets the pointer to the new location of the object,
+ * the pointers to the large objects stay the same.
+ */
+template <class Allocator>
+void MarkCompactGC::_updatePointer(Value* p) {
+  if (!_isLargeObject(p->decode())) {
+    auto forward = _allocatorHeader<Allocator>(p->decode())->getForward();
+    *p = Value::Pointer(forward);
+  }
+}
+
+/**
+ * Relocates the objects to the new locations, sliding them (with
+ * the headers) to the beginning of the heap. Resets the mark bit
+ * for future collection cycles.
+ */
+template <class Allocator>
+void MarkCompactGC::_relocate() {
+  auto heap = allocator->heap;
+  auto scan = _nextMarked<Allocator>(0 + sizeof(ObjectHeader));
+
+  while (scan < heap->size()) {
+    auto header = _allocatorHeader<Allocator>(scan);
+    auto size = header->size;
+    auto forward = header->getForward();
+
+    // The destination is always below, so the move can only
+    // overwrite the blocks which are already relocated.
+    memmove(heap->asBytePointer(forward - sizeof(ObjectHeader)),
+            heap->asBytePointer(scan - sizeof(ObjectHeader)),
+            size + sizeof(ObjectHeader));
+    _moveType(scan, forward);
+
+    // All blocks before a relocated object are allocated.
+    auto relocated = _allocatorHeader<Allocator>(forward);
+    relocated->mark = 0;
+    relocated->setForward(0);
+    relocated->prevFree = 0;
+
+    // Move to the next alive object.
+    scan = _nextMarked<Allocator>(scan + size + sizeof(ObjectHeader));
+  }
+
+  if (markBitmap != nullptr) {
+    markBitmap->clear();
+  }
+}
@@ -6,60 +6,319 @@
 #include "MarkSweepGC.h"
 #include "../../MemoryManager/ObjectHeader.h"
 
+#include <algorithm>
+#include <cstring>
 #include <iostream>
 
 /**
  * Main collection cycle.
+ *
+ * In the concurrent mark mode only starts the marking, the previous
+ * cycle is finished first.
  */
 std::shared_ptr<GCStats> MarkSweepGC::collect() {
+  finishMark();
+
+  // The leftover region of the previous cycle.
+  while (sweepNext()) {
+  }
+
   _resetStats();
+
+  if (concurrentMark) {
+    markPending = true;
+    _marker = std::thread(&MarkSweepGC::_markConcurrently, this, getRoots());
+    return stats;
+  }
+
   mark();
-  sweep();
+  _sweepOrDefer();
+
   return stats;
 }
 
 /**
- * Mark phase. Returns number of live objects.
+ * Remark pause: waits for the background marking, and marks the
+ * rest of the objects from the SATB buffers (the mutator is stopped).
+ *
+ * The pending incremental mark is run to the end. The root slots have
+ * no write barrier, so they are shaded again: the mutator may have
+ * moved a pointer from the heap to a handle since the cycle started.
  */
-void MarkSweepGC::mark() {
-  auto worklist = getRoots();
+std::shared_ptr<GCStats> MarkSweepGC::finishMark() {
+  if (!markPending) {
+    return stats;
+  }
+
+  if (_incrementalMark) {
+    _markGrey(UINT32_MAX);
+
+    for (const auto& root : getRoots()) {
+      _shade(root);
+    }
+    _markGrey(UINT32_MAX);
+
+    _incrementalMark = false;
+    markPending = false;
+    _sweepOrDefer();
+    return stats;
+  }
+
+  _marker.join();
+  stats->alive += _markedConcurrently;
+
+  std::vector<Word> worklist;
+  _satb.drain(worklist);
 
   while (!worklist.empty()) {
     auto v = worklist.back();
     worklist.pop_back();
-    auto header = allocator->getHeader(v);
 
-    // Mark the object if it's not marked yet, and move to the child pointers.
-    if (header->mark == 0) {
-      header->mark = 1;
+    if (_setMarked(v)) {
       stats->alive++;
-      for (const auto& p : allocator->getPointers(v)) {
-        worklist.push_back(p->decode());
-      }
+      _forEachPointer(v, [&](Value* p) { worklist.push_back(p->decode()); });
     }
   }
+
+  markPending = false;
+  _sweepOrDefer();
+
+  return stats;
+}
+
+MarkSweepGC::~MarkSweepGC() {
+  if (_marker.joinable()) {
+    _marker.join();
+  }
+}
+
+/**
+ * Sweeps the heap after the mark, or defers the sweep
+ * in the lazy mode.
+ */
+void MarkSweepGC::_sweepOrDefer() {
+  if (!lazySweep) {
+    sweep();
+    return;
+  }
+
+  // All unmarked objects are reclaimed by the lazy sweep
+  // eventually, so the stats are known after the marking.
+  _sweepLargeObjects();
+
+  auto largeAlive =
+      largeObjects != nullptr ? largeObjects->getObjectCount() : 0;
+  stats->reclaimed +=
+      allocator->getObjectCount() - (stats->alive - largeAlive);
+
+  _sweepCursor = 0 + sizeof(ObjectHeader);
+  sweepPending = true;
+}
+
+/**
+ * Background marking thread. The mark bits are set atomically, since
+ * the mutator marks the new objects. The stats are updated after
+ * the thread is joined.
+ */
+void MarkSweepGC::_markConcurrently(std::vector<Word> worklist) {
+  uint32_t marked = 0;
+
+  do {
+    while (!worklist.empty()) {
+      auto v = worklist.back();
+      worklist.pop_back();
+
+      if (_setMarkedAtomic(v)) {
+        marked++;
+        _forEachPointer(v,
+                        [&](Value* p) { worklist.push_back(p->decode()); });
+      }
+    }
+  } while (_satb.popCompleted(worklist));
+
+  _markedConcurrently = marked;
+}
+
+/**
+ * Mark phase. Returns number of live objects.
+ */
+void MarkSweepGC::mark() {
+  _markFromRoots();
 }
 
 /**
  * Sweep phase. Resets the mark bit, reclaims the objects by
- * adding back to the free list.
+ * adding back to the free list. The large objects are swept
+ * in their own space.
+ *
+ * The parallel sweep also coalesces the adjacent free blocks, and
+ * rebuilds the free list in the address order.
  */
 void MarkSweepGC::sweep() {
-  auto scan = 0 + sizeof(ObjectHeader);
-
-  while (scan < allocator->heap->size()) {
-    auto header = allocator->getHeader(scan);
-
-    // Alive object, reset the mark bit for future collection cycles.
-    if (header->mark == 1) {
-      header->mark = 0;
-    } else {
-      // Garbage, reclaim.
-      allocator->free(scan);
-      stats->reclaimed++;
+  uint32_t reclaimed = 0;
+
+  auto isAlive = [&](Word address) {
+    if (!_isMarked(address)) {
+      return false;
+    }
+    if (!markBitmap) {
+      _getHeader(address)->mark = 0;
     }
+    return true;
+  };
 
-    // Move to the next block.
-    scan += header->size + sizeof(ObjectHeader);
+  if (sweepThreads > 1 &&
+      allocator->sweepParallel(sweepThreads, isAlive, reclaimed)) {
+    stats->reclaimed += reclaimed;
+  } else {
+    Word scan = sizeof(ObjectHeader);
+    stats->reclaimed += _sweepBlocks(scan, allocator->heap->size());
+  }
+
+  _sweepLargeObjects();
+  _finishSweep();
+}
+
+/**
+ * Lazy sweep step: sweeps the next heap region.
+ * Returns false if the whole heap is already swept.
+ */
+bool MarkSweepGC::sweepNext() {
+  if (markPending) {
+    finishMark();
+    return true;
+  }
+
+  if (!sweepPending) {
+    return false;
+  }
+
+  auto heapSize = allocator->heap->size();
+  _sweepBlocks(_sweepCursor,
+               std::min(_sweepCursor + SWEEP_REGION_SIZE, heapSize));
+
+  if (_sweepCursor >= heapSize) {
+    sweepPending = false;
+    _finishSweep();
+  }
+
+  return true;
+}
+
+/**
+ * Objects allocated in the not yet swept region are marked ("allocated
+ * black"), so the lazy sweep doesn't reclaim them. The objects allocated
+ * during the concurrent mark are alive in this cycle.
+ *
+ * During the mark the payload of the new object is cleared: the SATB
+ * barrier records the overwritten words, and the payload of a block
+ * just taken from the free list still holds the allocator links.
+ */
+void MarkSweepGC::onAllocate(Word address) {
+  if (markPending) {
+    auto size = _isLargeObject(address) ? largeObjects->sizeOf(address)
+                                        : allocator->getHeader(address)->size;
+    memset(allocator->heap->asBytePointer(address), 0, size);
+
+    stats->total++;
+    if (_setMarkedAtomic(address)) {
+      stats->alive++;
+    }
+    return;
+  }
+
+  if (sweepPending && address >= _sweepCursor) {
+    _setMarked(address);
+  }
+}
+
+/**
+ * SATB write barrier: the overwritten pointer is recorded, so the
+ * object it points to is marked, even if the marker hasn't reached
+ * it yet, and this was the last reference.
+ *
+ * In the incremental mode this is the Dijkstra barrier: the stored
+ * pointer is shaded instead, since the object it's stored to may be
+ * already scanned (black).
+ */
+void MarkSweepGC::onWrite(Word address, Value& value) {
+  if (_incrementalMark) {
+    if (value.isPointer() && !value.isNullPointer()) {
+      _shade(value.decode());
+    }
+    return;
+  }
+
+  auto old = (Value*)allocator->heap->asWordPointer(address);
+
+  if (old->isPointer() && !old->isNullPointer()) {
+    _satb.push(old->decode());
+  }
+}
+
+/**
+ * Incremental collection step. The first step starts the cycle
+ * (finishing the previous one), marking the roots grey. The step,
+ * which scans the last grey object, sweeps the heap (or defers
+ * the sweep in the lazy mode).
+ */
+bool MarkSweepGC::collectStep(uint32_t budget) {
+  if (!markPending) {
+    while (sweepNext()) {
+    }
+
+    _resetStats();
+    _incrementalMark = true;
+    markPending = true;
+
+    for (const auto& root : getRoots()) {
+      _shade(root);
+    }
+  } else if (!_incrementalMark) {
+    // A concurrent cycle is in progress.
+    finishMark();
+    return false;
+  }
+
+  if (_markGrey(budget)) {
+    return true;
+  }
+
+  finishMark();
+  return false;
+}
+
+/**
+ * Marks the object grey, if it's white: it's marked,
+ * and put to the worklist to be scanned.
+ */
+void MarkSweepGC::_shade(Word address) {
+  if (_setMarkedAtomic(address)) {
+    stats->alive++;
+    _grey.push_back(address);
+  }
+}
+
+/**
+ * Scans up to `budget` grey objects (they become black),
+ * shading their children.
+ */
+bool MarkSweepGC::_markGrey(uint32_t budget) {
+  while (budget-- > 0 && !_grey.empty()) {
+    auto v = _grey.back();
+    _grey.pop_back();
+
+    _forEachPointer(v, [&](Value* p) { _shade(p->decode()); });
+  }
+
+  return !_grey.empty();
+}
+
+/**
+ * Finishes the sweep, clearing the mark bitmap.
+ */
+void MarkSweepGC::_finishSweep() {
+  if (markBitmap != nullptr) {
+    markBitmap->clear();
   }
 }
@@ -7,8 +7,11 @@
 
 #include <list>
 #include <memory>
+#include <thread>
+#include <vector>
 
 #include "../ICollector.h"
+#include "../SATBQueue.h"
 
 #include "../../Value/Value.h"
 #include "../../allocators/IAllocator.h"
@@ -21,11 +24,59 @@
  *
  * Collects stats during collection.
  *
+ * In the lazy sweep mode `collect` only marks, and the heap is swept
+ * region by region on demand, when the allocator runs out of memory.
+ * The leftover region is swept before the next mark phase.
+ *
+ * With `sweepThreads` > 1 the heap chunks are swept in parallel, if
+ * the allocator supports it (otherwise the sweep is sequential).
+ *
+ * In the concurrent mark mode `collect` starts the marking in
+ * a background thread, and returns to the mutator. The overwritten
+ * pointers are recorded by the snapshot-at-the-beginning (SATB) write
+ * barrier, and the new objects are allocated marked, so all objects
+ * reachable at the start of the cycle survive it. The `finishMark`
+ * (called by the next `collect`, or on OOM) is a short remark pause,
+ * which drains the SATB buffers, and runs the sweep.
+ *
+ * The incremental mode (`collectStep`) marks by a bounded number of
+ * objects per step. The grey objects (marked, but not scanned yet)
+ * persist in the worklist between the steps, and the incremental update
+ * (Dijkstra) write barrier shades the pointers stored by the mutator,
+ * so a black object never points to a white one.
+ *
  */
 class MarkSweepGC : public ICollector {
  public:
   MarkSweepGC(const std::shared_ptr<IAllocator>& allocator)
-      : ICollector(allocator){};
+      : ICollector(allocator), lazySweep(false),
+        sweepThreads(1),
+        concurrentMark(false),
+        _sweepCursor(0),
+        _markedConcurrently(0),
+        _incrementalMark(false){};
+
+  ~MarkSweepGC();
+
+  /**
+   * Size of the heap region swept by one lazy sweep step.
+   */
+  static constexpr uint32_t SWEEP_REGION_SIZE = 256;
+
+  /**
+   * Whether the sweep phase is deferred to the allocation.
+   */
+  bool lazySweep;
+
+  /**
+   * Number of the sweeping threads.
+   */
+  uint32_t sweepThreads;
+
+  /**
+   * Whether the marking runs concurrently with the mutator.
+   */
+  bool concurrentMark;
 
   /**
    * Main collection cycle.
@@ -42,4 +93,153 @@ class MarkSweepGC : public ICollector {
    * adding back to the free list.
    */
   void sweep();
-};
\ No newline at end of file
+
+  /**
+   * Lazy sweep step: sweeps the next heap region.
+   */
+  bool sweepNext();
+
+  /**
+   * Objects allocated in the not yet swept region, or during
+   * the concurrent mark are marked.
+   */
+  void onAllocate(Word address);
+
+  /**
+   * SATB write barrier: records the overwritten pointer.
+   */
+  void onWrite(Word address, Value& value);
+
+  /**
+   * Incremental collection step: scans up to `budget` grey objects.
+   */
+  bool collectStep(uint32_t budget);
+
+  /**
+   * Finishes the concurrent mark (the remark pause),
+   * and sweeps the heap.
+   */
+  std::shared_ptr<GCStats> finishMark();
+
+  /**
+   * Binds the mark, and the sweep loops to the concrete `Allocator`.
+   */
+  template <class Allocator>
+  void bindAllocator() {
+    ICollector::bindAllocator<Allocator>();
+    _sweepBlocksFn = &MarkSweepGC::_sweepBlocksWith<Allocator>;
+  }
+
+ private:
+  /**
+   * Next block to be swept by the lazy sweep.
+   */
+  Word _sweepCursor;
+
+  /**
+   * Background marking thread.
+   */
+  std::thread _marker;
+
+  /**
+   * Objects marked by the background thread.
+   */
+  uint32_t _markedConcurrently;
+
+  /**
+   * Pointers overwritten during the concurrent mark.
+   */
+  SATBQueue _satb;
+
+  /**
+   * Whether the pending mark is incremental (otherwise concurrent).
+   */
+  bool _incrementalMark;
+
+  /**
+   * Grey objects of the incremental mark.
+   */
+  std::vector<Word> _grey;
+
+  /**
+   * Marks the object grey, if it's white.
+   */
+  void _shade(Word address);
+
+  /**
+   * Scans up to `budget` grey objects. Returns false
+   * if there are no more grey objects.
+   */
+  bool _markGrey(uint32_t budget);
+
+  /**
+   * Background marking: traces from the roots, and from the
+   * completed SATB buffers, until there is no more work.
+   */
+  void _markConcurrently(std::vector<Word> worklist);
+
+  /**
+   * Sweeps the heap after the mark, or defers the sweep
+   * in the lazy mode.
+   */
+  void _sweepOrDefer();
+
+  /**
+   * Sweeps the blocks starting from `scan` (which is advanced)
+   * up to the `end`. Returns the number of reclaimed objects.
+   */
+  uint32_t _sweepBlocks(Word& scan, Word end) {
+    return (this->*_sweepBlocksFn)(scan, end);
+  }
+
+  /**
+   * The sweep loop for the `Allocator`.
+   */
+  template <class Allocator>
+  uint32_t _sweepBlocksWith(Word& scan, Word end);
+
+  /**
+   * The sweep loop, instantiated for the allocator (see `bindAllocator`).
+   */
+  uint32_t (MarkSweepGC::*_sweepBlocksFn)(Word&, Word) =
+      &MarkSweepGC::_sweepBlocksWith<IAllocator>;
+
+  /**
+   * Finishes the sweep, clearing the mark bitmap.
+   */
+  void _finishSweep();
+};
+
+/**
+ * Sweeps the blocks starting from `scan` (which is advanced) up to
+ * the `end`. Resets the mark bit of the alive objects, and returns
+ * the number of reclaimed objects.
+ *
+ * With the mark bitmap the alive objects are not written to,
+ * and the marks are cleared at once after the sweep.
+ */
+template <class Allocator>
+uint32_t MarkSweepGC::_sweepBlocksWith(Word& scan, Word end) {
+  uint32_t reclaimed = 0;
+
+  while (scan < end) {
+    auto header = _allocatorHeader<Allocator>(scan);
+
+    // Alive object, reset the mark bit for future collection cycles
+    // (the mark bitmap is cleared after the sweep).
+    if (_isMarked<Allocator>(scan)) {
+      if (markBitmap == nullptr) {
+        header->mark = 0;
+      }
+    } else if (header->used) {
+      // Garbage, reclaim (already free blocks are skipped).
+      _allocatorFree<Allocator>(scan);
+      reclaimed++;
+    }
+
+    // Move to the next block.
+    scan += header->size + sizeof(ObjectHeader);
+  }
+
+  return reclaimed;
+}
@@ -0,0 +1,438 @@
+/**
+ * The MIT License (MIT)
+ * Copyright (c) 2018-present Dmitry Soshnikov <dmitry.soshnikov@gmail.com>
+ */
+
+#include "RCCollector.h"
+#include "../../MemoryManager/ObjectHeader.h"
+
+#include <cstring>
+
+RCCollector::RCCollector(const std::shared_ptr<IAllocator>& allocator)
+    : ICollector(allocator) {
+  writeBarrierEnabled = true;
+  allocationHookEnabled = true;
+}
+
+/**
+ * Runs an epoch, and the cycle collection. The sticky counters
+ * fall back to the backup tracing.
+ */
+std::shared_ptr<GCStats> RCCollector::collect() {
+  _resetStats();
+
+  epoch();
+  collectCycles();
+
+  if (_overflowed) {
+    _trace();
+  }
+
+  stats->alive = stats->total - stats->reclaimed;
+
+  return stats;
+}
+
+/**
+ * Processes the buffered increments and decrements,
+ * and frees the zero count objects.
+ */
+void RCCollector::epoch() {
+  for (const auto& address : _increments) {
+    _increment(address);
+  }
+  _increments.clear();
+
+  for (const auto& address : _decrements) {
+    if (_decrement(address)) {
+      _zeroCount.insert(address);
+    } else if (_isCandidate(address)) {
+      _candidates.insert(address);
+    }
+  }
+  _decrements.clear();
+  _newObjects = 0;
+
+  _scanRoots();
+
+  std::vector<Word> zeroCount(_zeroCount.begin(), _zeroCount.end());
+
+  for (const auto& address : zeroCount) {
+    // Already freed as a child of another object.
+    if (_zeroCount.count(address) == 0) {
+      continue;
+    }
+
+    if (_getHeader(address)->rc > 0) {
+      _zeroCount.erase(address);
+    } else if (_referents.count(address) == 0) {
+      _release(address);
+    }
+  }
+}
+
+/**
+ * Trial deletion (synchronous cycle collection):
+ *
+ *   - Mark gray: the internal references of the subgraphs
+ *     of the candidates are subtracted
+ *   - Scan: the objects with the remaining (external) references, or
+ *     referenced from the roots, are black, and their counters are
+ *     restored; the rest are white
+ *   - Collect white: the white objects are garbage cycles
+ */
+void RCCollector::collectCycles() {
+  _scanRoots();
+
+  std::unordered_map<Word, Color> colors;
+
+  for (const auto& candidate : _candidates) {
+    _markGray(candidate, colors);
+  }
+
+  for (const auto& candidate : _candidates) {
+    _scan(candidate, colors);
+  }
+
+  _candidates.clear();
+
+  for (const auto& entry : colors) {
+    if (entry.second == Color::White) {
+      _free(entry.first);
+      stats->reclaimed++;
+    } else if (_getHeader(entry.first)->rc == 0) {
+      // Referenced only from the roots.
+      _zeroCount.insert(entry.first);
+    }
+  }
+}
+
+/**
+ * Write barrier: buffers the increment for the new pointer,
+ * and the decrement for the overwritten one. The roots are not
+ * counted (deferred reference counting).
+ */
+void RCCollector::onWrite(Word address, Value& value) {
+  if (_isInRoot(address)) {
+    return;
+  }
+
+  auto old = (Value*)allocator->heap->asWordPointer(address);
+
+  if (old->isPointer() && !old->isNullPointer()) {
+    _decrements.push_back(old->decode());
+  }
+
+  if (value.isPointer() && !value.isNullPointer()) {
+    _increments.push_back(value.decode());
+  }
+}
+
+/**
+ * The new object is cleared (the stale pointers are not counted by
+ * the write barrier), and is added to the ZCT: it's freed by the next
+ * epoch, unless it's referenced by then.
+ */
+void RCCollector::onAllocate(Word address) {
+  if (_increments.size() + _decrements.size() + _newObjects >= epochSize) {
+    epoch();
+  }
+  _newObjects++;
+
+  memset(allocator->heap->asBytePointer(address), 0, _sizeOf(address));
+
+  _getHeader(address)->rc = 0;
+  _zeroCount.insert(address);
+}
+
+/**
+ * Updates the root referents. Since the root writes are not counted,
+ * an object dropped by the roots is handled as decremented: it goes
+ * to the ZCT, or becomes a cycle candidate.
+ */
+void RCCollector::_scanRoots() {
+  std::unordered_set<Word> referents;
+
+  for (const auto& root : getRootObjects()) {
+    referents.insert(root);
+    for (const auto& child : _getChildren(root)) {
+      referents.insert(child);
+    }
+  }
+
+  _forEachRootSlot([&](Value* slot) { referents.insert(slot->decode()); });
+
+  for (const auto& address : _referents) {
+    if (referents.count(address) > 0) {
+      continue;
+    }
+    if (_getHeader(address)->rc == 0) {
+      _zeroCount.insert(address);
+    } else if (_isCandidate(address)) {
+      _candidates.insert(address);
+    }
+  }
+
+  _referents = std::move(referents);
+}
+
+/**
+ * Whether the address is in a root object.
+ */
+bool RCCollector::_isInRoot(Word address) {
+  for (const auto& root : getRootObjects()) {
+    if (address >= root && address < root + _sizeOf(root)) {
+      return true;
+    }
+  }
+  return false;
+}
+
+/**
+ * Increments the counter. Once it reaches the `STICKY_RC`,
+ * it's not updated anymore.
+ */
+void RCCollector::_increment(Word address) {
+  auto header = _getHeader(address);
+
+  if (header->rc == STICKY_RC) {
+    return;
+  }
+
+  if (++header->rc == STICKY_RC) {
+    _overflowed = true;
+  }
+}
+
+/**
+ * Decrements the counter (unless sticky). Returns true
+ * if it dropped to zero.
+ */
+bool RCCollector::_decrement(Word address) {
+  auto header = _getHeader(address);
+
+  if (header->rc == STICKY_RC || header->rc == 0) {
+    return false;
+  }
+
+  return --header->rc == 0;
+}
+
+/**
+ * Whether the decremented object may be a root of a garbage cycle
+ * (the sticky objects are left to the backup tracing).
+ */
+bool RCCollector::_isCandidate(Word address) {
+  auto rc = _getHeader(address)->rc;
+  return rc > 0 && rc != STICKY_RC;
+}
+
+/**
+ * Frees the object, and decrements its children. The children dropped
+ * to zero are freed too, unless referenced from the roots (then they
+ * stay in the ZCT). The rest become the cycle candidates.
+ */
+void RCCollector::_release(Word address) {
+  std::vector<Word> worklist{address};
+
+  while (!worklist.empty()) {
+    auto v = worklist.back();
+    worklist.pop_back();
+
+    auto children = _getChildren(v);
+
+    _free(v);
+    stats->reclaimed++;
+
+    for (const auto& child : children) {
+      if (!_decrement(child)) {
+        if (_isCandidate(child)) {
+          _candidates.insert(child);
+        }
+      } else if (_referents.count(child) == 0) {
+        worklist.push_back(child);
+      } else {
+        _zeroCount.insert(child);
+      }
+    }
+  }
+}
+
+/**
+ * Subtracts the internal references of the subgraph.
+ */
+void RCCollector::_markGray(Word address,
+                            std::unordered_map<Word, Color>& colors) {
+  std::vector<Word> worklist{address};
+
+  while (!worklist.empty()) {
+    auto v = worklist.back();
+    worklist.pop_back();
+
+    if (colors[v] == Color::Gray) {
+      continue;
+    }
+    colors[v] = Color::Gray;
+
+    for (const auto& child : _getChildren(v)) {
+      _decrement(child);
+      worklist.push_back(child);
+    }
+  }
+}
+
+/**
+ * Colors the gray subgraph: black if externally referenced,
+ * white otherwise.
+ */
+void RCCollector::_scan(Word address,
+                        std::unordered_map<Word, Color>& colors) {
+  std::vector<Word> worklist{address};
+
+  while (!worklist.empty()) {
+    auto v = worklist.back();
+    worklist.pop_back();
+
+    if (colors[v] != Color::Gray) {
+      continue;
+    }
+
+    if (_getHeader(v)->rc > 0 || _referents.count(v) > 0) {
+      _scanBlack(v, colors);
+      continue;
+    }
+
+    colors[v] = Color::White;
+
+    for (const auto& child : _getChildren(v)) {
+      worklist.push_back(child);
+    }
+  }
+}
+
+/**
+ * Restores the counters of the subgraph, reachable
+ * from an externally referenced object.
+ */
+void RCCollector::_scanBlack(Word address,
+                             std::unordered_map<Word, Color>& colors) {
+  std::vector<Word> worklist{address};
+  colors[address] = Color::Black;
+
+  while (!worklist.empty()) {
+    auto v = worklist.back();
+    worklist.pop_back();
+
+    for (const auto& child : _getChildren(v)) {
+      _increment(child);
+      if (colors[child] != Color::Black) {
+        colors[child] = Color::Black;
+        worklist.push_back(child);
+      }
+    }
+  }
+}
+
+/**
+ * Backup tracing: marks the reachable objects (in a side set, since
+ * the mark bit shares the byte with the counter), frees the rest,
+ * and recomputes the counters from the heap references.
+ */
+void RCCollector::_trace() {
+  std::unordered_set<Word> marked;
+  auto worklist = getRoots();
+
+  while (!worklist.empty()) {
+    auto v = worklist.back();
+    worklist.pop_back();
+
+    if (marked.insert(v).second) {
+      for (const auto& child : _getChildren(v)) {
+        worklist.push_back(child);
+      }
+    }
+  }
+
+  auto heapSize = allocator->heap->size();
+  Word scan = sizeof(ObjectHeader);
+
+  while (scan < heapSize) {
+    auto header = allocator->getHeader(scan);
+
+    if (header->used && marked.count(scan) == 0) {
+      allocator->free(scan);
+      stats->reclaimed++;
+    }
+
+    scan += header->size + sizeof(ObjectHeader);
+  }
+
+  if (largeObjects != nullptr) {
+    std::vector<Word> garbage;
+    largeObjects->forEachObject([&](Word address) {
+      if (marked.count(address) == 0) {
+        garbage.push_back(address);
+      }
+    });
+    for (const auto& address : garbage) {
+      largeObjects->free(address);
+      stats->reclaimed++;
+    }
+  }
+
+  _overflowed = false;
+  _zeroCount.clear();
+  _candidates.clear();
+  _referents.clear();
+
+  for (const auto& address : marked) {
+    _getHeader(address)->rc = 0;
+  }
+
+  for (const auto& address : marked) {
+    for (const auto& child : _getChildren(address)) {
+      _increment(child);
+    }
+  }
+
+  for (const auto& address : marked) {
+    if (_getHeader(address)->rc == 0) {
+      _zeroCount.insert(address);
+    }
+  }
+
+  _scanRoots();
+}
+
+/**
+ * Frees the object from the heap, or the large object space,
+ * and forgets it.
+ */
+void RCCollector::_free(Word address) {
+  _zeroCount.erase(address);
+  _candidates.erase(address);
+  _referents.erase(address);
+
+  if (_isLargeObject(address)) {
+    largeObjects->free(address);
+  } else {
+    allocator->free(address);
+  }
+}
+
+/**
+ * Returns the payload size of the object.
+ */
+uint32_t RCCollector::_sizeOf(Word address) {
+  return _isLargeObject(address) ? largeObjects->sizeOf(address)
+                                 : allocator->getHeader(address)->size;
+}
+
+/**
+ * Returns the children of the object.
+ */
+std::vector<Word> RCCollector::_getChildren(Word address) {
+  std::vector<Word> children;
+  _forEachPointer(address, [&](Value* p) { children.push_back(p->decode()); });
+  return children;
+}
@@ -0,0 +1,196 @@
+/**
+ * The MIT License (MIT)
+ * Copyright (c) 2018-present Dmitry Soshnikov <dmitry.soshnikov@gmail.com>
+ */
+
+#pragma once
+
+#include <memory>
+#include <set>
+#include <unordered_map>
+#include <unordered_set>
+#include <vector>
+
+#include "../ICollector.h"
+
+#include "../../Value/Value.h"
+#include "../../allocators/IAllocator.h"
+
+/**
+ * Deferred reference counting collector.
+ *
+ * The reference counters are stored in the object headers (`rc`), and
+ * count only the heap references: the writes to the roots are ignored.
+ * The write barrier doesn't update the counters either, it buffers
+ * an increment for the new pointer, and a decrement for the overwritten
+ * one. The buffers are processed at the epoch:
+ *
+ *   - Increments: applied first, so a pointer moved between the slots
+ *     doesn't free the object
+ *   - Decrements: the objects which drop to zero go to the zero count
+ *     table (ZCT), the rest become the candidates for the cycle roots
+ *   - ZCT: the zero count objects, which are not referenced from the
+ *     roots, are freed, and their children are decremented recursively
+ *
+ * The roots are scanned at the epoch instead: an object dropped by the
+ * roots is handled as decremented. The new objects are born with zero
+ * count in the ZCT, so the garbage is reclaimed by the next epoch,
+ * without any tracing. An epoch is run by the allocation once the
+ * buffers are full (`epochSize`), and by `collect`. As with the tracing
+ * collectors, an object is kept alive only by the heap, and the roots:
+ * the new object should be linked, or held by a handle before the epoch.
+ *
+ * The cycles are reclaimed by the trial deletion (`collectCycles`): the
+ * internal references of the subgraphs of the candidates are subtracted,
+ * and the objects which are left with zero counts are garbage.
+ *
+ * The counter sticks at `STICKY_RC` (it's not updated anymore), and
+ * such objects are reclaimed by the backup tracing collection, which
+ * also recomputes all counters.
+ */
+class RCCollector : public ICollector {
+ public:
+  /**
+   * Sticky (overflowed) reference counter.
+   */
+  static constexpr uint8_t STICKY_RC = 255;
+
+  /**
+   * Number of the buffered increments and decrements (and the new
+   * objects), which starts an epoch on the next allocation.
+   */
+  uint32_t epochSize = 1024;
+
+  RCCollector(const std::shared_ptr<IAllocator>& allocator);
+
+  /**
+   * Runs an epoch, and the cycle collection. The backup tracing
+   * is run, if there are sticky counters.
+   */
+  std::shared_ptr<GCStats> collect();
+
+  /**
+   * Processes the buffered increments and decrements,
+   * and frees the zero count objects.
+   */
+  void epoch();
+
+  /**
+   * Reclaims the garbage cycles of the candidates (trial deletion).
+   * The counters should be up to date (after the epoch).
+   */
+  void collectCycles();
+
+  /**
+   * Buffers the increment for the new pointer, and the decrement
+   * for the overwritten one. The writes to the roots are ignored.
+   */
+  void onWrite(Word address, Value& value);
+
+  /**
+   * Clears the new object, and adds it to the ZCT.
+   */
+  void onAllocate(Word address);
+
+ private:
+  /**
+   * Colors of the trial deletion (an object without a color is black).
+   */
+  enum class Color { Black, Gray, White };
+
+  /**
+   * Buffered increments, and decrements.
+   */
+  std::vector<Word> _increments;
+  std::vector<Word> _decrements;
+
+  /**
+   * Zero count table: the objects with zero counter, which
+   * may be still referenced from the roots.
+   */
+  std::set<Word> _zeroCount;
+
+  /**
+   * Possible roots of the garbage cycles: the objects which
+   * were decremented to a non-zero counter.
+   */
+  std::set<Word> _candidates;
+
+  /**
+   * Root objects, and the objects referenced from them, and from
+   * the root slots (as of the last scan).
+   */
+  std::unordered_set<Word> _referents;
+
+  /**
+   * Number of the objects allocated since the last epoch.
+   */
+  uint32_t _newObjects = 0;
+
+  /**
+   * Whether some counter is sticky.
+   */
+  bool _overflowed = false;
+
+  /**
+   * Updates the root referents, the dropped ones
+   * are handled as decremented.
+   */
+  void _scanRoots();
+
+  /**
+   * Whether the address is in a root object.
+   */
+  bool _isInRoot(Word address);
+
+  /**
+   * Increments the counter (unless sticky).
+   */
+  void _increment(Word address);
+
+  /**
+   * Decrements the counter (unless sticky). Returns true
+   * if it dropped to zero.
+   */
+  bool _decrement(Word address);
+
+  /**
+   * Whether the decremented object may be a root of a garbage cycle.
+   */
+  bool _isCandidate(Word address);
+
+  /**
+   * Frees the object, and decrements its children. The children dropped
+   * to zero are freed too, unless referenced from the roots.
+   */
+  void _release(Word address);
+
+  /**
+   * Trial deletion phases.
+   */
+  void _markGray(Word address, std::unordered_map<Word, Color>& colors);
+  void _scan(Word address, std::unordered_map<Word, Color>& colors);
+  void _scanBlack(Word address, std::unordered_map<Word, Color>& colors);
+
+  /**
+   * Backup tracing: frees the unreachable objects,
+   * and recomputes the counters.
+   */
+  void _trace();
+
+  /**
+   * Frees the object from the heap, or the large object space,
+   * and forgets it.
+   */
+  void _free(Word address);
+
+  /**
+   * Returns the payload size of the object.
+   */
+  uint32_t _sizeOf(Word address);
+
+  /**
+   * Returns the children of the object.
+   */
+  std::vector<Word> _getChildren(Word address);
+};
@@ -0,0 +1,128 @@
+/**
+ * The MIT License (MIT)
+ * Copyright (c) 2018-present Dmitry Soshnikov <dmitry.soshnikov@gmail.com>
+ */
+
+#pragma once
+
+#include <stdint.h>
+#include <atomic>
+#include <list>
+#include <memory>
+#include <mutex>
+#include <vector>
+
+#include "../MemoryManager/Heap.h"
+
+/**
+ * Snapshot-at-the-beginning (SATB) queue.
+ *
+ * The write barrier of the concurrent marking records the overwritten
+ * pointers here. Each mutator thread appends to its own buffer without
+ * locking; a full buffer is handed over to the completed list, which
+ * the marking thread drains while it works:
+ *
+ *   mutator 1: [a, b, c] --full--> completed: [x, y, z], [a, b, c]
+ *   mutator 2: [d]                      |
+ *                                       v
+ *                                    marker
+ *
+ * The partially filled buffers are drained in the final remark pause.
+ */
+class SATBQueue {
+ public:
+  /**
+   * Entries in a thread buffer before it's handed over to the marker.
+   */
+  static constexpr uint32_t BUFFER_SIZE = 256;
+
+  SATBQueue() : _id(_nextId()) {}
+
+  /**
+   * Records the overwritten pointer in the buffer of the current thread.
+   */
+  void push(Word address) {
+    auto& buffer = _localBuffer();
+    buffer.push_back(address);
+
+    if (buffer.size() >= BUFFER_SIZE) {
+      std::lock_guard<std::mutex> lock(_mutex);
+      _completed.push_back(std::move(buffer));
+      buffer.clear();
+    }
+  }
+
+  /**
+   * Moves the completed buffers to the `entries` (marking thread).
+   * Returns false if there were none.
+   */
+  bool popCompleted(std::vector<Word>& entries) {
+    std::lock_guard<std::mutex> lock(_mutex);
+
+    if (_completed.empty()) {
+      return false;
+    }
+
+    for (auto& buffer : _completed) {
+      entries.insert(entries.end(), buffer.begin(), buffer.end());
+    }
+    _completed.clear();
+    return true;
+  }
+
+  /**
+   * Moves all entries, including the partially filled thread buffers,
+   * to the `entries`. The mutators should be stopped (remark pause).
+   */
+  void drain(std::vector<Word>& entries) {
+    popCompleted(entries);
+
+    std::lock_guard<std::mutex> lock(_mutex);
+    for (auto& buffer : _buffers) {
+      entries.insert(entries.end(), buffer->begin(), buffer->end());
+      buffer->clear();
+    }
+  }
+
+ private:
+  /**
+   * Queue id, which identifies the thread buffers of this queue
+   * (an address of a destroyed queue can be reused).
+   */
+  uint64_t _id;
+
+  /**
+   * Buffers of all threads, which pushed to this queue.
+   */
+  std::list<std::unique_ptr<std::vector<Word>>> _buffers;
+
+  /**
+   * Full buffers, not yet taken by the marker.
+   */
+  std::list<std::vector<Word>> _completed;
+
+  std::mutex _mutex;
+
+  /**
+   * Returns the buffer of the current thread, registering it
+   * on the first push.
+   */
+  std::vector<Word>& _localBuffer() {
+    thread_local uint64_t queueId = 0;
+    thread_local std::vector<Word>* buffer = nullptr;
+
+    if (queueId != _id) {
+      std::lock_guard<std::mutex> lock(_mutex);
+      _buffers.push_back(std::make_unique<std::vector<Word>>());
+      buffer = _buffers.back().get();
+      queueId = _id;
+    }
+
+    return *buffer;
+  }
+
+  static uint64_t _nextId() {
+    static std::atomic<uint64_t> id(0);
+    return ++id;
+  }
+};
@@ -0,0 +1,110 @@
+/**
+ * The MIT License (MIT)
+ * Copyright (c) 2018-present Dmitry Soshnikov <dmitry.soshnikov@gmail.com>
+ */
+
+#include "SemiSpaceGC.h"
+#include "../../MemoryManager/ObjectHeader.h"
+
+#include <cstring>
+#include <stdexcept>
+
+SemiSpaceGC::SemiSpaceGC(const std::shared_ptr<IAllocator>& allocator)
+    : ICollector(allocator),
+      _spaces(dynamic_cast<SemiSpaceAllocator*>(allocator.get())) {
+  if (_spaces == nullptr) {
+    throw std::runtime_error("SemiSpaceGC requires SemiSpaceAllocator.");
+  }
+}
+
+/**
+ * Main collection cycle.
+ */
+std::shared_ptr<GCStats> SemiSpaceGC::collect() {
+  _resetStats();
+
+  auto roots = getRootObjects();
+
+  _spaces->flip();
+  auto scan = _spaces->getSpaceStart();
+
+  for (const auto& root : roots) {
+    _copy(root);
+  }
+
+  _forEachRootSlot(
+      [&](Value* slot) { *slot = Value::Pointer(_copy(slot->decode())); });
+
+  // Scan the copied objects (the BFS queue), and the large objects,
+  // until no new objects are copied.
+  while (scan < _spaces->getCursor() || !_largeWorklist.empty()) {
+    Word object;
+
+    if (scan < _spaces->getCursor()) {
+      object = scan + sizeof(ObjectHeader);
+      scan = object + _spaces->getHeader(object)->size;
+    } else {
+      object = _largeWorklist.back();
+      _largeWorklist.pop_back();
+    }
+
+    _forEachPointer(object,
+                    [&](Value* p) { *p = Value::Pointer(_copy(p->decode())); });
+  }
+
+  _spaces->clearOtherSpace();
+  _sweepLargeObjects();
+
+  stats->reclaimed = stats->total - stats->alive;
+
+  return stats;
+}
+
+/**
+ * The first object of the current space.
+ */
+std::vector<Word> SemiSpaceGC::getRootObjects() {
+  std::vector<Word> roots;
+  auto root = _spaces->getSpaceStart() + sizeof(ObjectHeader);
+
+  if (root < _spaces->getCursor() && _spaces->getHeader(root)->used) {
+    roots.push_back(root);
+  }
+  return roots;
+}
+
+/**
+ * Copies the object to to-space (once), and returns its new address.
+ * The forwarding address is installed in the from-space header. The
+ * large objects are not copied, but marked, and put to the worklist.
+ */
+Word SemiSpaceGC::_copy(Word address) {
+  if (_isLargeObject(address)) {
+    if (_setMarked(address)) {
+      stats->alive++;
+      _largeWorklist.push_back(address);
+    }
+    return address;
+  }
+
+  // Already in to-space.
+  if (_spaces->contains(address)) {
+    return address;
+  }
+
+  auto header = _spaces->getHeader(address);
+
+  if (header->forward != 0) {
+    return header->getForward();
+  }
+
+  auto copy = _spaces->allocate(header->size);
+  auto heap = allocator->heap;
+  memcpy(heap->asBytePointer(copy), heap->asBytePointer(address), header->size);
+  _moveType(address, copy);
+
+  header->setForward(copy);
+  stats->alive++;
+
+  return copy;
+}
@@ -0,0 +1,65 @@
+/**
+ * The MIT License (MIT)
+ * Copyright (c) 2018-present Dmitry Soshnikov <dmitry.soshnikov@gmail.com>
+ */
+
+#pragma once
+
+#include <memory>
+#include <vector>
+
+#include "../ICollector.h"
+
+#include "../../Value/Value.h"
+#include "../../allocators/IAllocator.h"
+#include "../../allocators/SemiSpaceAllocator/SemiSpaceAllocator.h"
+
+/**
+ * Semi-space copying garbage collector (Cheney's algorithm).
+ *
+ * Works with the SemiSpaceAllocator. The collection flips the spaces,
+ * and copies the alive objects from the old space (from-space) to the
+ * new one (to-space) in the breadth-first order:
+ *
+ *   - The roots are copied first
+ *   - The `scan` pointer walks the copied objects, and copies their
+ *     children to the end of to-space (the allocation cursor), so
+ *     the to-space between `scan` and the cursor is the BFS queue
+ *   - A copied object leaves the forwarding address in its from-space
+ *     header, and the pointers to it are updated to this address
+ *
+ * The cost is proportional to the alive objects only, and the heap is
+ * compacted for free. The large objects are not moved: they are marked,
+ * and scanned in place. The registered root slots are updated to the
+ * copies.
+ */
+class SemiSpaceGC : public ICollector {
+ public:
+  SemiSpaceGC(const std::shared_ptr<IAllocator>& allocator);
+
+  /**
+   * Main collection cycle.
+   */
+  std::shared_ptr<GCStats> collect();
+
+  /**
+   * The first object of the current space.
+   */
+  std::vector<Word> getRootObjects();
+
+ private:
+  /**
+   * The allocator of the spaces.
+   */
+  SemiSpaceAllocator* _spaces;
+
+  /**
+   * Large objects to be scanned.
+   */
+  std::vector<Word> _largeWorklist;
+
+  /**
+   * Copies the object to to-space (once), and returns its new address.
+   */
+  Word _copy(Word address);
+};
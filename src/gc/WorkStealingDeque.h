@@ -0,0 +1,172 @@
+/**
+ * The MIT License (MIT)
+ * Copyright (c) 2018-present Dmitry Soshnikov <dmitry.soshnikov@gmail.com>
+ */
+
+#pragma once
+
+#include <stdint.h>
+#include <atomic>
+#include <memory>
+#include <vector>
+
+/**
+ * Work-stealing deque (Chase-Lev).
+ *
+ * Each marking thread owns a deque: the owner pushes, and pops the work
+ * from the back (LIFO, depth-first, cache friendly), and the idle threads
+ * steal from the front (the oldest items, which are usually the roots of
+ * larger subgraphs).
+ *
+ *            steal <- +---+---+---+---+ <-> push / pop
+ *                     | a | b | c | d |
+ *                     +---+---+---+---+
+ *                     top         bottom
+ *
+ * There are no locks: only the owner moves the `bottom`, and the thieves
+ * claim an item by advancing the `top` with a CAS. The owner races with
+ * the thieves only for the last item (with the same CAS).
+ *
+ * The items are stored in a circular array, which the owner grows when
+ * it's full. A thief may still read the old array, so it's retired,
+ * and freed with the deque.
+ *
+ * The `T` is a trivially copyable item (the heap address).
+ */
+template <typename T>
+class WorkStealingDeque {
+ public:
+  WorkStealingDeque(uint32_t capacity = 256)
+      : _top(0), _bottom(0), _array(new Array(capacity)) {}
+
+  ~WorkStealingDeque() { delete _array.load(std::memory_order_relaxed); }
+
+  WorkStealingDeque(const WorkStealingDeque&) = delete;
+  WorkStealingDeque& operator=(const WorkStealingDeque&) = delete;
+
+  /**
+   * Pushes the item to the back (owner).
+   */
+  void push(const T& item) {
+    auto bottom = _bottom.load(std::memory_order_relaxed);
+    auto top = _top.load(std::memory_order_acquire);
+    auto array = _array.load(std::memory_order_relaxed);
+
+    if (bottom - top >= array->capacity) {
+      array = _grow(array, top, bottom);
+    }
+
+    array->put(bottom, item);
+    std::atomic_thread_fence(std::memory_order_release);
+    _bottom.store(bottom + 1, std::memory_order_relaxed);
+  }
+
+  /**
+   * Pops the item from the back (owner).
+   */
+  bool pop(T& item) {
+    auto bottom = _bottom.load(std::memory_order_relaxed) - 1;
+    auto array = _array.load(std::memory_order_relaxed);
+    _bottom.store(bottom, std::memory_order_relaxed);
+    std::atomic_thread_fence(std::memory_order_seq_cst);
+    auto top = _top.load(std::memory_order_relaxed);
+
+    if (top > bottom) {
+      _bottom.store(bottom + 1, std::memory_order_relaxed);
+      return false;
+    }
+
+    item = array->get(bottom);
+
+    if (top < bottom) {
+      return true;
+    }
+
+    // The last item: the thieves may claim it as well.
+    auto won = _top.compare_exchange_strong(
+        top, top + 1, std::memory_order_seq_cst, std::memory_order_relaxed);
+    _bottom.store(bottom + 1, std::memory_order_relaxed);
+    return won;
+  }
+
+  /**
+   * Steals the item from the front (other threads). Fails, if the deque
+   * is empty, or another thread has claimed the item first.
+   */
+  bool steal(T& item) {
+    auto top = _top.load(std::memory_order_acquire);
+    std::atomic_thread_fence(std::memory_order_seq_cst);
+    auto bottom = _bottom.load(std::memory_order_acquire);
+
+    if (top >= bottom) {
+      return false;
+    }
+
+    item = _array.load(std::memory_order_acquire)->get(top);
+    return _top.compare_exchange_strong(
+        top, top + 1, std::memory_order_seq_cst, std::memory_order_relaxed);
+  }
+
+  /**
+   * Whether the deque is empty (a snapshot, which takes no locks,
+   * so the idle threads can poll it).
+   */
+  bool empty() const {
+    auto bottom = _bottom.load(std::memory_order_acquire);
+    auto top = _top.load(std::memory_order_acquire);
+    return top >= bottom;
+  }
+
+ private:
+  /**
+   * Circular array of the items, the capacity is a power of 2.
+   */
+  struct Array {
+    int64_t capacity;
+    std::unique_ptr<std::atomic<T>[]> items;
+
+    Array(int64_t capacity)
+        : capacity(capacity), items(new std::atomic<T>[capacity]) {}
+
+    T get(int64_t i) {
+      return items[i & (capacity - 1)].load(std::memory_order_relaxed);
+    }
+
+    void put(int64_t i, const T& item) {
+      items[i & (capacity - 1)].store(item, std::memory_order_relaxed);
+    }
+  };
+
+  /**
+   * Index of the front item (advanced by the thieves, and by the owner
+   * for the last item).
+   */
+  std::atomic<int64_t> _top;
+
+  /**
+   * Index after the back item (moved only by the owner).
+   */
+  std::atomic<int64_t> _bottom;
+
+  std::atomic<Array*> _array;
+
+  /**
+   * The arrays replaced by the larger ones (may be read by the thieves).
+   */
+  std::vector<std::unique_ptr<Array>> _retired;
+
+  /**
+   * Copies the items to an array of twice the capacity (owner).
+   */
+  Array* _grow(Array* array, int64_t top, int64_t bottom) {
+    auto grown = new Array(array->capacity * 2);
+
+    for (auto i = top; i < bottom; i++) {
+      grown->put(i, array->get(i));
+    }
+
+    _retired.emplace_back(array);
+    _array.store(grown, std::memory_order_release);
+    return grown;
+  }
+};
@@ -0,0 +1,327 @@
+/**
+ * The MIT License (MIT)
+ * Copyright (c) 2018-present Dmitry Soshnikov <dmitry.soshnikov@gmail.com>
+ */
+
+#include <vector>
+
+#include "BasicMemoryManager.h"
+#include "BumpPointerAllocator.h"
+#include "GenerationalGC.h"
+#include "MarkCompactGC.h"
+#include "MarkSweepGC.h"
+#include "RCCollector.h"
+#include "SingleFreeListAllocator.h"
+#include "gtest/gtest.h"
+
+namespace {
+
+TEST(BasicMemoryManager, allocate) {
+  auto mm = BasicMemoryManager<SingleFreeListAllocator, MarkSweepGC>::create<
+      64>();
+
+  auto p1 = mm->allocate(8);
+  EXPECT_EQ(p1.decode(), sizeof(ObjectHeader));
+  EXPECT_EQ(mm->sizeOf(p1), 8);
+
+  auto p2 = mm->allocate(8);
+  EXPECT_EQ(mm->getHeader(p2)->size, 8);
+  EXPECT_EQ(mm->getObjectCount(), 2);
+
+  mm->free(p2);
+  EXPECT_EQ(mm->getObjectCount(), 1);
+
+  // The same objects through the polymorphic interface.
+  MemoryManager& base = *mm;
+  auto p3 = base.allocate(8);
+  EXPECT_EQ(base.sizeOf(p3), 8);
+  EXPECT_EQ(mm->getObjectCount(), 2);
+}
+
+TEST(BasicMemoryManager, forEachPointer) {
+  auto mm = BasicMemoryManager<SingleFreeListAllocator, MarkSweepGC>::create<
+      64>();
+
+  auto p1 = mm->allocate(12);
+  mm->writeValue(p1, Value::Pointer(20));
+  mm->writeValue(p1 + 1, Value::Number(1));
+  mm->writeValue(p1 + 2, Value::Pointer(24));
+
+  std::vector<Word> visited;
+  mm->forEachPointer(p1, [&](Value* p) { visited.push_back(p->decode()); });
+
+  EXPECT_EQ(visited, (std::vector<Word>{20, 24}));
+  EXPECT_EQ(mm->getPointers(p1).size(), 2);
+
+  // Typed object: only the first word is a pointer.
+  auto type = mm->registerType({0b1});
+  auto p2 = mm->allocate(8, type);
+  mm->writeValue(p2, Value::Pointer(20));
+  mm->writeValue(p2 + 1, Value::Pointer(24));
+  EXPECT_EQ(mm->getPointers(p2).size(), 1);
+}
+
+TEST(BasicMemoryManager, markCompact) {
+  auto mm = BasicMemoryManager<BumpPointerAllocator, MarkCompactGC>::create<
+      128>();
+
+  auto root = mm->allocate(4);
+  auto p1 = mm->allocate(4);
+  auto p2 = mm->allocate(4);
+
+  mm->writeValue(root, Value::Pointer(p2));
+  mm->writeValue(p1, Value::Number(1));
+  mm->writeValue(p2, Value::Number(2));
+
+  auto stats = mm->collect();
+  EXPECT_EQ(stats->alive, 2);
+  EXPECT_EQ(stats->reclaimed, 1);
+
+  // p2 is moved to the place of p1.
+  EXPECT_EQ(mm->readValue(root)->decode(), p1.decode());
+  EXPECT_EQ(mm->readValue(p1)->decode(), 2);
+}
+
+TEST(BasicMemoryManager, boundMarkSweep) {
+  auto mm = BasicMemoryManager<SingleFreeListAllocator, MarkSweepGC>::create<
+      256>();
+  auto gc = std::static_pointer_cast<MarkSweepGC>(mm->collector);
+
+  // The mark, and sweep loops call the allocator directly,
+  // with one, and several marking threads.
+  for (uint32_t threads = 1; threads <= 2; threads++) {
+    gc->markThreads = threads;
+
+    // Root -> p1, p2 is garbage.
+    auto root = mm->allocate(8);
+    auto p1 = mm->allocate(8);
+    mm->allocate(8);
+
+    mm->writeValue(root, Value::Pointer(p1));
+    mm->writeValue(root + 1, Value::Number(0));
+    mm->writeValue(p1, Value::Number(1));
+    mm->writeValue(p1 + 1, Value::Number(1));
+
+    auto stats = mm->collect();
+    EXPECT_EQ(stats->alive, 2);
+    EXPECT_EQ(stats->reclaimed, 1);
+    EXPECT_EQ(mm->getHeader(p1)->mark, 0);
+
+    mm->reset();
+  }
+}
+
+TEST(BasicMemoryManager, collectorBarrier) {
+  auto mm = BasicMemoryManager<SingleFreeListAllocator,
+                               GenerationalGC>::create<1024>();
+  auto gc = std::static_pointer_cast<GenerationalGC>(mm->collector);
+
+  auto root = mm->allocate(8);
+  mm->writeValue(root, Value::Number(0));
+  mm->writeValue(root + 1, Value::Number(0));
+  mm->collect();
+
+  // The card marking barrier of the collector is called directly.
+  Word oldRoot = sizeof(ObjectHeader);
+  auto p1 = mm->allocate(4);
+  mm->writeValue(p1, Value::Number(1));
+  mm->writeValue(oldRoot + 4, Value::Pointer(p1));
+  EXPECT_TRUE(gc->isCardDirty(oldRoot));
+
+  auto stats = mm->collect();
+  EXPECT_EQ(stats->alive, 1);
+  EXPECT_FALSE(mm->nursery->contains(mm->readValue(oldRoot + 4)->decode()));
+}
+
+/**
+ * Counts the writes, which reach the collector's barrier.
+ */
+class CountingGC : public MarkCompactGC {
+ public:
+  using MarkCompactGC::MarkCompactGC;
+
+  uint32_t writes = 0;
+
+  void onWrite(Word address, Value& value) override { writes++; }
+};
+
+TEST(BasicMemoryManager, collectorBarrierFilter) {
+  auto mm = BasicMemoryManager<SingleFreeListAllocator, CountingGC>::create<
+      64>();
+  auto gc = std::static_pointer_cast<CountingGC>(mm->collector);
+  gc->writeBarrierEnabled = true;
+
+  auto p1 = mm->allocate(8);
+  mm->writeValue(p1, Value::Number(0));
+  mm->writeValue(p1 + 1, Value::Number(0));
+
+  // The non-pointer stores over the non-pointers are filtered out.
+  mm->writeValue(p1, Value::Number(1));
+  mm->writeValue(p1, Value::Boolean(1));
+  mm->writeValue(p1, Value::Pointer(nullptr));
+  EXPECT_EQ(gc->writes, 0);
+
+  // Storing, or overwriting a pointer reaches the collector.
+  mm->writeValue(p1, Value::Pointer(p1));
+  mm->writeValue(p1, Value::Number(2));
+  EXPECT_EQ(gc->writes, 2);
+}
+
+TEST(BasicMemoryManager, cardBarrier) {
+  auto mm = BasicMemoryManager<SingleFreeListAllocator, GenerationalGC,
+                               CardBarrier>::create<1024>();
+  auto gc = std::static_pointer_cast<GenerationalGC>(mm->collector);
+
+  auto root = mm->allocate(8);
+  mm->writeValue(root, Value::Number(0));
+  mm->writeValue(root + 1, Value::Number(0));
+  mm->collect();
+
+  Word oldRoot = sizeof(ObjectHeader);
+  auto p1 = mm->allocate(4);
+  mm->writeValue(p1, Value::Number(1));
+
+  // The non-pointer stores are filtered out.
+  mm->writeValue(oldRoot, Value::Number(1));
+  mm->writeValue(oldRoot, Value::Boolean(1));
+  mm->writeValue(oldRoot, Value::Pointer(nullptr));
+  EXPECT_FALSE(gc->isCardDirty(oldRoot));
+
+  // A raw word store goes through the barrier as well.
+  mm->writeWord(oldRoot + 4, p1);
+  EXPECT_TRUE(gc->isCardDirty(oldRoot));
+
+  auto stats = mm->collect();
+  EXPECT_EQ(stats->alive, 1);
+  EXPECT_EQ(mm->readValue(mm->readValue(oldRoot + 4)->decode())->decode(), 1);
+}
+
+TEST(BasicMemoryManager, baseInterface) {
+  auto mm = BasicMemoryManager<SingleFreeListAllocator, GenerationalGC,
+                               CardBarrier>::create<1024>();
+  auto gc = std::static_pointer_cast<GenerationalGC>(mm->collector);
+  MemoryManager& base = *mm;
+
+  auto root = base.allocate(8);
+  base.writeValue(root, Value::Number(0));
+  base.writeValue(root + 1, Value::Number(0));
+  base.collect();
+
+  // The stores through the base class go through the same barrier.
+  Word oldRoot = sizeof(ObjectHeader);
+  auto p1 = base.allocate(4);
+  EXPECT_TRUE(mm->nursery->contains(p1));
+  base.writeValue(p1, Value::Number(1));
+  base.writeWord(oldRoot + 4, p1);
+  EXPECT_TRUE(gc->isCardDirty(oldRoot));
+
+  auto stats = base.collect();
+  EXPECT_EQ(stats->alive, 1);
+  auto promoted = base.readValue(oldRoot + 4)->decode();
+  EXPECT_FALSE(mm->nursery->contains(promoted));
+  EXPECT_EQ(base.readValue(promoted)->decode(), 1);
+}
+
+TEST(BasicMemoryManager, supportsBarrier) {
+  // The collectors, which depend on the barrier, reject the others
+  // (the composition doesn't compile).
+  static_assert(SupportsBarrier<GenerationalGC, CardBarrier>::value);
+  static_assert(!SupportsBarrier<GenerationalGC, NoBarrier>::value);
+  static_assert(!SupportsBarrier<RCCollector, SATBBarrier>::value);
+  static_assert(SupportsBarrier<MarkSweepGC, SATBBarrier>::value);
+  static_assert(!SupportsBarrier<MarkCompactGC, RCBarrier>::value);
+
+  // Any collector works with its own barrier.
+  static_assert(SupportsBarrier<RCCollector, CollectorBarrier>::value);
+  static_assert(SupportsBarrier<MarkCompactGC, CollectorBarrier>::value);
+}
+
+TEST(BasicMemoryManager, noBarrierMarkSweep) {
+  auto mm = BasicMemoryManager<SingleFreeListAllocator, MarkSweepGC,
+                               NoBarrier>::create<256>();
+  auto gc = std::static_pointer_cast<MarkSweepGC>(mm->collector);
+
+  auto root = mm->allocate(8);
+  mm->writeValue(root, Value::Number(0));
+  mm->writeValue(root + 1, Value::Number(0));
+  mm->allocate(8);
+
+  // Stop-the-world collections need no barrier.
+  EXPECT_EQ(mm->collect()->reclaimed, 1);
+
+  // The incremental, and concurrent marks are rejected.
+  MemoryManager& base = *mm;
+  EXPECT_THROW(mm->collectStep(1), std::runtime_error);
+  EXPECT_THROW(base.collectStep(1), std::runtime_error);
+
+  gc->concurrentMark = true;
+  EXPECT_THROW(mm->collect(), std::runtime_error);
+  EXPECT_THROW(base.collectFull(), std::runtime_error);
+  EXPECT_FALSE(gc->markPending);
+}
+
+TEST(BasicMemoryManager, satbBarrier) {
+  auto mm = BasicMemoryManager<SingleFreeListAllocator, MarkSweepGC,
+                               SATBBarrier>::create<1024>();
+
+  // Root -> p1 -> p2 -> p3.
+  auto root = mm->allocate(8);
+  std::vector<Value> objects;
+
+  for (auto i = 0; i < 3; i++) {
+    auto p = mm->allocate(8);
+    mm->writeValue(p, Value::Number(0));
+    mm->writeValue(p + 1, Value::Number(i));
+    objects.push_back(p);
+  }
+
+  mm->writeValue(root, Value::Pointer(objects[0]));
+  mm->writeValue(root + 1, Value::Number(0));
+  mm->writeValue(objects[0], Value::Pointer(objects[1]));
+  mm->writeValue(objects[1], Value::Pointer(objects[2]));
+
+  // The root is black, p1 is grey.
+  EXPECT_TRUE(mm->collectStep(1));
+
+  // The mutator moves p3 to the black root, and removes it from p2.
+  // The barrier shades p3.
+  mm->writeValue(root + 1, Value::Pointer(objects[2]));
+  mm->writeValue(objects[1], Value::Number(2));
+
+  while (mm->collectStep(1)) {
+  }
+
+  auto stats = mm->collector->stats;
+  EXPECT_EQ(stats->alive, 4);
+  EXPECT_EQ(stats->reclaimed, 0);
+}
+
+TEST(BasicMemoryManager, rcBarrier) {
+  auto mm = BasicMemoryManager<SingleFreeListAllocator, RCCollector,
+                               RCBarrier>::create<256>();
+
+  // Root -> p1 -> p2.
+  auto root = mm->allocate(8);
+  auto p1 = mm->allocate(8);
+  auto p2 = mm->allocate(8);
+
+  mm->writeValue(root, Value::Pointer(p1));
+  mm->writeValue(root + 1, Value::Number(0));
+  mm->writeValue(p1, Value::Pointer(p2));
+  mm->writeValue(p1 + 1, Value::Number(1));
+  mm->writeValue(p2, Value::Number(2));
+  mm->writeValue(p2 + 1, Value::Number(2));
+
+  auto stats = mm->collect();
+  EXPECT_EQ(stats->reclaimed, 0);
+  EXPECT_EQ(mm->getHeader(p2)->rc, 1);
+
+  // Dropping the last reference frees the object.
+  mm->writeValue(p1, Value::Number(2));
+
+  stats = mm->collect();
+  EXPECT_EQ(stats->reclaimed, 1);
+  EXPECT_EQ(mm->getObjectCount(), 2);
+}
+
+}  // namespace
@@ -0,0 +1,151 @@
+/**
+ * The MIT License (MIT)
+ * Copyright (c) 2018-present Dmitry Soshnikov <dmitry.soshnikov@gmail.com>
+ */
+
+#include <memory>
+#include <vector>
+
+#include "BumpPointerAllocator.h"
+#include "Heap.h"
+#include "MemoryManager.h"
+#include "ObjectHeader.h"
+#include "Value.h"
+
+#include "gtest/gtest.h"
+
+namespace {
+
+/**
+ * The expected addresses are computed from the header size,
+ * so the tests run in both header layouts.
+ */
+constexpr Word H = sizeof(ObjectHeader);
+
+static auto heap = std::make_shared<Heap>(8 * H);
+static BumpPointerAllocator allocator(heap);
+
+void reset() {
+  heap->reset();
+  allocator.reset();
+}
+
+TEST(BumpPointerAllocator, allocate) {
+  reset();
+
+  auto p1 = allocator.allocate(3);
+  EXPECT_EQ(p1, H);
+  EXPECT_EQ(allocator.getHeader(p1)->size, 4);
+  EXPECT_EQ(allocator.getHeader(p1)->used, 1);
+
+  auto p2 = allocator.allocate(5);
+  EXPECT_EQ(p2, 2 * H + 4);
+  EXPECT_EQ(allocator.getHeader(p2)->size, 8);
+
+  EXPECT_EQ(allocator.getCursor(), 2 * H + 12);
+
+  // The rest is described by a free block.
+  auto rest = allocator.getCursor() + H;
+  EXPECT_EQ(allocator.getHeader(rest)->size, 5 * H - 12);
+  EXPECT_EQ(allocator.getHeader(rest)->used, 0);
+}
+
+TEST(BumpPointerAllocator, oom) {
+  reset();
+
+  EXPECT_TRUE(allocator.allocate(8 * H).isNullPointer());
+
+  // Leaves the space for one more header, and a word.
+  auto p1 = allocator.allocate(6 * H - 4);
+  EXPECT_EQ(p1, H);
+
+  EXPECT_TRUE(allocator.allocate(8).isNullPointer());
+  EXPECT_EQ(allocator.allocate(4), 8 * H - 4);
+  EXPECT_TRUE(allocator.allocate(4).isNullPointer());
+}
+
+TEST(BumpPointerAllocator, free) {
+  reset();
+
+  auto p1 = allocator.allocate(4);
+  allocator.allocate(4);
+  EXPECT_EQ(allocator.getObjectCount(), 2);
+
+  // Freed blocks are not reused until compaction.
+  allocator.free(p1);
+  EXPECT_EQ(allocator.getHeader(p1)->used, 0);
+  EXPECT_EQ(allocator.getObjectCount(), 1);
+  EXPECT_EQ(allocator.allocate(4), 3 * H + 8);
+}
+
+TEST(BumpPointerAllocator, resetFrontier) {
+  reset();
+
+  allocator.allocate(4);
+  allocator.allocate(4);
+  allocator.allocate(4);
+
+  allocator.resetFrontier(H + 4, 1);
+  EXPECT_EQ(allocator.getCursor(), H + 4);
+  EXPECT_EQ(allocator.getObjectCount(), 1);
+
+  EXPECT_EQ(allocator.allocate(16), 2 * H + 4);
+  EXPECT_EQ(allocator.getObjectCount(), 2);
+}
+
+TEST(BumpPointerAllocator, findBlockStart) {
+  auto largeHeap = std::make_shared<Heap>(1024);
+  BumpPointerAllocator largeAllocator(largeHeap);
+  std::vector<Value> objects;
+
+  for (auto i = 0; i < 40; i++) {
+    objects.push_back(largeAllocator.allocate(8));
+  }
+
+  // The walk from the found block reaches the object within a chunk.
+  for (auto p : objects) {
+    auto block = largeAllocator.findBlockStart(p.toInt());
+    EXPECT_LE(p.toInt() - block, 256 + H + 8);
+
+    while (block + H < p.toInt()) {
+      block += H + largeAllocator.getHeader(block + H)->size;
+    }
+    EXPECT_EQ(block + H, p.toInt());
+  }
+
+  // After the cursor the walk starts from the cursor.
+  EXPECT_EQ(largeAllocator.findBlockStart(1020), largeAllocator.getCursor());
+}
+
+TEST(BumpPointerAllocator, largeHeap) {
+  // The free space larger than the max block size is described by
+  // several free blocks, absorbed by the cursor on allocation.
+  auto largeHeap = std::make_shared<Heap>(16 * (H + 60));
+  BumpPointerAllocator largeAllocator(largeHeap);
+
+  uint32_t count = 0;
+  while (!largeAllocator.allocate(60).isNullPointer()) {
+    count++;
+  }
+  EXPECT_EQ(count, 16);
+
+  // The heap is walkable.
+  Word scan = sizeof(ObjectHeader);
+  uint32_t blocks = 0;
+  while (scan < largeHeap->size()) {
+    EXPECT_EQ(largeAllocator.getHeader(scan)->used, 1);
+    scan += largeAllocator.getHeader(scan)->size + sizeof(ObjectHeader);
+    blocks++;
+  }
+  EXPECT_EQ(blocks, 16);
+}
+
+TEST(BumpPointerAllocator, MemoryManager) {
+  auto mm = MemoryManager::create<BumpPointerAllocator, 32>();
+
+  EXPECT_EQ(mm->allocate(4), H);
+  EXPECT_EQ(mm->allocate(4), 2 * H + 4);
+  EXPECT_EQ(mm->getObjectCount(), 2);
+}
+
+}  // namespace
@@ -0,0 +1,164 @@
+/**
+ * The MIT License (MIT)
+ * Copyright (c) 2018-present Dmitry Soshnikov <dmitry.soshnikov@gmail.com>
+ */
+
+#include "GenerationalGC.h"
+#include "MemoryManager.h"
+#include "SingleFreeListAllocator.h"
+#include "gtest/gtest.h"
+
+namespace {
+
+TEST(GenerationalGC, minor) {
+  auto mm =
+      MemoryManager::create<SingleFreeListAllocator, GenerationalGC, 1024>();
+
+  // Root -> p1 -> p2, p3 is garbage. All are young.
+  auto root = mm->allocate(8);
+  auto p1 = mm->allocate(8);
+  auto p2 = mm->allocate(4);
+  auto p3 = mm->allocate(4);
+
+  EXPECT_TRUE(mm->nursery->contains(root));
+  EXPECT_EQ(mm->getObjectCount(), 4);
+  EXPECT_EQ(mm->allocator->getObjectCount(), 0);
+
+  mm->writeValue(root, Value::Pointer(p1));
+  mm->writeValue(root + 1, Value::Number(0));
+  mm->writeValue(p1, Value::Pointer(p2));
+  mm->writeValue(p1 + 1, Value::Number(1));
+  mm->writeValue(p2, Value::Number(2));
+  mm->writeValue(p3, Value::Number(3));
+
+  auto stats = mm->collect();
+  EXPECT_EQ(stats->total, 4);
+  EXPECT_EQ(stats->alive, 3);
+  EXPECT_EQ(stats->reclaimed, 1);
+
+  // The survivors are promoted, the root is the first old object.
+  EXPECT_EQ(mm->nursery->getObjectCount(), 0);
+  EXPECT_EQ(mm->allocator->getObjectCount(), 3);
+
+  Word oldRoot = sizeof(ObjectHeader);
+  auto oldP1 = mm->readValue(oldRoot)->decode();
+  auto oldP2 = mm->readValue(oldP1)->decode();
+
+  EXPECT_FALSE(mm->nursery->contains(oldP1));
+  EXPECT_FALSE(mm->nursery->contains(oldP2));
+  EXPECT_EQ(mm->readValue(oldP1 + 4)->decode(), 1);
+  EXPECT_EQ(mm->readValue(oldP2)->decode(), 2);
+}
+
+TEST(GenerationalGC, cardMarking) {
+  auto mm =
+      MemoryManager::create<SingleFreeListAllocator, GenerationalGC, 1024>();
+  auto gc = std::static_pointer_cast<GenerationalGC>(mm->collector);
+
+  auto root = mm->allocate(8);
+  mm->writeValue(root, Value::Number(0));
+  mm->writeValue(root + 1, Value::Number(0));
+  mm->collect();
+
+  Word oldRoot = sizeof(ObjectHeader);
+  EXPECT_FALSE(gc->isCardDirty(oldRoot));
+
+  // An old-to-young pointer dirties the card.
+  auto p1 = mm->allocate(4);
+  mm->writeValue(p1, Value::Number(1));
+  mm->writeValue(oldRoot + 4, Value::Pointer(p1));
+  EXPECT_TRUE(gc->isCardDirty(oldRoot));
+
+  // A young-to-young, or an old-to-old pointer doesn't.
+  auto p2 = mm->allocate(4);
+  mm->writeValue(p2, Value::Pointer(p1));
+  mm->writeValue(oldRoot, Value::Pointer(oldRoot));
+  EXPECT_FALSE(gc->isCardDirty(mm->heap->size() - 4));
+
+  // The young object is kept alive by the card, and promoted.
+  auto stats = mm->collect();
+  EXPECT_EQ(stats->alive, 1);
+  EXPECT_EQ(stats->reclaimed, 1);
+  EXPECT_FALSE(gc->isCardDirty(oldRoot));
+
+  auto oldP1 = mm->readValue(oldRoot + 4)->decode();
+  EXPECT_FALSE(mm->nursery->contains(oldP1));
+  EXPECT_EQ(mm->readValue(oldP1)->decode(), 1);
+}
+
+TEST(GenerationalGC, nurseryFull) {
+  auto mm =
+      MemoryManager::create<SingleFreeListAllocator, GenerationalGC, 1024>();
+
+  auto root = mm->allocate(4);
+  mm->writeValue(root, Value::Number(0));
+
+  // The garbage dies young: the full nursery runs the minor
+  // collections, and the old space is not filled.
+  for (auto i = 0; i < 1000; i++) {
+    auto p = mm->allocate(4);
+    EXPECT_FALSE(p.isNullPointer());
+    mm->writeValue(p, Value::Number(i));
+  }
+
+  EXPECT_EQ(mm->allocator->getObjectCount(), 1);
+}
+
+TEST(GenerationalGC, nurseryFullElasticHeap) {
+  auto mm = MemoryManager::create<SingleFreeListAllocator, GenerationalGC,
+                                  256, 0, 1024>();
+
+  auto root = mm->allocator->allocate(4);
+  mm->writeValue(root, Value::Number(0));
+
+  // All objects survive (the root points to the last one, which points
+  // to the previous): the minor collections, run when the nursery is
+  // full, grow the old space (there are no allocation retries).
+  for (auto i = 0; i < 40; i++) {
+    auto p = mm->allocate(4);
+    ASSERT_FALSE(p.isNullPointer());
+    mm->writeValue(p, *mm->readValue(root));
+    mm->writeValue(root, Value::Pointer(p));
+  }
+
+  EXPECT_GT(mm->getHeapSize(), 256);
+  EXPECT_EQ(mm->getObjectCount(), 41);
+}
+
+TEST(GenerationalGC, major) {
+  auto mm =
+      MemoryManager::create<SingleFreeListAllocator, GenerationalGC, 256>();
+
+  // The old root, and the old garbage, which fills the old space.
+  auto root = mm->allocator->allocate(4);
+  mm->writeValue(root, Value::Number(0));
+
+  uint32_t garbage = 0;
+  while (true) {
+    auto p = mm->allocator->allocate(4);
+    if (p.isNullPointer()) {
+      break;
+    }
+    mm->writeValue(p, Value::Number(0));
+    garbage++;
+  }
+
+  auto p1 = mm->allocate(4);
+  mm->writeValue(p1, Value::Number(1));
+  mm->writeValue(root, Value::Pointer(p1));
+
+  // The survivor doesn't fit the old space: the major collection
+  // reclaims the old garbage first.
+  auto stats = mm->collect();
+  EXPECT_EQ(stats->total, garbage + 2);
+  EXPECT_EQ(stats->alive, 2);
+  EXPECT_EQ(stats->reclaimed, garbage);
+  EXPECT_EQ(mm->nursery->getObjectCount(), 0);
+  EXPECT_EQ(mm->getObjectCount(), 2);
+
+  auto oldP1 = mm->readValue(root)->decode();
+  EXPECT_FALSE(mm->nursery->contains(oldP1));
+  EXPECT_EQ(mm->readValue(oldP1)->decode(), 1);
+}
+
+}  // namespace
@@ -3,11 +3,28 @@
  * Copyright (c) 2018-present Dmitry Soshnikov <dmitry.soshnikov@gmail.com>
  */
 
+#include <sys/mman.h>
+#include <unistd.h>
+#include <algorithm>
+#include <vector>
+
 #include "Heap.h"
 #include "gtest/gtest.h"
 
 namespace {
 
+/**
+ * Returns the number of the resident pages of the heap storage.
+ */
+size_t residentPages(Heap& heap) {
+  size_t pageSize = sysconf(_SC_PAGESIZE);
+  std::vector<unsigned char> pages((heap.storage.size() + pageSize - 1) /
+                                   pageSize);
+  mincore(heap.storage.data(), heap.storage.size(), pages.data());
+  return std::count_if(pages.begin(), pages.end(),
+                       [](unsigned char page) { return page & 1; });
+}
+
 TEST(Heap, API) {
   Heap heap(32);
 
@@ -39,4 +56,77 @@ TEST(Heap, API) {
   EXPECT_EQ(*heap.asWordPointer(0), 0x00000000);
 }
 
-}  // namespace
\ No newline at end of file
+TEST(Heap, reserve) {
+  Heap heap(32);
+  *heap.asWordPointer(28) = 0xCCDDEEFF;
+
+  // The storage grows, the contents are kept, the new bytes are zero.
+  auto start = heap.reserve(1 << 20);
+  EXPECT_EQ(start, 32);
+  EXPECT_EQ(heap.totalSize(), 32 + (1 << 20));
+  EXPECT_EQ(heap.size(), 32);
+  EXPECT_EQ(*heap.asWordPointer(28), 0xCCDDEEFF);
+  EXPECT_EQ(*heap.asWordPointer(start + (1 << 19)), 0);
+}
+
+TEST(Heap, resetDropsPages) {
+  // Above the drop threshold, and larger than the touched pages.
+  uint32_t size = 16 << 20;
+  Heap heap(size);
+  heap.useHugePages();
+
+  for (uint32_t address = 0; address < size; address += size / 8) {
+    *heap.asWordPointer(address) = address + 1;
+  }
+  *heap.asWordPointer(size - sizeof(Word)) = 1;
+  EXPECT_GE(residentPages(heap), 9);
+
+  // The pages are returned to the OS (not written with zeros).
+  heap.reset();
+  EXPECT_EQ(residentPages(heap), 0);
+
+  for (uint32_t address = 0; address < size; address += size / 8) {
+    EXPECT_EQ(*heap.asWordPointer(address), 0);
+  }
+  EXPECT_EQ(*heap.asWordPointer(size - sizeof(Word)), 0);
+
+  // Writable after the reset.
+  *heap.asWordPointer(4) = 100;
+  EXPECT_EQ(*heap.asWordPointer(4), 100);
+}
+
+TEST(Heap, shrink) {
+  Heap heap(64);
+  auto start = heap.reserve(2 * HeapStorage::DROP_THRESHOLD);
+  auto end = heap.totalSize();
+
+  *heap.asWordPointer(start) = 1;
+  *heap.asWordPointer(end - sizeof(Word)) = 1;
+
+  // The released tail reads as zeros, when the storage grows again.
+  heap.storage.resize(start);
+  heap.storage.resize(end);
+  EXPECT_EQ(*heap.asWordPointer(start), 0);
+  EXPECT_EQ(*heap.asWordPointer(end - sizeof(Word)), 0);
+}
+
+TEST(Heap, elastic) {
+  Heap heap(64, 32, 256);
+  EXPECT_EQ(heap.size(), 64);
+  EXPECT_EQ(heap.limit(), 256);
+  EXPECT_EQ(heap.largeObjectSpaceEnd(), 288);
+
+  heap.resize(256);
+  *heap.asWordPointer(200) = 1;
+
+  // The unused space reads as zeros after the release.
+  heap.resize(64);
+  heap.releaseUnused();
+  heap.resize(256);
+  EXPECT_EQ(*heap.asWordPointer(200), 0);
+
+  EXPECT_THROW(heap.resize(512), std::length_error);
+  EXPECT_EQ(heap.size(), 256);
+}
+
+}  // namespace
@@ -0,0 +1,73 @@
+/**
+ * The MIT License (MIT)
+ * Copyright (c) 2018-present Dmitry Soshnikov <dmitry.soshnikov@gmail.com>
+ */
+
+#include <memory>
+
+#include "Heap.h"
+#include "ImmixAllocator.h"
+#include "ObjectHeader.h"
+#include "Value.h"
+
+#include "gtest/gtest.h"
+
+namespace {
+
+constexpr auto H = sizeof(ObjectHeader);
+constexpr auto LINE_SIZE = ImmixAllocator::LINE_SIZE;
+constexpr auto BLOCK_SIZE = ImmixAllocator::BLOCK_SIZE;
+
+TEST(ImmixAllocator, allocate) {
+  auto heap = std::make_shared<Heap>(2 * BLOCK_SIZE);
+  ImmixAllocator allocator(heap);
+
+  auto a = allocator.allocate(100);
+  EXPECT_EQ(a, H);
+  EXPECT_EQ(allocator.getHeader(a)->size, 100);
+  EXPECT_EQ(allocator.getHeader(a)->used, 1);
+
+  auto b = allocator.allocate(100);
+  EXPECT_EQ(b, 100 + 2 * H);
+  EXPECT_EQ(allocator.getObjectCount(), 2);
+
+  // Only the first line is live after the collection.
+  EXPECT_EQ(allocator.startCollection(), 0);
+  allocator.markLines(a);
+  allocator.finishCollection(1);
+
+  EXPECT_TRUE(allocator.isLineLive(0));
+  EXPECT_FALSE(allocator.isLineLive(LINE_SIZE));
+  EXPECT_EQ(allocator.getObjectCount(), 1);
+
+  // The allocation restarts from the first hole.
+  EXPECT_EQ(allocator.allocate(200), LINE_SIZE + H);
+
+  // The objects never cross the block boundary.
+  while (true) {
+    auto p = allocator.allocate(60);
+    if (p.isNullPointer()) {
+      break;
+    }
+    auto address = p.decode();
+    EXPECT_EQ((address - H) / BLOCK_SIZE, (address + 59) / BLOCK_SIZE);
+  }
+}
+
+TEST(ImmixAllocator, evacuation) {
+  auto heap = std::make_shared<Heap>(2 * BLOCK_SIZE);
+  ImmixAllocator allocator(heap);
+
+  auto a = allocator.allocate(4);
+  allocator.startCollection();
+  allocator.markLines(a);
+  allocator.finishCollection(1);
+
+  // The first block is sparsely live: it's evacuated,
+  // and the new objects are allocated in the second one.
+  EXPECT_EQ(allocator.startCollection(), 1);
+  EXPECT_TRUE(allocator.isEvacuating(a));
+  EXPECT_EQ(allocator.allocate(4), BLOCK_SIZE + H);
+}
+
+}  // namespace
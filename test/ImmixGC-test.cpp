@@ -0,0 +1,78 @@
+/**
+ * The MIT License (MIT)
+ * Copyright (c) 2018-present Dmitry Soshnikov <dmitry.soshnikov@gmail.com>
+ */
+
+#include "ImmixAllocator.h"
+#include "ImmixGC.h"
+#include "MemoryManager.h"
+#include "gtest/gtest.h"
+
+namespace {
+
+constexpr auto H = sizeof(ObjectHeader);
+constexpr auto LINE_SIZE = ImmixAllocator::LINE_SIZE;
+constexpr auto BLOCK_SIZE = ImmixAllocator::BLOCK_SIZE;
+
+TEST(ImmixGC, collect) {
+  auto mm =
+      MemoryManager::create<ImmixAllocator, ImmixGC, 2 * BLOCK_SIZE>();
+
+  // Root -> p1 -> p2, p3 is garbage, which covers the third line.
+  auto root = mm->allocate(8);
+  auto p1 = mm->allocate(120);
+  auto p3 = mm->allocate(252);
+  auto p2 = mm->allocate(120);
+
+  mm->writeValue(root, Value::Pointer(p1));
+  mm->writeValue(root + 1, Value::Number(0));
+  mm->writeValue(p1, Value::Pointer(p2));
+  mm->writeValue(p2, Value::Number(2));
+  mm->writeValue(p3, Value::Number(3));
+
+  auto stats = mm->collect();
+  EXPECT_EQ(stats->total, 4);
+  EXPECT_EQ(stats->alive, 3);
+  EXPECT_EQ(stats->reclaimed, 1);
+  EXPECT_EQ(mm->getObjectCount(), 3);
+
+  // The objects are not moved, the free line is reused.
+  EXPECT_EQ(mm->readValue(root)->decode(), p1.decode());
+  EXPECT_EQ(mm->readValue(p1)->decode(), p2.decode());
+  EXPECT_EQ(mm->allocate(100), 2 * LINE_SIZE + H);
+}
+
+TEST(ImmixGC, evacuation) {
+  auto mm =
+      MemoryManager::create<ImmixAllocator, ImmixGC, 2 * BLOCK_SIZE>();
+
+  // Root -> p, the rest of the first block is garbage.
+  auto root = mm->allocate(8);
+  auto p = mm->allocate(8);
+
+  mm->writeValue(root, Value::Pointer(p));
+  mm->writeValue(root + 1, Value::Number(0));
+  mm->writeValue(p, Value::Number(1));
+  mm->writeValue(p + 1, Value::Number(2));
+
+  while (mm->allocate(60) < BLOCK_SIZE) {
+  }
+
+  auto stats = mm->collect();
+  EXPECT_EQ(stats->alive, 2);
+  EXPECT_EQ(mm->readValue(root)->decode(), p.decode());
+
+  // The first block is fragmented now: p is evacuated to the second
+  // one, and the root (which is never moved) is updated.
+  stats = mm->collect();
+  EXPECT_EQ(stats->total, 2);
+  EXPECT_EQ(stats->alive, 2);
+
+  auto newP = mm->readValue(root)->decode();
+  EXPECT_EQ(newP, BLOCK_SIZE + H);
+  EXPECT_EQ(mm->readValue(newP)->decode(), 1);
+  EXPECT_EQ(mm->readValue(newP + 4)->decode(), 2);
+  EXPECT_EQ(mm->getObjectCount(), 2);
+}
+
+}  // namespace
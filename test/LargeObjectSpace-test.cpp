@@ -0,0 +1,170 @@
+/**
+ * The MIT License (MIT)
+ * Copyright (c) 2018-present Dmitry Soshnikov <dmitry.soshnikov@gmail.com>
+ */
+
+#include <sys/mman.h>
+#include <unistd.h>
+#include <algorithm>
+#include <cstring>
+#include <memory>
+#include <vector>
+
+#include "BumpPointerAllocator.h"
+#include "Heap.h"
+#include "LargeObjectSpace.h"
+#include "MarkCompactGC.h"
+#include "MarkSweepGC.h"
+#include "MemoryManager.h"
+#include "SingleFreeListAllocator.h"
+#include "Value.h"
+
+#include "gtest/gtest.h"
+
+namespace {
+
+static constexpr auto PAGE = LargeObjectSpace::PAGE_SIZE;
+
+/**
+ * Returns the number of the resident pages in the heap storage range.
+ */
+size_t residentPages(Heap& heap, Word address, uint32_t size) {
+  size_t pageSize = sysconf(_SC_PAGESIZE);
+  std::vector<unsigned char> pages((size + pageSize - 1) / pageSize);
+  mincore(heap.asBytePointer(address), size, pages.data());
+  return std::count_if(pages.begin(), pages.end(),
+                       [](unsigned char page) { return page & 1; });
+}
+
+TEST(LargeObjectSpace, allocate) {
+  auto heap = std::make_shared<Heap>(64, 4 * PAGE);
+  LargeObjectSpace space(heap);
+
+  // Page-aligned chunks after the heap.
+  auto p1 = space.allocate(1000);
+  EXPECT_EQ(p1, PAGE + sizeof(ObjectHeader));
+  EXPECT_EQ(space.sizeOf(p1), 1000);
+  EXPECT_EQ(space.getHeader(p1)->used, 1);
+  EXPECT_TRUE(space.contains(p1));
+
+  auto p2 = space.allocate(PAGE);
+  EXPECT_EQ(p2, 2 * PAGE + sizeof(ObjectHeader));
+
+  EXPECT_TRUE(space.allocate(PAGE).isNullPointer());
+  EXPECT_EQ(space.getObjectCount(), 2);
+
+  // The heap is not affected.
+  EXPECT_EQ(heap->size(), 64);
+  EXPECT_FALSE(space.contains(60));
+}
+
+TEST(LargeObjectSpace, free) {
+  auto heap = std::make_shared<Heap>(64, 4 * PAGE);
+  LargeObjectSpace space(heap);
+
+  auto p1 = space.allocate(1000);
+  auto p2 = space.allocate(1000);
+  auto p3 = space.allocate(1000);
+
+  // The chunks are recycled, and merged with the adjacent free chunks.
+  space.free(p1);
+  space.free(p3);
+  EXPECT_TRUE(space.allocate(2 * PAGE).isNullPointer());
+
+  space.free(p2);
+  EXPECT_EQ(space.getObjectCount(), 0);
+  EXPECT_EQ(space.allocate(3 * PAGE - sizeof(ObjectHeader)), p1.toInt());
+}
+
+TEST(LargeObjectSpace, freeReleasesPages) {
+  auto heap = std::make_shared<Heap>(64, 4 * PAGE);
+  LargeObjectSpace space(heap);
+
+  auto p1 = space.allocate(3 * PAGE - sizeof(ObjectHeader));
+  auto chunk = p1.toInt() - sizeof(ObjectHeader);
+  memset(heap->asBytePointer(p1), 1, space.sizeOf(p1));
+  EXPECT_GT(residentPages(*heap, chunk, 3 * PAGE), 0);
+
+  // The pages of the dead object are not committed to be cleared.
+  space.free(p1);
+  EXPECT_EQ(residentPages(*heap, chunk, 3 * PAGE), 0);
+
+  // The reused chunk is zero.
+  auto p2 = space.allocate(3 * PAGE - sizeof(ObjectHeader));
+  EXPECT_EQ(p2, p1.toInt());
+  EXPECT_EQ(heap->asBytePointer(p2)[PAGE], 0);
+}
+
+TEST(LargeObjectSpace, freeUnknown) {
+  auto heap = std::make_shared<Heap>(64, 4 * PAGE);
+  LargeObjectSpace space(heap);
+
+  auto p1 = space.allocate(1000);
+  space.free(p1);
+
+  // A double free, or an address inside the object is rejected,
+  // and the space is not changed.
+  auto p2 = space.allocate(1000);
+  EXPECT_THROW(space.free(p2.toInt() + 8), std::invalid_argument);
+  space.free(p2);
+  EXPECT_THROW(space.free(p2), std::invalid_argument);
+
+  EXPECT_EQ(space.getObjectCount(), 0);
+  EXPECT_EQ(space.allocate(3 * PAGE - sizeof(ObjectHeader)), p1.toInt());
+}
+
+TEST(LargeObjectSpace, MarkSweepGC) {
+  auto mm = MemoryManager::create<SingleFreeListAllocator, MarkSweepGC, 64,
+                                  2 * PAGE>();
+
+  // Root -> large -> p1, the rest is garbage.
+  auto root = mm->allocate(4);
+  auto large = mm->allocate(3000);
+  auto garbage = mm->allocate(3000);
+  auto p1 = mm->allocate(4);
+
+  EXPECT_TRUE(mm->largeObjects->contains(large));
+  EXPECT_EQ(mm->sizeOf(large), 3000);
+  EXPECT_EQ(mm->getObjectCount(), 4);
+
+  mm->writeValue(root, Value::Pointer(large));
+  mm->writeValue(large + 749, Value::Pointer(p1));
+  mm->writeValue(garbage, Value::Pointer(p1));
+
+  auto stats = mm->collect();
+  EXPECT_EQ(stats->total, 4);
+  EXPECT_EQ(stats->alive, 3);
+  EXPECT_EQ(stats->reclaimed, 1);
+  EXPECT_EQ(mm->getHeader(large)->mark, 0);
+
+  // The chunk of the garbage object is recycled.
+  EXPECT_EQ(mm->allocate(3000), garbage.toInt());
+}
+
+TEST(LargeObjectSpace, MarkCompactGC) {
+  auto mm = MemoryManager::create<BumpPointerAllocator, MarkCompactGC, 64,
+                                  PAGE>();
+
+  // Root -> large -> p2, p1 is garbage.
+  auto root = mm->allocate(4);
+  auto p1 = mm->allocate(4);
+  auto p2 = mm->allocate(4);
+  auto large = mm->allocate(3000);
+
+  mm->writeValue(root, Value::Pointer(large));
+  mm->writeValue(large, Value::Pointer(p2));
+  mm->writeValue(p2, Value::Number(2));
+  mm->writeValue(p1, Value::Number(1));
+
+  auto stats = mm->collect();
+  EXPECT_EQ(stats->alive, 3);
+  EXPECT_EQ(stats->reclaimed, 1);
+  EXPECT_EQ(mm->getObjectCount(), 3);
+
+  // The large object is not moved, and its pointer is updated.
+  EXPECT_EQ(mm->readValue(root)->decode(), large.toInt());
+  EXPECT_EQ(mm->readValue(large)->decode(), p1.toInt());
+  EXPECT_EQ(mm->readValue(p1)->decode(), 2);
+}
+
+}  // namespace
@@ -0,0 +1,62 @@
+/**
+ * The MIT License (MIT)
+ * Copyright (c) 2018-present Dmitry Soshnikov <dmitry.soshnikov@gmail.com>
+ */
+
+#include <memory>
+
+#include "../src/gc/MarkBitmap.h"
+#include "gtest/gtest.h"
+
+namespace {
+
+TEST(MarkBitmap, mark) {
+  MarkBitmap bitmap(std::make_shared<Heap>(1024));
+
+  EXPECT_FALSE(bitmap.isMarked(4));
+  EXPECT_TRUE(bitmap.mark(4));
+  EXPECT_TRUE(bitmap.isMarked(4));
+
+  // Already marked.
+  EXPECT_FALSE(bitmap.mark(4));
+  EXPECT_FALSE(bitmap.isMarked(8));
+
+  bitmap.clear();
+  EXPECT_FALSE(bitmap.isMarked(4));
+}
+
+TEST(MarkBitmap, nextMarked) {
+  MarkBitmap bitmap(std::make_shared<Heap>(1024));
+
+  // No marked objects.
+  EXPECT_EQ(bitmap.nextMarked(4), 1024);
+
+  bitmap.mark(12);
+  bitmap.mark(600);
+  bitmap.mark(1020);
+
+  EXPECT_EQ(bitmap.nextMarked(4), 12);
+  EXPECT_EQ(bitmap.nextMarked(12), 12);
+
+  // Across the bitmap words.
+  EXPECT_EQ(bitmap.nextMarked(16), 600);
+  EXPECT_EQ(bitmap.nextMarked(604), 1020);
+  EXPECT_EQ(bitmap.nextMarked(1024), 1024);
+}
+
+TEST(MarkBitmap, elasticHeap) {
+  auto heap = std::make_shared<Heap>(256, 0, 1024);
+  MarkBitmap bitmap(heap);
+
+  // The end is the current heap size.
+  EXPECT_EQ(bitmap.nextMarked(4), 256);
+
+  // The grown heap is covered up to the limit.
+  heap->resize(1024);
+  bitmap.mark(1020);
+  EXPECT_TRUE(bitmap.isMarked(1020));
+  EXPECT_EQ(bitmap.nextMarked(4), 1020);
+  EXPECT_EQ(bitmap.nextMarked(1024), 1024);
+}
+
+}  // namespace
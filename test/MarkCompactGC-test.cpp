@@ -0,0 +1,187 @@
+/**
+ * The MIT License (MIT)
+ * Copyright (c) 2018-present Dmitry Soshnikov <dmitry.soshnikov@gmail.com>
+ */
+
+#include "BumpPointerAllocator.h"
+#include "MarkCompactGC.h"
+#include "MemoryManager.h"
+#include "ObjectHeader.h"
+#include "SingleFreeListAllocator.h"
+#include "gtest/gtest.h"
+
+namespace {
+
+/**
+ * Header size, and the smallest free list block size (the expected
+ * addresses follow the header layout).
+ */
+constexpr Word H = sizeof(ObjectHeader);
+constexpr Word M = SingleFreeListAllocator::MIN_BLOCK_SIZE;
+
+TEST(MarkCompactGC, collect) {
+  auto mm =
+      MemoryManager::create<SingleFreeListAllocator, MarkCompactGC, 16 * H>();
+
+  // Root -> p3 -> p5, and p5 -> root.
+  auto p1 = mm->allocate(8);
+  auto p2 = mm->allocate(4);
+  auto p3 = mm->allocate(8);
+  auto p4 = mm->allocate(4);
+  auto p5 = mm->allocate(4);
+
+  mm->writeValue(p1, Value::Number(1));
+  mm->writeValue(p1 + 1, Value::Pointer(p3));
+  mm->writeValue(p2, Value::Number(2));
+  mm->writeValue(p3, Value::Number(3));
+  mm->writeValue(p3 + 1, Value::Pointer(p5));
+  mm->writeValue(p4, Value::Number(4));
+  mm->writeValue(p5, Value::Pointer(p1));
+
+  auto stats = mm->collect();
+  EXPECT_EQ(stats->total, 5);
+  EXPECT_EQ(stats->alive, 3);
+  EXPECT_EQ(stats->reclaimed, 2);
+  EXPECT_EQ(mm->getObjectCount(), 3);
+
+  // p3 slides to p2, and p5 right after it.
+  auto newP3 = mm->readValue(p1 + 1)->decode();
+  EXPECT_EQ(newP3, p2.toInt());
+  EXPECT_EQ(mm->readValue(newP3)->decode(), 3);
+  EXPECT_EQ(mm->sizeOf(newP3), 8);
+
+  auto newP5 = mm->readValue(newP3 + 4)->decode();
+  EXPECT_EQ(newP5, newP3 + 8 + H);
+  EXPECT_EQ(mm->readValue(newP5)->decode(), p1.toInt());
+
+  // Headers are reset for the next cycle.
+  EXPECT_EQ(mm->getHeader(newP3)->mark, 0);
+  EXPECT_EQ(mm->getHeader(newP3)->used, 1);
+
+  // One free block after the frontier.
+  EXPECT_EQ(mm->allocate(12 * H - 16 - M), newP5 + M + H);
+
+  // The next cycle keeps everything alive.
+  stats = mm->collect();
+  EXPECT_EQ(stats->alive, 3);
+  EXPECT_EQ(stats->reclaimed, 1);
+  EXPECT_EQ(mm->readValue(mm->readValue(p1 + 1)->decode())->decode(), 3);
+}
+
+TEST(MarkCompactGC, bumpAllocation) {
+  auto mm =
+      MemoryManager::create<BumpPointerAllocator, MarkCompactGC, 16 * H>();
+  auto allocator = std::static_pointer_cast<BumpPointerAllocator>(mm->allocator);
+  constexpr uint32_t objects = 16 * H / (H + 4);
+
+  auto p1 = mm->allocate(4);
+
+  // Garbage until OOM.
+  while (!mm->allocate(4).isNullPointer()) {
+  }
+  EXPECT_EQ(mm->getObjectCount(), objects);
+
+  auto p2 = mm->allocate(4);
+  EXPECT_TRUE(p2.isNullPointer());
+
+  mm->writeValue(p1, Value::Number(10));
+
+  auto stats = mm->collect();
+  EXPECT_EQ(stats->alive, 1);
+  EXPECT_EQ(stats->reclaimed, objects - 1);
+
+  // The cursor is reset to the compaction frontier.
+  EXPECT_EQ(allocator->getCursor(), H + 4);
+  EXPECT_EQ(mm->allocate(4), 2 * H + 4);
+  EXPECT_EQ(mm->readValue(p1)->decode(), 10);
+}
+
+TEST(MarkCompactGC, markBitmap) {
+  auto mm =
+      MemoryManager::create<SingleFreeListAllocator, MarkCompactGC, 16 * H>();
+  mm->collector->markBitmap = std::make_shared<MarkBitmap>(mm->heap);
+
+  // Root -> p3, p2 and p4 are garbage.
+  auto p1 = mm->allocate(4);
+  mm->allocate(8);
+  auto p3 = mm->allocate(4);
+  mm->allocate(4);
+
+  mm->writeValue(p1, Value::Pointer(p3));
+  mm->writeValue(p3, Value::Number(3));
+
+  auto stats = mm->collect();
+  EXPECT_EQ(stats->alive, 2);
+  EXPECT_EQ(stats->reclaimed, 2);
+  EXPECT_EQ(mm->getObjectCount(), 2);
+
+  // p3 slides right after the root.
+  constexpr Word newP3 = 2 * H + M;
+  EXPECT_EQ(mm->readValue(p1)->decode(), newP3);
+  EXPECT_EQ(mm->readValue(newP3)->decode(), 3);
+  EXPECT_FALSE(mm->collector->markBitmap->isMarked(newP3));
+
+  stats = mm->collect();
+  EXPECT_EQ(stats->alive, 2);
+  EXPECT_EQ(stats->reclaimed, 0);
+}
+
+TEST(MarkCompactGC, parallelMark) {
+  auto mm = MemoryManager::create<BumpPointerAllocator, MarkCompactGC, 1024>();
+  mm->collector->markThreads = 3;
+
+  // Root -> p1 -> ... -> p10, interleaved with the garbage.
+  auto prev = mm->allocate(4);
+
+  for (auto i = 0; i < 10; i++) {
+    mm->allocate(4);
+    auto p = mm->allocate(4);
+    mm->writeValue(p, Value::Number(i));
+    mm->writeValue(prev, Value::Pointer(p));
+    prev = p;
+  }
+
+  auto stats = mm->collect();
+  EXPECT_EQ(stats->alive, 11);
+  EXPECT_EQ(stats->reclaimed, 10);
+
+  // The list is compacted.
+  auto p = mm->readValue(H)->decode();
+  for (auto i = 0; i < 9; i++) {
+    EXPECT_EQ(p, 2 * H + 4 + (H + 4) * i);
+    p = mm->readValue(p)->decode();
+  }
+  EXPECT_EQ(mm->readValue(p)->decode(), 9);
+}
+
+#ifdef MMGC_LARGE_HEAP
+
+TEST(MarkCompactGC, largeObjects) {
+  auto mm = MemoryManager::create<BumpPointerAllocator, MarkCompactGC,
+                                  1 << 20>();
+
+  // Root -> p2, p1 is garbage.
+  auto root = mm->allocate(4);
+  auto p1 = mm->allocate(500000);
+  auto p2 = mm->allocate(500000);
+
+  mm->writeValue(root, Value::Pointer(p2));
+  mm->writeValue(p2, Value::Number(2));
+
+  EXPECT_TRUE(mm->allocate(100000).isNullPointer());
+
+  auto stats = mm->collect();
+  EXPECT_EQ(stats->alive, 2);
+  EXPECT_EQ(stats->reclaimed, 1);
+
+  // p2 slides to p1.
+  EXPECT_EQ(mm->readValue(root)->decode(), p1.toInt());
+  EXPECT_EQ(mm->readValue(p1)->decode(), 2);
+  EXPECT_EQ(mm->sizeOf(p1), 500000);
+
+  EXPECT_FALSE(mm->allocate(500000).isNullPointer());
+}
+
+#endif
+
+}  // namespace
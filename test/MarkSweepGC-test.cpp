@@ -13,7 +13,12 @@
 
 namespace {
 
-static auto heap = std::make_shared<Heap>(32);
+/**
+ * Header size (the heap fits four smallest blocks in both layouts).
+ */
+constexpr Word H = sizeof(ObjectHeader);
+
+static auto heap = std::make_shared<Heap>(8 * H);
 static auto allocator = std::make_shared<SingleFreeListAllocator>(heap);
 static MarkSweepGC msgc(allocator);
 
@@ -24,7 +29,7 @@ void reset() {
 
 
 TEST(MarkSweepGC, API) {
-  EXPECT_EQ(msgc.allocator->heap->size(), 32);
+  EXPECT_EQ(msgc.allocator->heap->size(), 8 * H);
 }
 
 TEST(MarkSweepGC, collect) {
@@ -51,4 +56,423 @@ TEST(MarkSweepGC, collect) {
   EXPECT_EQ(msgc.stats->total, 2);
 }
 
+TEST(MarkSweepGC, markBitmap) {
+  auto mm = MemoryManager::create<SingleFreeListAllocator, MarkSweepGC, 64>();
+  mm->collector->markBitmap = std::make_shared<MarkBitmap>(mm->heap);
+
+  // Root -> p2, p1 is garbage.
+  auto root = mm->allocate(4);
+  auto p1 = mm->allocate(4);
+  auto p2 = mm->allocate(4);
+
+  mm->writeValue(root, Value::Pointer(p2));
+
+  auto stats = mm->collect();
+  EXPECT_EQ(stats->alive, 2);
+  EXPECT_EQ(stats->reclaimed, 1);
+
+  // The headers are not written, and the marks are cleared.
+  EXPECT_EQ(mm->getHeader(p2)->mark, 0);
+  EXPECT_FALSE(mm->collector->markBitmap->isMarked(p2));
+  EXPECT_EQ(mm->getHeader(p1)->used, 0);
+
+  stats = mm->collect();
+  EXPECT_EQ(stats->alive, 2);
+  EXPECT_EQ(stats->reclaimed, 0);
+}
+
+TEST(MarkSweepGC, lazySweep) {
+  auto mm = MemoryManager::create<SingleFreeListAllocator, MarkSweepGC, 1024>();
+  std::static_pointer_cast<MarkSweepGC>(mm->collector)->lazySweep = true;
+
+  // Root -> p1, the rest is garbage.
+  auto root = mm->allocate(4);
+  auto p1 = mm->allocate(4);
+  mm->writeValue(root, Value::Pointer(p1));
+  mm->writeValue(p1, Value::Number(1));
+
+  uint32_t garbage = 0;
+  while (!mm->allocate(4).isNullPointer()) {
+    garbage++;
+  }
+
+  // Only marking: the reclaimed objects are reported, but not swept yet.
+  auto stats = mm->collect();
+  EXPECT_EQ(stats->alive, 2);
+  EXPECT_EQ(stats->reclaimed, garbage);
+  EXPECT_EQ(mm->getObjectCount(), garbage + 2);
+  EXPECT_TRUE(mm->collector->sweepPending);
+
+  // The allocation sweeps the first region.
+  auto p2 = mm->allocate(4);
+  EXPECT_FALSE(p2.isNullPointer());
+  EXPECT_LT(p2.toInt(), MarkSweepGC::SWEEP_REGION_SIZE);
+  EXPECT_TRUE(mm->collector->sweepPending);
+
+  // The leftover is swept before the next cycle.
+  stats = mm->collect();
+  EXPECT_EQ(stats->total, 3);
+  EXPECT_EQ(stats->alive, 2);
+  EXPECT_EQ(stats->reclaimed, 1);
+}
+
+TEST(MarkSweepGC, lazySweepAllocateBlack) {
+  auto mm = MemoryManager::create<SingleFreeListAllocator, MarkSweepGC, 1024>();
+  std::static_pointer_cast<MarkSweepGC>(mm->collector)->lazySweep = true;
+
+  auto root = mm->allocate(4);
+  mm->writeValue(root, Value::Number(0));
+
+  Value last = Value::Pointer(nullptr);
+  for (auto p = mm->allocate(4); !p.isNullPointer(); p = mm->allocate(4)) {
+    last = p;
+  }
+
+  // A free block in the end of the heap.
+  mm->free(last);
+  mm->collect();
+
+  // It's reused before the sweep reaches it.
+  auto p1 = mm->allocate(4);
+  EXPECT_EQ(p1, last.toInt());
+  mm->writeValue(root, Value::Pointer(p1));
+  mm->writeValue(p1, Value::Number(1));
+
+  // The new object survives the rest of the sweep.
+  auto stats = mm->collect();
+  EXPECT_EQ(stats->total, 2);
+  EXPECT_EQ(stats->alive, 2);
+  EXPECT_EQ(stats->reclaimed, 0);
+  EXPECT_EQ(mm->getHeader(p1)->used, 1);
+}
+
+TEST(MarkSweepGC, parallelMark) {
+  for (auto useBitmap : {false, true}) {
+    auto mm = MemoryManager::create<SingleFreeListAllocator, MarkSweepGC,
+                                    4096>();
+    mm->collector->markThreads = 4;
+
+    if (useBitmap) {
+      mm->collector->markBitmap =
+          std::make_shared<MarkBitmap>(mm->heap);
+    }
+
+    // A list of the objects with 2 pointers: to the next object,
+    // and to a shared one; every third object is garbage.
+    auto shared = Value::Pointer(nullptr);
+    auto prev = mm->allocate(8);
+    uint32_t alive = 1;
+    uint32_t garbage = 0;
+
+    for (auto i = 0; i < 150; i++) {
+      auto p = mm->allocate(8);
+      mm->writeValue(p, Value::Pointer(nullptr));
+      mm->writeValue(p + 1, Value::Number(i));
+
+      if (i % 3 == 2) {
+        garbage++;
+        continue;
+      }
+
+      if (shared.isNullPointer()) {
+        shared = p;
+      }
+
+      mm->writeValue(prev, Value::Pointer(p));
+      mm->writeValue(prev + 1, Value::Pointer(shared));
+      prev = p;
+      alive++;
+    }
+
+    auto stats = mm->collect();
+    EXPECT_EQ(stats->alive, alive);
+    EXPECT_EQ(stats->reclaimed, garbage);
+    EXPECT_EQ(mm->getObjectCount(), alive);
+
+    // The marks are reset for the next cycle.
+    stats = mm->collect();
+    EXPECT_EQ(stats->alive, alive);
+    EXPECT_EQ(stats->reclaimed, 0);
+  }
+}
+
+TEST(MarkSweepGC, concurrentMarkAllocate) {
+  auto mm = MemoryManager::create<SingleFreeListAllocator, MarkSweepGC, 256>();
+  auto gc = std::static_pointer_cast<MarkSweepGC>(mm->collector);
+  gc->concurrentMark = true;
+
+  auto root = mm->allocate(8);
+  mm->writeValue(root, Value::Number(0));
+  mm->writeValue(root + 1, Value::Number(0));
+
+  // Two separate free blocks, their payloads hold the free list links;
+  // p2, and p4 are garbage.
+  std::vector<Value> objects;
+  for (auto i = 0; i < 4; i++) {
+    auto p = mm->allocate(8);
+    mm->writeValue(p, Value::Number(0));
+    mm->writeValue(p + 1, Value::Number(0));
+    objects.push_back(p);
+  }
+  mm->free(objects[0]);
+  mm->free(objects[2]);
+
+  mm->collect();
+
+  // The payload of the new object is cleared, so the SATB barrier
+  // doesn't record a stale free list link as the overwritten pointer.
+  auto p1 = mm->allocate(8);
+  EXPECT_EQ(mm->readWord(p1), 0);
+  EXPECT_EQ(mm->readWord(p1 + 1), 0);
+  mm->writeValue(p1, Value::Number(1));
+
+  auto stats = gc->finishMark();
+  EXPECT_EQ(stats->alive, 2);
+  EXPECT_EQ(stats->reclaimed, 2);
+  EXPECT_EQ(mm->getObjectCount(), 2);
+}
+
+TEST(MarkSweepGC, parallelSweep) {
+  for (auto useBitmap : {false, true}) {
+    auto mm = MemoryManager::create<SingleFreeListAllocator, MarkSweepGC,
+                                    4096>();
+    auto gc = std::static_pointer_cast<MarkSweepGC>(mm->collector);
+    gc->sweepThreads = 3;
+
+    if (useBitmap) {
+      gc->markBitmap = std::make_shared<MarkBitmap>(mm->heap);
+    }
+
+    // A list of the objects, which fills the heap (all the sweep
+    // chunks); the runs of the garbage objects are of different length.
+    auto root = mm->allocate(8);
+    mm->writeValue(root + 1, Value::Number(0));
+    auto prev = root;
+    uint32_t alive = 1;
+    uint32_t garbage = 0;
+
+    for (auto i = 0;; i++) {
+      auto p = mm->allocate(8);
+      if (p.isNullPointer()) {
+        break;
+      }
+      mm->writeValue(p, Value::Pointer(nullptr));
+      mm->writeValue(p + 1, Value::Number(i));
+
+      if (i % 7 < 3 || i % 11 == 0) {
+        garbage++;
+        continue;
+      }
+
+      mm->writeValue(prev, Value::Pointer(p));
+      prev = p;
+      alive++;
+    }
+
+    auto stats = mm->collect();
+    EXPECT_EQ(stats->alive, alive);
+    EXPECT_EQ(stats->reclaimed, garbage);
+    EXPECT_EQ(mm->getObjectCount(), alive);
+    EXPECT_GE(mm->allocator->getFreeSize(), garbage * 8);
+
+    // The free blocks are coalesced, and all the reclaimed
+    // space is reused.
+    auto p1 = mm->allocate(16);
+    EXPECT_FALSE(p1.isNullPointer());
+    mm->writeValue(p1, Value::Number(1));
+    mm->writeValue(p1 + 1, Value::Number(1));
+
+    uint32_t allocated = 1;
+    while (true) {
+      auto p = mm->allocate(8);
+      if (p.isNullPointer()) {
+        break;
+      }
+      mm->writeValue(p, Value::Number(0));
+      mm->writeValue(p + 1, Value::Number(0));
+      allocated++;
+    }
+    EXPECT_GE(allocated, garbage - 1);
+
+    // The marks are reset, and the new objects are reclaimed.
+    stats = mm->collect();
+    EXPECT_EQ(stats->alive, alive);
+    EXPECT_EQ(stats->reclaimed, allocated);
+    EXPECT_EQ(mm->getObjectCount(), alive);
+
+    // Freeing the rest of the objects, the whole heap is coalesced
+    // back into the large blocks.
+    mm->writeValue(root, Value::Number(0));
+    stats = mm->collect();
+    EXPECT_EQ(stats->reclaimed, alive - 1);
+    EXPECT_FALSE(mm->allocate(200).isNullPointer());
+  }
+}
+
+TEST(MarkSweepGC, concurrentMark) {
+  for (auto useBitmap : {false, true}) {
+    auto mm = MemoryManager::create<SingleFreeListAllocator, MarkSweepGC,
+                                    1024>();
+    auto gc = std::static_pointer_cast<MarkSweepGC>(mm->collector);
+    gc->concurrentMark = true;
+
+    if (useBitmap) {
+      gc->markBitmap = std::make_shared<MarkBitmap>(mm->heap);
+    }
+
+    // Root -> p1 -> p2 -> p3, p4 is garbage.
+    auto root = mm->allocate(8);
+    auto p1 = mm->allocate(8);
+    auto p2 = mm->allocate(8);
+    auto p3 = mm->allocate(8);
+    auto p4 = mm->allocate(8);
+
+    for (auto p : {root, p1, p2, p3, p4}) {
+      mm->writeValue(p, Value::Number(0));
+      mm->writeValue(p + 1, Value::Number(0));
+    }
+
+    mm->writeValue(root, Value::Pointer(p1));
+    mm->writeValue(p1, Value::Pointer(p2));
+    mm->writeValue(p2, Value::Pointer(p3));
+
+    // The marking runs in the background.
+    auto stats = mm->collect();
+    EXPECT_TRUE(mm->collector->markPending);
+
+    // The mutator moves p2 to the root (possibly already scanned), and
+    // removes it from p1. The SATB barrier records the old pointer.
+    mm->writeValue(root + 1, Value::Pointer(p2));
+    mm->writeValue(p1, Value::Number(1));
+
+    // A new object is alive in this cycle.
+    auto p5 = mm->allocate(8);
+    mm->writeValue(p5, Value::Number(5));
+    mm->writeValue(p5 + 1, Value::Number(5));
+
+    stats = gc->finishMark();
+    EXPECT_FALSE(mm->collector->markPending);
+    EXPECT_EQ(stats->total, 6);
+    EXPECT_EQ(stats->alive, 5);
+    EXPECT_EQ(stats->reclaimed, 1);
+    EXPECT_EQ(mm->getObjectCount(), 5);
+
+    // Next cycle: the unreachable p5 is reclaimed.
+    mm->collect();
+    stats = gc->finishMark();
+    EXPECT_EQ(stats->alive, 4);
+    EXPECT_EQ(stats->reclaimed, 1);
+    EXPECT_EQ(mm->readValue(root + 1)->decode(), p2.toInt());
+    EXPECT_EQ(mm->readValue(p2)->decode(), p3.toInt());
+  }
+}
+
+TEST(MarkSweepGC, concurrentMarkOOM) {
+  auto mm = MemoryManager::create<SingleFreeListAllocator, MarkSweepGC, 1024>();
+  auto gc = std::static_pointer_cast<MarkSweepGC>(mm->collector);
+  gc->concurrentMark = true;
+
+  auto root = mm->allocate(4);
+  mm->writeValue(root, Value::Number(0));
+
+  while (true) {
+    auto p = mm->allocate(4);
+    if (p.isNullPointer()) {
+      break;
+    }
+    mm->writeValue(p, Value::Number(1));
+  }
+
+  // Running out of memory finishes the cycle, and sweeps the heap.
+  mm->collect();
+  EXPECT_FALSE(mm->allocate(4).isNullPointer());
+  EXPECT_FALSE(mm->collector->markPending);
+  EXPECT_EQ(mm->getObjectCount(), 2);
+}
+
+TEST(MarkSweepGC, collectStep) {
+  auto mm = MemoryManager::create<SingleFreeListAllocator, MarkSweepGC, 1024>();
+
+  // Root -> p1 -> p2 -> p3 -> p4, p5 is garbage.
+  auto root = mm->allocate(8);
+  std::vector<Value> objects;
+
+  for (auto i = 0; i < 5; i++) {
+    auto p = mm->allocate(8);
+    mm->writeValue(p, Value::Number(0));
+    mm->writeValue(p + 1, Value::Number(i));
+    objects.push_back(p);
+  }
+
+  mm->writeValue(root, Value::Pointer(objects[0]));
+  mm->writeValue(root + 1, Value::Number(0));
+
+  for (auto i = 0; i < 3; i++) {
+    mm->writeValue(objects[i], Value::Pointer(objects[i + 1]));
+  }
+
+  // Each step scans one object: the root, and p1 are black,
+  // p2 is grey, the rest are white.
+  EXPECT_TRUE(mm->collectStep(1));
+  EXPECT_TRUE(mm->collectStep(1));
+  EXPECT_TRUE(mm->collector->markPending);
+
+  // The mutator moves p4 to the black root, and removes it from p3.
+  // The write barrier shades p4.
+  mm->writeValue(root + 1, Value::Pointer(objects[3]));
+  mm->writeValue(objects[2], Value::Number(3));
+
+  // A new object is alive in this cycle.
+  auto p6 = mm->allocate(8);
+  mm->writeValue(p6, Value::Number(6));
+  mm->writeValue(p6 + 1, Value::Number(6));
+
+  while (mm->collectStep(1)) {
+  }
+
+  auto stats = mm->collector->stats;
+  EXPECT_FALSE(mm->collector->markPending);
+  EXPECT_EQ(stats->total, 7);
+  EXPECT_EQ(stats->alive, 6);
+  EXPECT_EQ(stats->reclaimed, 1);
+  EXPECT_EQ(mm->getObjectCount(), 6);
+  EXPECT_EQ(mm->readValue(root + 1)->decode(), objects[3].toInt());
+
+  // The next cycle reclaims p6, in one step with a large budget.
+  EXPECT_FALSE(mm->collectStep(100));
+  EXPECT_EQ(stats->alive, 5);
+  EXPECT_EQ(stats->reclaimed, 1);
+}
+
+#ifdef MMGC_LARGE_HEAP
+
+TEST(MarkSweepGC, largeObjects) {
+  auto mm = MemoryManager::create<SingleFreeListAllocator, MarkSweepGC,
+                                  1 << 20>();
+
+  // Root -> p2, p1 and p3 are garbage.
+  auto root = mm->allocate(4);
+  auto p1 = mm->allocate(100000);
+  auto p2 = mm->allocate(100000);
+  auto p3 = mm->allocate(100000);
+
+  EXPECT_FALSE(p1.isNullPointer());
+  EXPECT_EQ(mm->sizeOf(p2), 100000);
+  EXPECT_FALSE(p3.isNullPointer());
+
+  mm->writeValue(root, Value::Pointer(p2));
+  mm->writeValue(p2, Value::Number(2));
+
+  auto stats = mm->collect();
+  EXPECT_EQ(stats->alive, 2);
+  EXPECT_EQ(stats->reclaimed, 2);
+
+  // The reclaimed objects are coalesced with the free space.
+  EXPECT_EQ(mm->allocate(600000), p3.toInt());
+  EXPECT_FALSE(mm->allocate(100000).isNullPointer());
+  EXPECT_EQ(mm->readValue(p2)->decode(), 2);
+}
+
+#endif
+
 }  // namespace
@@ -4,30 +4,45 @@
  */
 
 #include "MemoryManager.h"
+#include "BumpPointerAllocator.h"
+#include "GenerationalGC.h"
+#include "MarkCompactGC.h"
 #include "MarkSweepGC.h"
+#include "ObjectHeader.h"
 #include "SingleFreeListAllocator.h"
 #include "Value.h"
 #include "gtest/gtest.h"
 
 namespace {
 
+/**
+ * Header size, and the smallest block size, which stores two free
+ * list links (the expected addresses follow the header layout).
+ */
+constexpr Word H = sizeof(ObjectHeader);
+constexpr Word M = SingleFreeListAllocator::MIN_BLOCK_SIZE;
+
 static auto mm =
-    MemoryManager::create<SingleFreeListAllocator, MarkSweepGC, 32>();
+    MemoryManager::create<SingleFreeListAllocator, MarkSweepGC, 8 * H>();
 
 TEST(MemoryManager, API) {
-  EXPECT_EQ(mm->getHeapSize(), 32);
+  EXPECT_EQ(mm->getHeapSize(), 8 * H);
   EXPECT_EQ(mm->getWordSize(), 4);
-  EXPECT_EQ(mm->getWordsCount(), 8);
+  EXPECT_EQ(mm->getWordsCount(), 2 * H);
 }
 
 TEST(MemoryManager, reset) {
   mm->reset();
 
-  // Firt object header.
+  // Firt object header: one free block.
+#ifndef MMGC_LARGE_HEAP
   EXPECT_EQ(mm->readWord(0), 0x001C0000);
+#endif
+  EXPECT_EQ(mm->getHeader(H)->size, 7 * H);
+  EXPECT_EQ(mm->getHeader(H)->used, 0);
 
   // All other heap elements are reset.
-  for (size_t i = 4; i < 32; i += 4) {
+  for (size_t i = H; i < 8 * H; i += 4) {
     EXPECT_EQ(mm->readWord(i), 0x0);
   }
 }
@@ -102,18 +117,17 @@ TEST(MemoryManager, allocate) {
 
   auto p1 = mm->allocate(3);
   EXPECT_EQ(p1.isPointer(), true);
-  // 0-3 - header, 4 - payload:
-  EXPECT_EQ(p1, 4);
+  // Header, and then the payload:
+  EXPECT_EQ(p1, H);
 
-  // 3 is aligned to 4:
-  EXPECT_EQ(mm->getHeader(p1)->size, 4);
+  // 3 is aligned to 4 (and to the smallest block):
+  EXPECT_EQ(mm->getHeader(p1)->size, M);
 
   mm->writeWord(p1, 100);
   EXPECT_EQ(mm->readWord(p1), 100);
 
   auto p2 = mm->allocate(5);
-  // 8-11 - header, 12 - payload:
-  EXPECT_EQ(p2, 12);
+  EXPECT_EQ(p2, 2 * H + M);
 
   // 5 is aligned to 8:
   EXPECT_EQ(mm->getHeader(p2)->size, 8);
@@ -122,28 +136,35 @@ TEST(MemoryManager, allocate) {
 TEST(MemoryManager, sizeOf) {
   mm->reset();
 
-  EXPECT_EQ(mm->sizeOf(mm->allocate(9)), 12);
-  EXPECT_EQ(mm->sizeOf(mm->allocate(1)), 4);
-  EXPECT_EQ(mm->sizeOf(mm->allocate(4)), 4);
+  // Each object is split from the whole free heap.
+  auto p1 = mm->allocate(9);
+  EXPECT_EQ(mm->sizeOf(p1), 12);
+  mm->free(p1);
+
+  auto p2 = mm->allocate(1);
+  EXPECT_EQ(mm->sizeOf(p2), M);
+  mm->free(p2);
+
+  EXPECT_EQ(mm->sizeOf(mm->allocate(4)), M);
 }
 
 TEST(MemoryManager, free) {
   mm->reset();
 
   auto p1 = mm->allocate(4);
-  EXPECT_EQ(p1, 4);
+  EXPECT_EQ(p1, H);
 
   auto p2 = mm->allocate(4);
-  EXPECT_EQ(p2, 12);
+  EXPECT_EQ(p2, 2 * H + M);
 
-  // Free p1, alloc p3, still bump (alloc at 20)
+  // Free p1, alloc p3, still bump (alloc after p2)
   mm->free(p1);
   auto p3 = mm->allocate(12);
-  EXPECT_EQ(p3, 20);
+  EXPECT_EQ(p3, 3 * H + 2 * M);
 
-  // Alloc p4 at 4 (from freed p 1)
+  // Alloc p4 at H (from freed p 1)
   auto p4 = mm->allocate(2);
-  EXPECT_EQ(p4, 4);
+  EXPECT_EQ(p4, H);
 }
 
 TEST(MemoryManager, getPointers) {
@@ -162,6 +183,31 @@ TEST(MemoryManager, getPointers) {
   EXPECT_EQ(p1Pointers[1]->decode(), 24);
 }
 
+TEST(MemoryManager, forEachPointer) {
+  mm->reset();
+
+  auto p1 = mm->allocate(16);
+  mm->writeValue(p1, Value::Pointer(20));
+  mm->writeValue(p1 + 1, Value::Number(1));
+  mm->writeValue(p1 + 2, Value::Pointer(24));
+  mm->writeValue(p1 + 3, Value::Pointer(nullptr));
+
+  std::vector<Word> visited;
+  mm->allocator->forEachPointer(
+      p1, [&](Value* p) { visited.push_back(p->decode()); });
+
+  EXPECT_EQ(visited.size(), 2);
+  EXPECT_EQ(visited[0], 20);
+  EXPECT_EQ(visited[1], 24);
+
+  // The slots are visited in place, so they can be updated.
+  mm->allocator->forEachPointer(p1,
+                                [&](Value* p) { *p = Value::Pointer(28); });
+
+  EXPECT_EQ(mm->readValue(p1)->decode(), 28);
+  EXPECT_EQ(mm->readValue(p1 + 2)->decode(), 28);
+}
+
 TEST(MemoryManager, getObjectCount) {
   mm->reset();
 
@@ -200,6 +246,177 @@ TEST(MemoryManager, writeBarrier) {
 
   EXPECT_EQ(_address, 4);
   EXPECT_EQ(_value, 8);
+
+  // A raw word store goes through the barrier as well.
+  mm->writeWord(12, Value::Pointer(16));
+
+  EXPECT_EQ(_address, 12);
+  EXPECT_EQ(_value, 16);
+}
+
+/**
+ * Allocates a list of 8-byte objects from the root, until the heap
+ * is full. Returns the last object.
+ */
+template <class MM>
+Value fillList(MM& mm, Value last) {
+  while (true) {
+    auto object = mm->allocate(8);
+    if (object.isNullPointer()) {
+      return last;
+    }
+    mm->writeValue(object, Value::Number(0));
+    mm->writeValue(object + 1, Value::Number(0));
+    if (!last.isNullPointer()) {
+      mm->writeValue(last, Value::Pointer(object));
+    }
+    last = object;
+  }
+}
+
+TEST(MemoryManager, elasticHeap) {
+  auto mm = MemoryManager::create<SingleFreeListAllocator, MarkSweepGC, 256,
+                                  0, 1024>();
+  EXPECT_EQ(mm->heap->limit(), 1024);
+
+  // The full heap grows by a chunk after the collection.
+  auto last = fillList(mm, Value::Pointer(nullptr));
+  mm->collect();
+  EXPECT_EQ(mm->getHeapSize(), 512);
+
+  // The list continues in the grown space.
+  auto next = mm->allocate(8);
+  EXPECT_GE(next.decode(), 256);
+  mm->writeValue(next, Value::Number(0));
+  mm->writeValue(next + 1, Value::Number(0));
+  mm->writeValue(last, Value::Pointer(next));
+  fillList(mm, next);
+
+  auto objects = mm->getObjectCount();
+  auto stats = mm->collect();
+  EXPECT_EQ(stats->alive, objects);
+  EXPECT_EQ(mm->getHeapSize(), 768);
+
+  // Only the root is alive: the heap shrinks after `shrinkDelay`
+  // collections with the low occupancy.
+  Word root = sizeof(ObjectHeader);
+  mm->writeValue(root, Value::Number(0));
+
+  for (uint32_t i = 1; i < mm->shrinkDelay; i++) {
+    mm->collect();
+    EXPECT_EQ(mm->getHeapSize(), 768);
+  }
+  mm->collect();
+  EXPECT_EQ(mm->getHeapSize(), 512);
+
+  // Down to the initial chunk, and not below.
+  for (uint32_t i = 0; i < 2 * mm->shrinkDelay; i++) {
+    mm->collect();
+  }
+  EXPECT_EQ(mm->getHeapSize(), 256);
+  EXPECT_EQ(mm->getObjectCount(), 1);
+
+  // The released space reads as zeros.
+  EXPECT_EQ(*mm->heap->asWordPointer(512), 0);
+
+  // The shrunk heap is still usable to its end.
+  fillList(mm, Value::Pointer(root));
+  EXPECT_GT(mm->getObjectCount(), 1);
+  EXPECT_TRUE(mm->allocate(8).isNullPointer());
+
+  mm->reset();
+  EXPECT_EQ(mm->getHeapSize(), 256);
+}
+
+TEST(MemoryManager, elasticHeapCompact) {
+  auto mm = MemoryManager::create<BumpPointerAllocator, MarkCompactGC, 128,
+                                  0, 256>();
+
+  auto last = fillList(mm, Value::Pointer(nullptr));
+  auto objects = mm->getObjectCount();
+
+  auto stats = mm->collect();
+  EXPECT_EQ(stats->alive, objects);
+  EXPECT_EQ(mm->getHeapSize(), 256);
+
+  // Allocation continues from the frontier to the new end.
+  auto next = mm->allocate(8);
+  EXPECT_GT(next.decode() + 8, 128);
+  mm->writeValue(last, Value::Pointer(next));
+  fillList(mm, next);
+  EXPECT_GT(mm->getObjectCount(), objects + 1);
+
+  // Up to the limit.
+  mm->collect();
+  EXPECT_EQ(mm->getHeapSize(), 256);
+}
+
+TEST(MemoryManager, allocationRetries) {
+  auto mm = MemoryManager::create<SingleFreeListAllocator, MarkSweepGC, 256>();
+
+  auto root = mm->allocate(8);
+  mm->writeValue(root, Value::Number(0));
+  mm->writeValue(root + 1, Value::Number(0));
+  fillList(mm, root);
+
+  // The list is garbage, but there is no collection by default.
+  mm->writeValue(root, Value::Number(0));
+  EXPECT_TRUE(mm->allocate(8).isNullPointer());
+
+  // The failed allocation collects, and retries.
+  mm->allocationRetries = 1;
+  EXPECT_FALSE(mm->allocate(8).isNullPointer());
+  EXPECT_EQ(mm->getObjectCount(), 2);
+}
+
+TEST(MemoryManager, onOutOfMemory) {
+  auto mm = MemoryManager::create<SingleFreeListAllocator, MarkSweepGC, 256>();
+  uint32_t requested = 0;
+
+  mm->allocationRetries = 2;
+  mm->onOutOfMemory = [&](uint32_t n) { requested = n; };
+
+  // All objects are reachable: the retries don't help.
+  fillList(mm, Value::Pointer(nullptr));
+  EXPECT_EQ(requested, 8);
+  EXPECT_EQ(mm->collector->stats->reclaimed, 0);
+}
+
+TEST(MemoryManager, allocationThreshold) {
+  auto mm = MemoryManager::create<SingleFreeListAllocator, MarkSweepGC, 256>();
+
+  auto root = mm->allocate(8);
+  mm->writeValue(root, Value::Number(0));
+  mm->writeValue(root + 1, Value::Number(0));
+
+  // The garbage is collected each 64 bytes, so the heap never fills.
+  mm->allocationThreshold = 64;
+
+  for (auto i = 0; i < 100; i++) {
+    EXPECT_FALSE(mm->allocate(8).isNullPointer());
+  }
+  EXPECT_LE(mm->getObjectCount(), 1 + 64 / 8 + 1);
+}
+
+TEST(MemoryManager, collectFull) {
+  auto mm =
+      MemoryManager::create<SingleFreeListAllocator, GenerationalGC, 1024>();
+
+  // Root -> p1, both promoted to the old space.
+  auto root = mm->allocate(8);
+  auto p1 = mm->allocate(8);
+  mm->writeValue(root, Value::Pointer(p1));
+  mm->writeValue(root + 1, Value::Number(0));
+  mm->writeValue(p1, Value::Number(1));
+  mm->writeValue(p1 + 1, Value::Number(1));
+  mm->collect();
+
+  // The old p1 is garbage: only the full collection reclaims it.
+  Word oldRoot = sizeof(ObjectHeader);
+  mm->writeValue(oldRoot, Value::Number(0));
+
+  EXPECT_EQ(mm->collect()->reclaimed, 0);
+  EXPECT_EQ(mm->collectFull()->reclaimed, 1);
 }
 
-}  // namespace
\ No newline at end of file
+}  // namespace
@@ -8,6 +8,8 @@
 
 namespace {
 
+#ifndef MMGC_LARGE_HEAP
+
 TEST(Header, MarkSweep) {
   ObjectHeader header = {
       .size = 0xA,
@@ -47,4 +49,42 @@ TEST(Header, ReferenceCounting) {
   EXPECT_EQ(header.toInt(), 0x0BFF0000);
 }
 
+TEST(Header, Forward) {
+  ObjectHeader header = {};
+
+  // The forwarding address is stored in words: 14 bits address 64 KiB.
+  EXPECT_EQ(ObjectHeader::MAX_HEAP_SIZE, 64 * 1024);
+
+  header.setForward(ObjectHeader::MAX_HEAP_SIZE - 4);
+  EXPECT_EQ(header.getForward(), ObjectHeader::MAX_HEAP_SIZE - 4);
+  EXPECT_EQ(header.toInt(), 0x00003FFF);
+
+  header.setForward(20);
+  EXPECT_EQ(header.forward, 5);
+  EXPECT_EQ(header.getForward(), 20);
+}
+
+#else
+
+TEST(Header, LargeHeap) {
+  ObjectHeader header = {
+      .size = 0xA,
+      .mark = true,
+  };
+
+  EXPECT_EQ(sizeof(ObjectHeader), 8);
+  EXPECT_EQ(header.toInt(), 0x0100000A00000000);
+
+  header.size = ObjectHeader::MAX_SIZE;
+  header.forward = (1u << ObjectHeader::FORWARD_BITS) - 1;
+  EXPECT_EQ(header.size, 0xFFFFFC);
+  EXPECT_EQ(header.toInt(), 0x01FFFFFC3FFFFFFF);
+
+  // The forwarding address is stored in words.
+  header.setForward(ObjectHeader::MAX_HEAP_SIZE - 4);
+  EXPECT_EQ(header.getForward(), ObjectHeader::MAX_HEAP_SIZE - 4);
+}
+
+#endif
+
 }  // namespace
\ No newline at end of file
@@ -0,0 +1,134 @@
+/**
+ * The MIT License (MIT)
+ * Copyright (c) 2018-present Dmitry Soshnikov <dmitry.soshnikov@gmail.com>
+ */
+
+#include "MemoryManager.h"
+#include "RCCollector.h"
+#include "SingleFreeListAllocator.h"
+#include "gtest/gtest.h"
+
+namespace {
+
+TEST(RCCollector, referenceCounting) {
+  auto mm = MemoryManager::create<SingleFreeListAllocator, RCCollector, 256>();
+
+  // Root -> p1 -> p2, p3 is garbage.
+  auto root = mm->allocate(8);
+  auto p1 = mm->allocate(8);
+  auto p2 = mm->allocate(4);
+  auto p3 = mm->allocate(4);
+
+  mm->writeValue(root, Value::Pointer(p1));
+  mm->writeValue(root + 1, Value::Number(0));
+  mm->writeValue(p1, Value::Pointer(p2));
+  mm->writeValue(p1 + 1, Value::Number(1));
+  mm->writeValue(p3, Value::Pointer(p2));
+  mm->writeValue(p3, Value::Number(3));
+
+  auto stats = mm->collect();
+  EXPECT_EQ(stats->total, 4);
+  EXPECT_EQ(stats->alive, 3);
+  EXPECT_EQ(stats->reclaimed, 1);
+
+  // The root references are not counted.
+  EXPECT_EQ(mm->allocator->getHeader(p1)->rc, 0);
+  EXPECT_EQ(mm->allocator->getHeader(p2)->rc, 1);
+
+  // Dropping the last reference frees the object.
+  mm->writeValue(p1, Value::Number(2));
+
+  stats = mm->collect();
+  EXPECT_EQ(stats->reclaimed, 1);
+  EXPECT_EQ(mm->getObjectCount(), 2);
+  EXPECT_EQ(mm->readValue(p1 + 1)->decode(), 1);
+}
+
+TEST(RCCollector, epoch) {
+  auto mm = MemoryManager::create<SingleFreeListAllocator, RCCollector, 256>();
+  auto rc = std::static_pointer_cast<RCCollector>(mm->collector);
+  rc->epochSize = 8;
+
+  auto root = mm->allocate(8);
+  mm->writeValue(root, Value::Number(0));
+
+  // The garbage is reclaimed by the epochs, without collections.
+  for (auto i = 0; i < 1000; i++) {
+    auto p = mm->allocate(8);
+    ASSERT_FALSE(p.isNullPointer());
+    mm->writeValue(p, Value::Number(i));
+    mm->writeValue(root, Value::Pointer(p));
+  }
+
+  EXPECT_LE(mm->getObjectCount(), 10);
+  EXPECT_EQ(mm->readValue(mm->readValue(root)->decode())->decode(), 999);
+}
+
+TEST(RCCollector, cycles) {
+  auto mm = MemoryManager::create<SingleFreeListAllocator, RCCollector, 256>();
+
+  // Root -> a <-> b -> c, root -> d -> d.
+  auto root = mm->allocate(8);
+  auto a = mm->allocate(8);
+  auto b = mm->allocate(8);
+  auto c = mm->allocate(4);
+  auto d = mm->allocate(4);
+
+  mm->writeValue(root, Value::Pointer(a));
+  mm->writeValue(root + 1, Value::Pointer(d));
+  mm->writeValue(a, Value::Pointer(b));
+  mm->writeValue(b, Value::Pointer(a));
+  mm->writeValue(b + 1, Value::Pointer(c));
+  mm->writeValue(d, Value::Pointer(d));
+
+  auto stats = mm->collect();
+  EXPECT_EQ(stats->alive, 5);
+  EXPECT_EQ(stats->reclaimed, 0);
+
+  // The counters of the alive cycle are restored.
+  EXPECT_EQ(mm->allocator->getHeader(a)->rc, 1);
+  EXPECT_EQ(mm->allocator->getHeader(b)->rc, 1);
+
+  // The dropped cycles are reclaimed by the trial deletion.
+  mm->writeValue(root, Value::Number(0));
+  mm->writeValue(root + 1, Value::Number(0));
+
+  stats = mm->collect();
+  EXPECT_EQ(stats->total, 5);
+  EXPECT_EQ(stats->alive, 1);
+  EXPECT_EQ(stats->reclaimed, 4);
+  EXPECT_EQ(mm->getObjectCount(), 1);
+}
+
+TEST(RCCollector, stickyCount) {
+  auto mm =
+      MemoryManager::create<SingleFreeListAllocator, RCCollector, 2048>();
+
+  // Root -> holders, 300 references from the holders to p.
+  auto root = mm->allocate(20);
+  auto p = mm->allocate(4);
+
+  for (auto i = 0; i < 5; i++) {
+    auto holder = mm->allocate(240);
+    mm->writeValue(root + i, Value::Pointer(holder));
+    for (auto j = 0; j < 60; j++) {
+      mm->writeValue(holder + j, Value::Pointer(p));
+    }
+  }
+
+  mm->collect();
+  EXPECT_EQ(mm->allocator->getHeader(p)->rc, RCCollector::STICKY_RC);
+
+  // The holders are freed, and the sticky object is left
+  // to the backup tracing.
+  for (auto i = 0; i < 5; i++) {
+    mm->writeValue(root + i, Value::Number(0));
+  }
+
+  auto stats = mm->collect();
+  EXPECT_EQ(stats->total, 7);
+  EXPECT_EQ(stats->reclaimed, 6);
+  EXPECT_EQ(mm->getObjectCount(), 1);
+}
+
+}  // namespace
@@ -0,0 +1,174 @@
+/**
+ * The MIT License (MIT)
+ * Copyright (c) 2018-present Dmitry Soshnikov <dmitry.soshnikov@gmail.com>
+ */
+
+#include "GenerationalGC.h"
+#include "MarkCompactGC.h"
+#include "MarkSweepGC.h"
+#include "MemoryManager.h"
+#include "RootSet.h"
+#include "SemiSpaceAllocator.h"
+#include "SemiSpaceGC.h"
+#include "SingleFreeListAllocator.h"
+#include "gtest/gtest.h"
+
+namespace {
+
+TEST(RootSet, handleScope) {
+  RootSet roots;
+
+  {
+    HandleScope scope(roots);
+    auto h1 = scope.handle(Value::Pointer(8));
+    scope.handle(Value::Number(1));
+
+    {
+      HandleScope inner(roots);
+      inner.handle(Value::Pointer(16));
+      EXPECT_EQ(roots.height(), 3);
+    }
+
+    EXPECT_EQ(roots.height(), 2);
+    EXPECT_EQ(h1->decode(), 8);
+
+    // Only the pointers are visited.
+    uint32_t slots = 0;
+    roots.forEachSlot([&](Value* slot) { slots++; });
+    EXPECT_EQ(slots, 1);
+  }
+
+  EXPECT_EQ(roots.height(), 0);
+}
+
+TEST(RootSet, markSweep) {
+  auto mm = MemoryManager::create<SingleFreeListAllocator, MarkSweepGC, 64>();
+
+  auto root = mm->allocate(4);
+  auto p1 = mm->allocate(4);
+  auto p2 = mm->allocate(4);
+
+  mm->writeValue(root, Value::Number(0));
+  mm->writeValue(p1, Value::Number(1));
+  mm->writeValue(p2, Value::Number(2));
+
+  {
+    // The handle keeps p1 alive.
+    HandleScope scope(*mm->roots);
+    scope.handle(p1);
+
+    auto stats = mm->collect();
+    EXPECT_EQ(stats->alive, 2);
+    EXPECT_EQ(stats->reclaimed, 1);
+  }
+
+  auto stats = mm->collect();
+  EXPECT_EQ(stats->alive, 1);
+  EXPECT_EQ(stats->reclaimed, 1);
+}
+
+TEST(RootSet, incrementalMark) {
+  auto mm = MemoryManager::create<SingleFreeListAllocator, MarkSweepGC, 64>();
+
+  // Root -> A -> B.
+  auto root = mm->allocate(4);
+  auto a = mm->allocate(4);
+  auto b = mm->allocate(4);
+
+  mm->writeValue(root, Value::Pointer(a));
+  mm->writeValue(a, Value::Pointer(b));
+  mm->writeValue(b, Value::Number(2));
+
+  // The root is black, A is grey.
+  EXPECT_TRUE(mm->collectStep(1));
+
+  {
+    // The mutator moves B from A to a handle (no barrier).
+    HandleScope scope(*mm->roots);
+    auto handle = scope.handle(*mm->readValue(a));
+    mm->writeValue(a, Value::Number(1));
+
+    // The roots are scanned again, before the mark is finished.
+    while (mm->collectStep(1)) {
+    }
+
+    auto stats = mm->collector->stats;
+    EXPECT_EQ(stats->alive, 3);
+    EXPECT_EQ(stats->reclaimed, 0);
+    EXPECT_TRUE(mm->getHeader(handle->decode())->used);
+    EXPECT_EQ(mm->readValue(handle->decode())->decode(), 2);
+  }
+}
+
+TEST(RootSet, semiSpace) {
+  auto mm = MemoryManager::create<SemiSpaceAllocator, SemiSpaceGC, 256>();
+
+  auto root = mm->allocate(4);
+  auto p = mm->allocate(8);
+
+  mm->writeValue(root, Value::Number(0));
+  mm->writeValue(p, Value::Number(1));
+  mm->writeValue(p + 1, Value::Number(2));
+
+  HandleScope scope(*mm->roots);
+  auto h = scope.handle(p);
+
+  auto stats = mm->collect();
+  EXPECT_EQ(stats->alive, 2);
+
+  // The handle is updated to the copy.
+  auto copy = h->decode();
+  EXPECT_NE(copy, p.decode());
+  EXPECT_EQ(mm->readValue(copy)->decode(), 1);
+  EXPECT_EQ(mm->readValue(copy + 4)->decode(), 2);
+}
+
+TEST(RootSet, rangeMarkCompact) {
+  auto mm = MemoryManager::create<SingleFreeListAllocator, MarkCompactGC, 64>();
+
+  auto root = mm->allocate(4);
+  auto garbage = mm->allocate(4);
+  auto p = mm->allocate(4);
+
+  mm->writeValue(root, Value::Number(0));
+  mm->writeValue(garbage, Value::Number(1));
+  mm->writeValue(p, Value::Number(2));
+
+  Value globals[2] = {Value::Number(0), p};
+  mm->roots->addRange(globals, 2);
+
+  auto stats = mm->collect();
+  EXPECT_EQ(stats->alive, 2);
+  EXPECT_EQ(stats->reclaimed, 1);
+
+  // The object slides to the garbage, and the global is updated.
+  EXPECT_EQ(globals[1].decode(), garbage.decode());
+  EXPECT_EQ(mm->readValue(globals[1].decode())->decode(), 2);
+
+  mm->roots->removeRange(globals);
+
+  stats = mm->collect();
+  EXPECT_EQ(stats->reclaimed, 1);
+}
+
+TEST(RootSet, generational) {
+  auto mm =
+      MemoryManager::create<SingleFreeListAllocator, GenerationalGC, 1024>();
+
+  auto root = mm->allocate(4);
+  auto p = mm->allocate(4);
+
+  mm->writeValue(root, Value::Number(0));
+  mm->writeValue(p, Value::Number(1));
+
+  HandleScope scope(*mm->roots);
+  auto h = scope.handle(p);
+
+  // The young object is promoted, and the handle is updated.
+  auto stats = mm->collect();
+  EXPECT_EQ(stats->alive, 2);
+  EXPECT_FALSE(mm->nursery->contains(h->decode()));
+  EXPECT_EQ(mm->readValue(h->decode())->decode(), 1);
+}
+
+}  // namespace
@@ -0,0 +1,206 @@
+/**
+ * The MIT License (MIT)
+ * Copyright (c) 2018-present Dmitry Soshnikov <dmitry.soshnikov@gmail.com>
+ */
+
+#include <memory>
+#include <vector>
+
+#include "Heap.h"
+#include "MarkSweepGC.h"
+#include "MemoryManager.h"
+#include "ObjectHeader.h"
+#include "SegregatedFreeListAllocator.h"
+#include "Value.h"
+
+#include "gtest/gtest.h"
+
+namespace {
+
+/**
+ * Header size (the expected addresses follow the header layout).
+ */
+constexpr Word H = sizeof(ObjectHeader);
+
+static auto heap = std::make_shared<Heap>(64);
+static SegregatedFreeListAllocator allocator(heap);
+
+void reset() {
+  heap->reset();
+  allocator.reset();
+}
+
+TEST(SegregatedFreeListAllocator, sizeClasses) {
+  // Small classes are word-granular.
+  EXPECT_EQ(SegregatedFreeListAllocator::blockClass(4), 0);
+  EXPECT_EQ(SegregatedFreeListAllocator::blockClass(8), 1);
+  EXPECT_EQ(SegregatedFreeListAllocator::blockClass(64), 15);
+  EXPECT_EQ(SegregatedFreeListAllocator::requestClass(12), 2);
+
+  // Large blocks are stored by the floor power of two.
+  EXPECT_EQ(SegregatedFreeListAllocator::blockClass(68), 16);
+  EXPECT_EQ(SegregatedFreeListAllocator::blockClass(127), 16);
+  EXPECT_EQ(SegregatedFreeListAllocator::blockClass(128), 17);
+
+  // Large requests go to the ceiling power of two.
+  EXPECT_EQ(SegregatedFreeListAllocator::requestClass(68), 17);
+  EXPECT_EQ(SegregatedFreeListAllocator::requestClass(128), 17);
+  EXPECT_EQ(SegregatedFreeListAllocator::requestClass(132), 18);
+}
+
+TEST(SegregatedFreeListAllocator, allocate) {
+  reset();
+
+  auto p1 = allocator.allocate(3);
+  EXPECT_EQ(p1.isPointer(), true);
+  // Header, then the payload:
+  EXPECT_EQ(p1, H);
+  EXPECT_EQ(allocator.getHeader(p1)->size, 4);
+  EXPECT_EQ(allocator.getHeader(p1)->used, 1);
+
+  auto p2 = allocator.allocate(5);
+  // After the 4 bytes of p1:
+  EXPECT_EQ(p2, 2 * H + 4);
+  EXPECT_EQ(allocator.getHeader(p2)->size, 8);
+}
+
+TEST(SegregatedFreeListAllocator, free) {
+  reset();
+
+  auto p1 = allocator.allocate(8);
+  auto p2 = allocator.allocate(4);
+  auto p3 = allocator.allocate(8);
+
+  allocator.free(p1);
+  allocator.free(p3);
+  EXPECT_EQ(allocator.getHeader(p1)->used, 0);
+
+  // Exact fit from the bin, last freed first.
+  EXPECT_EQ(allocator.allocate(8), p3.toInt());
+  EXPECT_EQ(allocator.allocate(7), p1.toInt());
+
+  // The 4 bytes bin is empty, split the rest of the heap.
+  auto p4 = allocator.allocate(4);
+  EXPECT_EQ(p4, p3.toInt() + 8 + H);
+
+  allocator.free(p2);
+  EXPECT_EQ(allocator.allocate(1), p2.toInt());
+}
+
+TEST(SegregatedFreeListAllocator, oom) {
+  reset();
+
+  // The whole heap is one block.
+  EXPECT_TRUE(allocator.allocate(64).isNullPointer());
+
+  auto p1 = allocator.allocate(64 - H);
+  EXPECT_EQ(p1, H);
+  EXPECT_TRUE(allocator.allocate(4).isNullPointer());
+
+  allocator.free(p1);
+  EXPECT_EQ(allocator.allocate(64 - H), p1.toInt());
+}
+
+TEST(SegregatedFreeListAllocator, getObjectCount) {
+  reset();
+
+  auto p1 = allocator.allocate(8);
+  allocator.allocate(8);
+  EXPECT_EQ(allocator.getObjectCount(), 2);
+
+  allocator.free(p1);
+  EXPECT_EQ(allocator.getObjectCount(), 1);
+}
+
+TEST(SegregatedFreeListAllocator, findBlockStart) {
+  auto largeHeap = std::make_shared<Heap>(1024);
+  SegregatedFreeListAllocator largeAllocator(largeHeap);
+  std::vector<Value> objects;
+
+  for (auto i = 0; i < 40; i++) {
+    objects.push_back(largeAllocator.allocate(8));
+  }
+
+  // The walk from the found block reaches the object within a chunk.
+  for (auto p : objects) {
+    auto block = largeAllocator.findBlockStart(p.toInt());
+    EXPECT_LE(p.toInt() - block, 256 + H + 8);
+
+    while (block + H < p.toInt()) {
+      block += H + largeAllocator.getHeader(block + H)->size;
+    }
+    EXPECT_EQ(block + H, p.toInt());
+  }
+
+}
+
+TEST(SegregatedFreeListAllocator, floorProbe) {
+  auto largeHeap = std::make_shared<Heap>(2048);
+  SegregatedFreeListAllocator largeAllocator(largeHeap);
+
+  // A block, which fits the request, and 9 smaller ones of the same
+  // power-of-two class, freed after it.
+  auto fits = largeAllocator.allocate(120);
+  std::vector<Value> smaller;
+  for (auto i = 0; i < 9; i++) {
+    smaller.push_back(largeAllocator.allocate(68));
+  }
+
+  // Use up the rest of the heap.
+  while (!largeAllocator.allocate(4).isNullPointer()) {
+  }
+
+  largeAllocator.free(fits);
+  for (auto p : smaller) {
+    largeAllocator.free(p);
+  }
+
+  // Only the last 8 blocks of the bin are checked.
+  EXPECT_TRUE(largeAllocator.allocate(100).isNullPointer());
+
+  EXPECT_EQ(largeAllocator.allocate(68), smaller[8].toInt());
+  EXPECT_TRUE(largeAllocator.allocate(100).isNullPointer());
+
+  EXPECT_EQ(largeAllocator.allocate(68), smaller[7].toInt());
+  EXPECT_EQ(largeAllocator.allocate(100), fits.toInt());
+}
+
+TEST(SegregatedFreeListAllocator, largeHeap) {
+  // Heap larger than the max block size is split into several blocks.
+  auto largeHeap = std::make_shared<Heap>(1024);
+  SegregatedFreeListAllocator largeAllocator(largeHeap);
+
+  uint32_t count = 0;
+  while (!largeAllocator.allocate(200).isNullPointer()) {
+    count++;
+  }
+  EXPECT_EQ(count, 4);
+}
+
+TEST(SegregatedFreeListAllocator, MarkSweepGC) {
+  auto mm =
+      MemoryManager::create<SegregatedFreeListAllocator, MarkSweepGC, 64>();
+
+  auto p1 = mm->allocate(8);
+  auto p2 = mm->allocate(4);
+  mm->writeValue(p1, Value::Pointer(p2));
+
+  // Unreachable.
+  auto p3 = mm->allocate(8);
+  mm->allocate(4);
+
+  auto stats = mm->collect();
+  EXPECT_EQ(stats->total, 4);
+  EXPECT_EQ(stats->alive, 2);
+  EXPECT_EQ(stats->reclaimed, 2);
+  EXPECT_EQ(mm->getObjectCount(), 2);
+
+  // Free blocks are not reclaimed twice.
+  stats = mm->collect();
+  EXPECT_EQ(stats->reclaimed, 0);
+
+  // Reclaimed block is reused.
+  EXPECT_EQ(mm->allocate(8), p3.toInt());
+}
+
+}  // namespace
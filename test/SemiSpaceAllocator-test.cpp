@@ -0,0 +1,62 @@
+/**
+ * The MIT License (MIT)
+ * Copyright (c) 2018-present Dmitry Soshnikov <dmitry.soshnikov@gmail.com>
+ */
+
+#include <memory>
+
+#include "Heap.h"
+#include "ObjectHeader.h"
+#include "SemiSpaceAllocator.h"
+#include "Value.h"
+
+#include "gtest/gtest.h"
+
+namespace {
+
+/**
+ * Header size (the expected addresses follow the header layout).
+ */
+constexpr Word H = sizeof(ObjectHeader);
+
+TEST(SemiSpaceAllocator, allocate) {
+  auto heap = std::make_shared<Heap>(16 * H);
+  SemiSpaceAllocator allocator(heap);
+
+  // The first half is the current space.
+  auto p1 = allocator.allocate(3);
+  EXPECT_EQ(p1, H);
+  EXPECT_EQ(allocator.getHeader(p1)->size, 4);
+  EXPECT_EQ(allocator.getHeader(p1)->used, 1);
+
+  // Leaves only a header size.
+  auto p2 = allocator.allocate(5 * H - 4);
+  EXPECT_EQ(p2, 2 * H + 4);
+  EXPECT_EQ(allocator.getCursor(), 7 * H);
+  EXPECT_EQ(allocator.getObjectCount(), 2);
+
+  EXPECT_TRUE(allocator.allocate(4).isNullPointer());
+  EXPECT_FALSE(allocator.contains(8 * H));
+}
+
+TEST(SemiSpaceAllocator, flip) {
+  auto heap = std::make_shared<Heap>(16 * H);
+  SemiSpaceAllocator allocator(heap);
+
+  allocator.allocate(4);
+  allocator.flip();
+
+  EXPECT_EQ(allocator.getObjectCount(), 0);
+  EXPECT_EQ(allocator.getSpaceStart(), 8 * H);
+  EXPECT_EQ(allocator.allocate(4), 9 * H);
+  EXPECT_TRUE(allocator.contains(9 * H));
+
+  // The first space is cleared.
+  allocator.clearOtherSpace();
+  EXPECT_EQ(allocator.getHeader(H)->toInt(), 0);
+
+  allocator.flip();
+  EXPECT_EQ(allocator.getSpaceStart(), 0);
+}
+
+}  // namespace
@@ -0,0 +1,87 @@
+/**
+ * The MIT License (MIT)
+ * Copyright (c) 2018-present Dmitry Soshnikov <dmitry.soshnikov@gmail.com>
+ */
+
+#include "MemoryManager.h"
+#include "SemiSpaceAllocator.h"
+#include "SemiSpaceGC.h"
+#include "gtest/gtest.h"
+
+namespace {
+
+TEST(SemiSpaceGC, collect) {
+  auto mm = MemoryManager::create<SemiSpaceAllocator, SemiSpaceGC, 256>();
+
+  // Root -> p2 -> p4, p4 -> root, p2 -> p4 (twice), p1 and p3 are garbage.
+  auto root = mm->allocate(8);
+  auto p1 = mm->allocate(4);
+  auto p2 = mm->allocate(12);
+  auto p3 = mm->allocate(4);
+  auto p4 = mm->allocate(8);
+
+  mm->writeValue(root, Value::Pointer(p2));
+  mm->writeValue(root + 1, Value::Number(0));
+  mm->writeValue(p1, Value::Pointer(p4));
+  mm->writeValue(p2, Value::Pointer(p4));
+  mm->writeValue(p2 + 1, Value::Number(2));
+  mm->writeValue(p2 + 2, Value::Pointer(p4));
+  mm->writeValue(p3, Value::Number(3));
+  mm->writeValue(p4, Value::Pointer(root));
+  mm->writeValue(p4 + 1, Value::Number(4));
+
+  auto stats = mm->collect();
+  EXPECT_EQ(stats->total, 5);
+  EXPECT_EQ(stats->alive, 3);
+  EXPECT_EQ(stats->reclaimed, 2);
+  EXPECT_EQ(mm->getObjectCount(), 3);
+
+  // The alive objects are copied breadth-first to the second half.
+  Word newRoot = 128 + sizeof(ObjectHeader);
+  Word newP2 = newRoot + 8 + sizeof(ObjectHeader);
+  Word newP4 = newP2 + 12 + sizeof(ObjectHeader);
+
+  EXPECT_EQ(mm->readValue(newRoot)->decode(), newP2);
+  EXPECT_EQ(mm->readValue(newP2)->decode(), newP4);
+  EXPECT_EQ(mm->readValue(newP2 + 4)->decode(), 2);
+  EXPECT_EQ(mm->readValue(newP2 + 8)->decode(), newP4);
+  EXPECT_EQ(mm->readValue(newP4)->decode(), newRoot);
+  EXPECT_EQ(mm->readValue(newP4 + 4)->decode(), 4);
+
+  // The allocation continues after the copied objects.
+  EXPECT_EQ(mm->allocate(4), newP4 + 8 + sizeof(ObjectHeader));
+
+  // The next cycle copies back to the first half.
+  stats = mm->collect();
+  EXPECT_EQ(stats->alive, 3);
+  EXPECT_EQ(stats->reclaimed, 1);
+  EXPECT_EQ(mm->readValue(root)->decode(), p1.toInt());
+}
+
+TEST(SemiSpaceGC, largeObjects) {
+  auto mm = MemoryManager::create<SemiSpaceAllocator, SemiSpaceGC, 256,
+                                  LargeObjectSpace::PAGE_SIZE>();
+
+  // Root -> large -> p1.
+  auto root = mm->allocate(4);
+  auto large = mm->allocate(3000);
+  auto p1 = mm->allocate(4);
+
+  mm->writeValue(root, Value::Pointer(large));
+  mm->writeValue(large, Value::Pointer(p1));
+  mm->writeValue(p1, Value::Number(1));
+
+  auto stats = mm->collect();
+  EXPECT_EQ(stats->alive, 3);
+  EXPECT_EQ(stats->reclaimed, 0);
+
+  // The large object is not moved, and its pointer is updated.
+  Word newRoot = 128 + sizeof(ObjectHeader);
+  auto newP1 = mm->readValue(large)->decode();
+  EXPECT_EQ(mm->readValue(newRoot)->decode(), large.toInt());
+  EXPECT_EQ(newP1, newRoot + 4 + sizeof(ObjectHeader));
+  EXPECT_EQ(mm->readValue(newP1)->decode(), 1);
+  EXPECT_EQ(mm->getHeader(large)->mark, 0);
+}
+
+}  // namespace
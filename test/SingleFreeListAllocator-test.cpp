@@ -6,6 +6,8 @@
 #include <memory>
 
 #include "Heap.h"
+#include "MarkSweepGC.h"
+#include "MemoryManager.h"
 #include "ObjectHeader.h"
 #include "SingleFreeListAllocator.h"
 #include "Value.h"
@@ -14,7 +16,16 @@
 
 namespace {
 
-static auto heap = std::make_shared<Heap>(32);
+/**
+ * Header size, and the smallest block size, which stores two free
+ * list links (the expected addresses follow the header layout).
+ */
+constexpr Word H = sizeof(ObjectHeader);
+constexpr Word M = SingleFreeListAllocator::MIN_BLOCK_SIZE;
+
+using Link = SingleFreeListAllocator::Link;
+
+static auto heap = std::make_shared<Heap>(8 * H);
 static SingleFreeListAllocator allocator(heap);
 
 void reset() {
@@ -27,18 +38,17 @@ TEST(SingleFreeListAllocator, allocate) {
 
   auto p1 = allocator.allocate(3);
   EXPECT_EQ(p1.isPointer(), true);
-  // 0-3 - header, 4 - payload:
-  EXPECT_EQ(p1, 4);
+  // Header, and then the payload:
+  EXPECT_EQ(p1, H);
 
-  // 3 is aligned to 4:
-  EXPECT_EQ(allocator.getHeader(p1)->size, 4);
+  // 3 is aligned to 4 (and to the smallest block):
+  EXPECT_EQ(allocator.getHeader(p1)->size, M);
 
   *heap->asWordPointer(p1) = 100;
   EXPECT_EQ(*heap->asWordPointer(p1), 100);
 
   auto p2 = allocator.allocate(5);
-  // 8-11 - header, 12 - payload:
-  EXPECT_EQ(p2, 12);
+  EXPECT_EQ(p2, 2 * H + M);
 
   // 5 is aligned to 8:
   EXPECT_EQ(allocator.getHeader(p2)->size, 8);
@@ -48,63 +58,168 @@ TEST(SingleFreeListAllocator, free) {
   reset();
 
   auto p1 = allocator.allocate(4);
-  EXPECT_EQ(p1, 4);
+  EXPECT_EQ(p1, H);
 
   auto p2 = allocator.allocate(4);
-  EXPECT_EQ(p2, 12);
+  EXPECT_EQ(p2, 2 * H + M);
 
-  // Free p1, alloc p3, still bump (alloc at 20)
+  // Free p1, alloc p3, still bump (alloc after p2)
   allocator.free(p1);
   auto p3 = allocator.allocate(12);
-  EXPECT_EQ(p3, 20);
+  EXPECT_EQ(p3, 3 * H + 2 * M);
 
-  // Alloc p4 at 4 (from freed p 1)
+  // Alloc p4 at H (from freed p 1)
   auto p4 = allocator.allocate(2);
-  EXPECT_EQ(p4, 4);
+  EXPECT_EQ(p4, H);
 }
 
 TEST(SingleFreeListAllocator, blockSize) {
   reset();
 
-  auto p1 = allocator.allocate(16);
-  EXPECT_EQ(allocator.getHeader(p1)->size, 16);
-  EXPECT_EQ(p1, 4);
+  // Fits 8 bytes, and the smallest block with a header.
+  constexpr Word S = 8 + H + M;
+
+  auto p1 = allocator.allocate(S);
+  EXPECT_EQ(allocator.getHeader(p1)->size, S);
+  EXPECT_EQ(p1, H);
 
   auto p2 = allocator.allocate(8);
   EXPECT_EQ(allocator.getHeader(p2)->size, 8);
-  EXPECT_EQ(p2, 24);
+  EXPECT_EQ(p2, 2 * H + S);
 
   allocator.free(p1);
-  EXPECT_EQ(allocator.getHeader(p1)->size, 16);
+  EXPECT_EQ(allocator.getHeader(p1)->size, S);
 
-  p1 = allocator.allocate(12);
-  EXPECT_EQ(p1, 4);
-  // Couldn't split, the block is still 16.
-  EXPECT_EQ(allocator.getHeader(p1)->size, 16);
-  EXPECT_EQ(p1, 4);
+  p1 = allocator.allocate(S - 4);
+  EXPECT_EQ(p1, H);
+  // Couldn't split, the block is still S.
+  EXPECT_EQ(allocator.getHeader(p1)->size, S);
+  EXPECT_EQ(p1, H);
 
   allocator.free(p1);
   p1 = allocator.allocate(8);
-  EXPECT_EQ(p1, 4);
+  EXPECT_EQ(p1, H);
   // Can split:
   EXPECT_EQ(allocator.getHeader(p1)->size, 8);
 
   p2 = allocator.allocate(4);
-  EXPECT_EQ(allocator.getHeader(p2)->size, 4);
-  EXPECT_EQ(p2, 16);
+  EXPECT_EQ(allocator.getHeader(p2)->size, M);
+  EXPECT_EQ(p2, 2 * H + 8);
+
+}
+
+TEST(SingleFreeListAllocator, freeListLinks) {
+  reset();
+
+  // The first block links to nothing.
+  EXPECT_EQ(*heap->asWordPointer(H), 0);
+
+  auto p1 = allocator.allocate(4);
+  allocator.allocate(4);
+  allocator.allocate(4);
+
+  // The links are stored in the freed block: p1 <-> the last block.
+  allocator.free(p1);
+  constexpr Word last = 4 * H + 3 * M;
+
+  auto links = (Link*)heap->asWordPointer(p1);
+  EXPECT_EQ(links[0], last);
+  EXPECT_EQ(links[1], 0);
+  EXPECT_EQ(((Link*)heap->asWordPointer(last))[1], p1.toInt());
+
+  // Reused from the head of the list.
+  EXPECT_EQ(allocator.allocate(4), p1.toInt());
+  EXPECT_EQ(allocator.allocate(4), last);
+  EXPECT_TRUE(allocator.allocate(4).isNullPointer());
+}
+
+TEST(SingleFreeListAllocator, coalesce) {
+  reset();
+
+  auto p1 = allocator.allocate(4);
+  auto p2 = allocator.allocate(4);
+  auto p3 = allocator.allocate(4);
+  auto p4 = allocator.allocate(4);
+
+  // The boundary tag of the freed block is in the next header.
+  allocator.free(p1);
+  EXPECT_EQ(allocator.getHeader(p2)->prevFree, 1);
+  EXPECT_EQ(allocator.getHeader(p2)->getForward(), M);
 
+  // No free neighbours.
+  allocator.free(p3);
+  EXPECT_EQ(allocator.getHeader(p3)->size, M);
+
+  // Merged with both neighbours.
+  allocator.free(p2);
+  EXPECT_EQ(allocator.getHeader(p1)->size, 3 * M + 2 * H);
+  EXPECT_EQ(allocator.getHeader(p4)->prevFree, 1);
+  EXPECT_EQ(allocator.getHeader(p4)->getForward(), 3 * M + 2 * H);
+
+  EXPECT_EQ(allocator.allocate(3 * M + 2 * H), p1.toInt());
+  EXPECT_EQ(allocator.getHeader(p4)->prevFree, 0);
+}
+
+TEST(SingleFreeListAllocator, fragmentation) {
+  auto largeHeap = std::make_shared<Heap>(256);
+  SingleFreeListAllocator largeAllocator(largeHeap);
+
+  for (auto round = 0; round < 3; round++) {
+    std::vector<Value> objects;
+
+    // Fill the heap with small objects.
+    for (auto p = largeAllocator.allocate(4); !p.isNullPointer();
+         p = largeAllocator.allocate(4 + 4 * (objects.size() % 3))) {
+      objects.push_back(p);
+    }
+
+    // Free every other object, and then the rest in reverse order.
+    for (size_t i = 0; i < objects.size(); i += 2) {
+      largeAllocator.free(objects[i]);
+    }
+    for (int i = objects.size() / 2 * 2 - 1; i > 0; i -= 2) {
+      largeAllocator.free(objects[i]);
+    }
+
+    EXPECT_EQ(largeAllocator.getObjectCount(), 0);
+  }
+
+  // All fragments are merged back into one block.
+  EXPECT_EQ(largeAllocator.allocate(256 - H), H);
+}
+
+TEST(SingleFreeListAllocator, fragmentationMarkSweep) {
+  auto mm = MemoryManager::create<SingleFreeListAllocator, MarkSweepGC, 256>();
+
+  // Root object.
+  auto root = mm->allocate(4);
+  mm->writeValue(root, Value::Number(1));
+
+  for (auto round = 0; round < 5; round++) {
+    // Unreachable objects of different sizes until OOM.
+    auto n = 0;
+    while (!mm->allocate(4 + 4 * (n++ % 4)).isNullPointer()) {
+    }
+
+    auto stats = mm->collect();
+    EXPECT_EQ(stats->alive, 1);
+    EXPECT_EQ(stats->reclaimed, n - 1);
+  }
+
+  // The reclaimed objects are coalesced into one block.
+  EXPECT_EQ(mm->allocate(256 - 2 * H - M), 2 * H + M);
 }
 
 TEST(SingleFreeListAllocator, reset) {
   reset();
 
   auto p1 = allocator.allocate(4);
-  EXPECT_EQ(p1, 4);
+  EXPECT_EQ(p1, H);
 
   allocator.reset();
 
   auto p2 = allocator.allocate(4);
-  EXPECT_EQ(p2, 4);
+  EXPECT_EQ(p2, H);
 }
 
 TEST(SingleFreeListAllocator, getObjectCount) {
@@ -131,12 +246,28 @@ TEST(SingleFreeListAllocator, getObjectCount) {
   EXPECT_EQ(allocator.getObjectCount(), 2);
 }
 
+TEST(SingleFreeListAllocator, getFreeSize) {
+  reset();
+  EXPECT_EQ(allocator.getFreeSize(), 7 * H);
+
+  auto p1 = allocator.allocate(4);
+  auto p2 = allocator.allocate(4);
+  EXPECT_EQ(allocator.getFreeSize(), 5 * H - 2 * M);
+
+  allocator.free(p1);
+  EXPECT_EQ(allocator.getFreeSize(), 5 * H - M);
+
+  // Merged with both neighbours (the headers become free, too).
+  allocator.free(p2);
+  EXPECT_EQ(allocator.getFreeSize(), 7 * H);
+}
+
 TEST(SingleFreeListAllocator, getHeader) {
   reset();
 
   auto p = allocator.allocate(4);
   auto header = allocator.getHeader(p);
-  EXPECT_EQ(header->size, 4);
+  EXPECT_EQ(header->size, M);
 }
 
 }  // namespace
\ No newline at end of file
@@ -0,0 +1,98 @@
+/**
+ * The MIT License (MIT)
+ * Copyright (c) 2018-present Dmitry Soshnikov <dmitry.soshnikov@gmail.com>
+ */
+
+#include <memory>
+
+#include "Heap.h"
+#include "MarkSweepGC.h"
+#include "MemoryManager.h"
+#include "SemiSpaceAllocator.h"
+#include "SemiSpaceGC.h"
+#include "SingleFreeListAllocator.h"
+#include "TypeTable.h"
+#include "gtest/gtest.h"
+
+namespace {
+
+TEST(TypeTable, getPointers) {
+  auto heap = std::make_shared<Heap>(64);
+  TypeTable types(heap);
+
+  // Words 0 and 2 are pointers.
+  auto type = types.registerType({0b101});
+  EXPECT_EQ(type, 2);
+
+  *(Value*)heap->asWordPointer(8) = Value::Pointer(32);
+  *(Value*)heap->asWordPointer(12) = Value::Pointer(36);
+  *(Value*)heap->asWordPointer(16) = Value::Pointer(40);
+
+  EXPECT_EQ(types.getType(8), TypeTable::CONSERVATIVE);
+  types.setType(8, type);
+  EXPECT_EQ(types.getType(8), type);
+
+  auto pointers = types.getPointers(8, type, 3);
+  EXPECT_EQ(pointers.size(), 2);
+  EXPECT_EQ(pointers[0]->decode(), 32);
+  EXPECT_EQ(pointers[1]->decode(), 40);
+
+  // The bits beyond the object size are ignored.
+  EXPECT_EQ(types.getPointers(8, type, 2).size(), 1);
+  EXPECT_EQ(types.getPointers(8, TypeTable::LEAF, 3).size(), 0);
+
+  types.moveType(8, 20);
+  EXPECT_EQ(types.getType(20), type);
+}
+
+TEST(TypeTable, markSweep) {
+  auto mm = MemoryManager::create<SingleFreeListAllocator, MarkSweepGC, 128>();
+
+  // Only the first word of the node is a pointer.
+  auto node = mm->registerType({0b1});
+
+  auto root = mm->allocate(8, node);
+  auto p1 = mm->allocate(4);
+  auto p2 = mm->allocate(4);
+  auto p3 = mm->allocate(8, TypeTable::LEAF);
+  auto p4 = mm->allocate(4);
+
+  // The second word of the root, and the leaf words look like pointers,
+  // but are not traced.
+  mm->writeValue(root, Value::Pointer(p1));
+  mm->writeValue(root + 1, Value::Pointer(p2));
+  mm->writeValue(p1, Value::Pointer(p3));
+  mm->writeValue(p2, Value::Number(2));
+  mm->writeValue(p3, Value::Pointer(p4));
+  mm->writeValue(p3 + 1, Value::Number(3));
+  mm->writeValue(p4, Value::Number(4));
+
+  EXPECT_EQ(mm->getPointers(root).size(), 1);
+  EXPECT_EQ(mm->getPointers(p3).size(), 0);
+
+  auto stats = mm->collect();
+  EXPECT_EQ(stats->alive, 3);
+  EXPECT_EQ(stats->reclaimed, 2);
+}
+
+TEST(TypeTable, semiSpace) {
+  auto mm = MemoryManager::create<SemiSpaceAllocator, SemiSpaceGC, 256>();
+
+  auto node = mm->registerType({0b1});
+
+  auto root = mm->allocate(8, node);
+  auto p1 = mm->allocate(4);
+
+  mm->writeValue(root, Value::Number(0));
+  mm->writeValue(root + 1, Value::Pointer(p1));
+  mm->writeValue(p1, Value::Number(1));
+
+  // The type is copied with the object.
+  auto stats = mm->collect();
+  EXPECT_EQ(stats->alive, 1);
+
+  Word newRoot = 128 + sizeof(ObjectHeader);
+  EXPECT_EQ(mm->types->getType(newRoot), node);
+}
+
+}  // namespace
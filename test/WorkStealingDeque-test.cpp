@@ -0,0 +1,88 @@
+/**
+ * The MIT License (MIT)
+ * Copyright (c) 2018-present Dmitry Soshnikov <dmitry.soshnikov@gmail.com>
+ */
+
+#include <stdint.h>
+#include <atomic>
+#include <thread>
+#include <vector>
+
+#include "../src/gc/WorkStealingDeque.h"
+#include "gtest/gtest.h"
+
+namespace {
+
+TEST(WorkStealingDeque, pushPop) {
+  WorkStealingDeque<uint32_t> deque(4);
+  uint32_t item;
+
+  EXPECT_TRUE(deque.empty());
+  EXPECT_FALSE(deque.pop(item));
+  EXPECT_FALSE(deque.steal(item));
+
+  // Grows past the initial capacity.
+  for (uint32_t i = 1; i <= 10; i++) {
+    deque.push(i);
+  }
+  EXPECT_FALSE(deque.empty());
+
+  // The owner pops the newest items, the thieves steal the oldest.
+  EXPECT_TRUE(deque.pop(item));
+  EXPECT_EQ(item, 10);
+  EXPECT_TRUE(deque.steal(item));
+  EXPECT_EQ(item, 1);
+
+  for (uint32_t i = 9; i >= 2; i--) {
+    EXPECT_TRUE(deque.pop(item));
+    EXPECT_EQ(item, i);
+  }
+
+  EXPECT_TRUE(deque.empty());
+  EXPECT_FALSE(deque.pop(item));
+}
+
+TEST(WorkStealingDeque, steal) {
+  constexpr uint32_t ITEMS = 100000;
+  constexpr uint32_t THIEVES = 3;
+
+  WorkStealingDeque<uint32_t> deque(16);
+  std::vector<std::atomic<uint32_t>> taken(ITEMS);
+  std::atomic<bool> done(false);
+
+  std::vector<std::thread> thieves;
+  for (uint32_t i = 0; i < THIEVES; i++) {
+    thieves.emplace_back([&]() {
+      uint32_t item;
+      while (!done || !deque.empty()) {
+        if (deque.steal(item)) {
+          taken[item]++;
+        }
+      }
+    });
+  }
+
+  // The owner pushes all items, popping every other one.
+  uint32_t item;
+  for (uint32_t i = 0; i < ITEMS; i++) {
+    deque.push(i);
+    if (i % 2 == 0 && deque.pop(item)) {
+      taken[item]++;
+    }
+  }
+  while (deque.pop(item)) {
+    taken[item]++;
+  }
+
+  done = true;
+  for (auto& thief : thieves) {
+    thief.join();
+  }
+
+  // Each item is taken exactly once.
+  for (uint32_t i = 0; i < ITEMS; i++) {
+    EXPECT_EQ(taken[i].load(), 1);
+  }
+}
+
+}  // namespace